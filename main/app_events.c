@@ -0,0 +1,41 @@
+/**
+ * App Events Functions
+ *
+ * Odottavat tapahtumat ovat bittimaskissa, joten lähetys on yksi
+ * kriittinen osio eikä jono voi täyttyä.
+ */
+
+#include "app_events.h"
+#include "freertos/FreeRTOS.h"
+#include "lvgl.h"
+#include "lvgl_port.h"
+
+static portMUX_TYPE pending_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t pending;
+
+void app_events_post(app_event_t event)
+{
+    taskENTER_CRITICAL(&pending_lock);
+    bool first = (pending == 0);
+    pending |= 1u << event;
+    taskEXIT_CRITICAL(&pending_lock);
+
+    // Jo odottava tapahtuma on herättänyt LVGL-taskin
+    if (first) {
+        lvgl_port_wake();
+    }
+}
+
+void app_events_dispatch(void)
+{
+    taskENTER_CRITICAL(&pending_lock);
+    uint32_t events = pending;
+    pending = 0;
+    taskEXIT_CRITICAL(&pending_lock);
+
+    while (events) {
+        app_event_t event = (app_event_t)__builtin_ctz(events);
+        events &= events - 1;
+        lv_msg_send(event, NULL);
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * App Events Header
+ *
+ * Sovelluksen tapahtumat näkymille. Tapahtuman voi lähettää mistä tahansa
+ * taskista (väylä, haku, loki); se välitetään LVGL:n viestinä (lv_msg)
+ * LVGL-taskissa ennen seuraavaa piirtoa, joten tilaajat saavat käsitellä
+ * LVGL-objekteja suoraan ilman lukitusta.
+ *
+ * Tapahtumilla ei ole dataa: ne kertovat vain, että jokin on muuttunut,
+ * ja tilaaja lukee nykyisen tilan itse. Saman tapahtuman toistot ennen
+ * välitystä yhdistyvät yhdeksi viestiksi.
+ *
+ * Tilaus objektille: lv_msg_subscribe_obj(APP_EVENT_x, obj, NULL) ja
+ * lv_obj_add_event_cb(obj, cb, LV_EVENT_MSG_RECEIVED, NULL).
+ */
+
+#ifndef APP_EVENTS_H
+#define APP_EVENTS_H
+
+#include <stdint.h>
+
+typedef enum {
+    APP_EVENT_SCREEN_CHANGED = 1,   // Näkymä vaihtui (screen_manager_get_current_screen)
+    APP_EVENT_SCAN_STATUS,          // Väylähaun tila muuttui (modbus_scan_get_status)
+    APP_EVENT_PROGRAM_SAVE,         // Ohjelmien tallennuksen tila muuttui
+    APP_EVENT_RESULT_LOGGED,        // Uusi testitulos lokissa (result_log_last_seq)
+    APP_EVENT_BUS_TX,               // Pyyntö lähetetty väylälle
+    APP_EVENT_BUS_RX,               // Kehys vastaanotettu väylältä
+    APP_EVENT_STATE_CHANGED,        // Jokin app_state-kenttä muuttui (app_state_version)
+    APP_EVENT_TEST_START,           // Testin aloituskomennon tila muuttui (testing_content)
+    APP_EVENT_BUS_COMMAND,          // Jonotettu väyläkomento suoritettu (modbus_command_get_status)
+    APP_EVENT_COUNT
+} app_event_t;
+
+_Static_assert(APP_EVENT_COUNT <= 32, "Odottavat tapahtumat ovat 32-bittisessä maskissa");
+
+/**
+ * @brief Lähettää tapahtuman, kutsuttavissa mistä tahansa taskista
+ *
+ * Ei odota eikä varaa muistia.
+ */
+void app_events_post(app_event_t event);
+
+/**
+ * @brief Välittää odottavat tapahtumat tilaajille
+ *
+ * Kutsutaan LVGL-taskissa LVGL-lukon alla (lvgl_port_set_cycle_cb).
+ */
+void app_events_dispatch(void);
+
+#endif /* APP_EVENTS_H */
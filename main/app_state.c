@@ -0,0 +1,138 @@
+/**
+ * App State Functions
+ *
+ * Jokaisella kentällä on oma sekvenssilaskuri: pariton arvo tarkoittaa
+ * kirjoitusta kesken, ja versio on laskuri / 2. Kirjoittajat sarjoitetaan
+ * kriittisellä osiolla, joten kirjoitus ei keskeydy eikä toinen ydin
+ * odota sitä kopion verran pidempään. Suurin kenttä (nimet) on alle 1 kt.
+ */
+
+#include "app_state.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "app_events.h"
+
+_Static_assert(OPTA_RELAY_COUNT <= 8, "Releiden tilat ovat 8-bittisessä maskissa");
+
+static struct {
+    app_programs_t programs;
+    app_program_names_t program_names;
+    uint8_t relays;
+} state;
+
+static uint32_t seq[APP_STATE_FIELD_COUNT];
+static portMUX_TYPE write_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Merkitsee kirjoituksen alkaneeksi, write_lock on jo otettu
+static void write_mark(app_state_field_t field)
+{
+    __atomic_store_n(&seq[field], seq[field] + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_begin(app_state_field_t field)
+{
+    taskENTER_CRITICAL(&write_lock);
+    write_mark(field);
+}
+
+static void write_end(app_state_field_t field)
+{
+    __atomic_store_n(&seq[field], seq[field] + 1, __ATOMIC_RELEASE);
+    taskEXIT_CRITICAL(&write_lock);
+    app_events_post(APP_EVENT_STATE_CHANGED);
+}
+
+static uint32_t read_field(app_state_field_t field, void *dst, const void *src, size_t size)
+{
+    uint32_t begin, end;
+    do {
+        // Kirjoitus kestää vain kopion verran, joten odotus on lyhyt
+        while ((begin = __atomic_load_n(&seq[field], __ATOMIC_ACQUIRE)) & 1) {
+        }
+        memcpy(dst, src, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&seq[field], __ATOMIC_RELAXED);
+    } while (begin != end);
+    return begin >> 1;
+}
+
+void app_state_init(void)
+{
+    app_programs_t programs;
+    for (int i = 0; i < FORTEST_PROGRAM_SLOTS; i++) {
+        programs.program[i] = i + 1;
+        programs.enabled[i] = true;
+    }
+    app_state_set_programs(&programs);
+
+    static app_program_names_t names;
+    for (int i = 0; i < FORTEST_PROGRAM_COUNT; i++) {
+        snprintf(names.name[i], sizeof(names.name[i]), "Ohjelma %d", i + 1);
+    }
+    names.state = APP_NAMES_DEFAULT;
+    app_state_set_program_names(&names);
+}
+
+uint32_t app_state_version(app_state_field_t field)
+{
+    return __atomic_load_n(&seq[field], __ATOMIC_ACQUIRE) >> 1;
+}
+
+uint32_t app_state_get_programs(app_programs_t *programs)
+{
+    return read_field(APP_STATE_PROGRAMS, programs, &state.programs, sizeof(*programs));
+}
+
+uint32_t app_state_get_program_names(app_program_names_t *names)
+{
+    return read_field(APP_STATE_PROGRAM_NAMES, names, &state.program_names, sizeof(*names));
+}
+
+uint32_t app_state_get_relays(uint8_t *relays)
+{
+    return read_field(APP_STATE_RELAYS, relays, &state.relays, sizeof(*relays));
+}
+
+void app_state_set_programs(const app_programs_t *programs)
+{
+    write_begin(APP_STATE_PROGRAMS);
+    state.programs = *programs;
+    write_end(APP_STATE_PROGRAMS);
+}
+
+void app_state_set_program_names(const app_program_names_t *names)
+{
+    write_begin(APP_STATE_PROGRAM_NAMES);
+    state.program_names = *names;
+    write_end(APP_STATE_PROGRAM_NAMES);
+}
+
+bool app_state_begin_names_fetch(void)
+{
+    // Tarkistus ja asetus samassa kirjoittajan kriittisessä osiossa
+    taskENTER_CRITICAL(&write_lock);
+    if (state.program_names.state == APP_NAMES_FETCHING) {
+        taskEXIT_CRITICAL(&write_lock);
+        return false;
+    }
+    write_mark(APP_STATE_PROGRAM_NAMES);
+    state.program_names.state = APP_NAMES_FETCHING;
+    state.program_names.fetched = 0;
+    state.program_names.loaded = 0;
+    write_end(APP_STATE_PROGRAM_NAMES);
+    return true;
+}
+
+void app_state_set_relay(uint8_t relay, bool on)
+{
+    if (relay < 1 || relay > OPTA_RELAY_COUNT) {
+        return;
+    }
+    uint8_t mask = 1u << (relay - 1);
+
+    write_begin(APP_STATE_RELAYS);
+    state.relays = on ? (state.relays | mask) : (state.relays & ~mask);
+    write_end(APP_STATE_RELAYS);
+}
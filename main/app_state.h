@@ -0,0 +1,100 @@
+/**
+ * App State Header
+ *
+ * Laitteen tila yhdessä paikassa: ohjelmavalinnat, ohjelmien nimet ja
+ * releiden tilat. Väylätaskit kirjoittavat, näkymät lukevat.
+ *
+ * Jokaisella kentällä on oma versionumeronsa, joka kasvaa jokaisella
+ * kirjoituksella. Näkymä muistaa piirtämänsä version ja piirtää kentän
+ * uudelleen vain, kun app_state_version() on muuttunut. Jokainen kirjoitus
+ * lähettää APP_EVENT_STATE_CHANGED-tapahtuman.
+ *
+ * Luku on seqlock: lukija kopioi kentän ja yrittää uudelleen, jos
+ * kirjoitus osui kopioinnin päälle. Lukija ei siis koskaan odota lukkoa
+ * eikä estä kirjoittajaa, ja kopio on aina yhtenäinen.
+ */
+
+#ifndef APP_STATE_H
+#define APP_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "register_map.h"
+
+#define APP_PROGRAM_NAME_LEN        (32)
+
+typedef enum {
+    APP_STATE_PROGRAMS = 0,         // app_programs_t
+    APP_STATE_PROGRAM_NAMES,        // app_program_names_t
+    APP_STATE_RELAYS,               // Releiden bittimaski
+    APP_STATE_FIELD_COUNT
+} app_state_field_t;
+
+/**
+ * @brief Ohjelmavalinnat, program[0] on aina käytössä
+ */
+typedef struct {
+    uint16_t program[FORTEST_PROGRAM_SLOTS];    // 1..FORTEST_PROGRAM_COUNT
+    bool enabled[FORTEST_PROGRAM_SLOTS];
+} app_programs_t;
+
+typedef enum {
+    APP_NAMES_DEFAULT = 0,          // Oletusnimet, nimiä ei ole haettu
+    APP_NAMES_FETCHING,
+    APP_NAMES_DONE,
+    APP_NAMES_TIMEOUT,
+} app_names_state_t;
+
+/**
+ * @brief Ohjelmien nimet ja nimihaun tila
+ */
+typedef struct {
+    char name[FORTEST_PROGRAM_COUNT][APP_PROGRAM_NAME_LEN];
+    uint8_t state;                  // app_names_state_t
+    uint8_t fetched;                // Haun aikana käsitellyt nimet
+    uint8_t loaded;                 // Laitteelta luetut nimet, muut ovat oletusnimiä
+} app_program_names_t;
+
+/**
+ * @brief Asettaa oletustilan, kutsutaan ennen näkymien luontia
+ */
+void app_state_init(void);
+
+/**
+ * @brief Kentän nykyinen versio
+ *
+ * Halpa tarkistus ennen kopiointia: sama versio tarkoittaa samaa sisältöä.
+ */
+uint32_t app_state_version(app_state_field_t field);
+
+/**
+ * @brief Kopioi kentän yhtenäisenä
+ *
+ * @return uint32_t Kopioidun sisällön versio
+ */
+uint32_t app_state_get_programs(app_programs_t *programs);
+uint32_t app_state_get_program_names(app_program_names_t *names);
+uint32_t app_state_get_relays(uint8_t *relays);
+
+/**
+ * @brief Kirjoittaa kentän, kutsuttavissa mistä tahansa taskista
+ */
+void app_state_set_programs(const app_programs_t *programs);
+void app_state_set_program_names(const app_program_names_t *names);
+
+/**
+ * @brief Varaa nimihaun: asettaa tilaksi APP_NAMES_FETCHING, ellei haku ole jo käynnissä
+ *
+ * Tarkistus ja asetus tehdään yhtenä kirjoituksena, joten kahdesta
+ * samanaikaisesta kutsusta vain toinen saa haun.
+ *
+ * @return true jos haku varattiin kutsujalle
+ */
+bool app_state_begin_names_fetch(void);
+
+/**
+ * @brief Asettaa yhden releen tilan (relay 1..OPTA_RELAY_COUNT)
+ */
+void app_state_set_relay(uint8_t relay, bool on);
+
+#endif /* APP_STATE_H */
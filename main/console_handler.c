@@ -0,0 +1,436 @@
+/**
+ * Console Handler Functions
+ *
+ * Konsolikomennot lokien lukemiseen ja väylän asetuksiin. Tulosteet kirjoitetaan
+ * tietue tai pala kerrallaan, joten koko lokia ei koskaan koota muistiin.
+ */
+
+#include "console_handler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_console.h"
+#include "esp_log.h"
+#include "result_log.h"
+#include "export_stream.h"
+#include "rs485_handler.h"
+#include "modbus_scan.h"
+#include "modbus_handler.h"
+#include "modbus_cache.h"
+#include "modbus_slave.h"
+#include "register_map.h"
+#include "lvgl_port.h"
+#if LVGL_PORT_BENCH && CONFIG_LV_USE_DEMO_BENCHMARK
+#include "demos/lv_demos.h"
+#endif
+
+static const char *TAG = "CONSOLE";
+
+// Yhden CSV-rivin puskuri (käyrä mukana)
+static char line_buf[64 + RESULT_LOG_CURVE_MAX * 12];
+static result_log_entry_t entry;
+
+static const char *outcome_name(uint8_t outcome)
+{
+    switch (outcome) {
+        case RESULT_LOG_OUTCOME_PASS:    return "PASS";
+        case RESULT_LOG_OUTCOME_FAIL:    return "FAIL";
+        case RESULT_LOG_OUTCOME_ABORTED: return "ABORT";
+        default:                         return "ERROR";
+    }
+}
+
+// log_recent [n]: tulosta viimeisimmät tulokset indeksistä
+static int cmd_log_recent(int argc, char **argv)
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 10;
+    if (n <= 0) {
+        n = 10;
+    }
+
+    printf("%zu tulosta indeksissä, viimeisin #%lu\n", result_log_count(), result_log_last_seq());
+    for (int i = 0; i < n; i++) {
+        if (result_log_get_recent(i, &entry) != ESP_OK) {
+            break;
+        }
+        printf("#%-6lu t=%-10lu P%-3u %-5s paine=%ld vuoto=%ld käyrä=%u näytettä\n",
+               entry.seq, entry.timestamp, entry.program, outcome_name(entry.outcome),
+               entry.test_pressure, entry.leak_value, entry.curve_len);
+    }
+    return 0;
+}
+
+// log_export: koko loki CSV-muodossa vanhimmasta uusimpaan
+static int cmd_log_export(int argc, char **argv)
+{
+    result_log_iter_t it;
+    result_log_iter_begin(&it);
+
+    printf("seq,timestamp,program,outcome,test_pressure,leak_value,curve_interval_ms,curve\n");
+    while (result_log_iter_next(&it, &entry) == ESP_OK) {
+        result_log_format_csv(&entry, line_buf, sizeof(line_buf));
+        fputs(line_buf, stdout);
+    }
+    fflush(stdout);
+    return 0;
+}
+
+// export [lähde] [kohta] [max_tavut]: siirrä lähteen data paloina
+static int cmd_export(int argc, char **argv)
+{
+    if (argc < 2 || strcmp(argv[1], "list") == 0) {
+        const export_source_t *source;
+        for (size_t i = 0; (source = export_get_source(i)) != NULL; i++) {
+            printf("%-16s %s\n", source->name, source->description);
+        }
+        return 0;
+    }
+
+    const export_source_t *source = export_find_source(argv[1]);
+    if (source == NULL) {
+        printf("Tuntematon lähde: %s\n", argv[1]);
+        return 1;
+    }
+
+    uint32_t position = (argc > 2) ? strtoul(argv[2], NULL, 0) : 0;
+    size_t max_bytes = (argc > 3) ? strtoul(argv[3], NULL, 0) : 0;
+    return export_stream(source, position, max_bytes) == ESP_OK ? 0 : 1;
+}
+
+// bus_config [nopeus] [none|even|odd] [1|2] [rx_puskuri] [tx_puskuri]
+static int cmd_bus_config(int argc, char **argv)
+{
+    rs485_config_t config;
+    rs485_get_config(&config);
+
+    if (argc > 1) {
+        config.baud_rate = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        if (strcmp(argv[2], "even") == 0) {
+            config.parity = UART_PARITY_EVEN;
+        } else if (strcmp(argv[2], "odd") == 0) {
+            config.parity = UART_PARITY_ODD;
+        } else {
+            config.parity = UART_PARITY_DISABLE;
+        }
+    }
+    if (argc > 3) {
+        config.stop_bits = (atoi(argv[3]) == 2) ? UART_STOP_BITS_2 : UART_STOP_BITS_1;
+    }
+    if (argc > 4) {
+        config.rx_buffer_size = strtoul(argv[4], NULL, 10);
+    }
+    if (argc > 5) {
+        config.tx_buffer_size = strtoul(argv[5], NULL, 10);
+    }
+
+    if (argc > 1) {
+        esp_err_t ret = rs485_apply_config(&config);
+        if (ret == ESP_OK) {
+            ret = rs485_config_save(&config);
+        }
+        if (ret != ESP_OK) {
+            printf("Asetusten muutos epäonnistui: %s\n", esp_err_to_name(ret));
+            return 1;
+        }
+    }
+
+    static const char *parity_names[] = { "none", "?", "even", "odd" };
+    printf("%lu bit/s, pariteetti %s, stop %d, puskurit rx %u / tx %u\n", config.baud_rate,
+           parity_names[config.parity & 3], config.stop_bits == UART_STOP_BITS_2 ? 2 : 1,
+           config.rx_buffer_size, config.tx_buffer_size);
+    return 0;
+}
+
+// bus_negotiate <slave_id> [rekisteri]: siirrä laite suurimmalle toimivalle nopeudelle
+static int cmd_bus_negotiate(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Käyttö: bus_negotiate <slave_id> [rekisteri]\n");
+        return 1;
+    }
+
+    uint8_t slave_id = (uint8_t)atoi(argv[1]);
+    uint16_t baud_register = (argc > 2) ? strtoul(argv[2], NULL, 0) : OPTA_SERIAL_BAUD_ADDR;
+    uint32_t baud_rate = 0;
+
+    esp_err_t ret = modbus_negotiate_baud(slave_id, baud_register, &baud_rate);
+    if (ret != ESP_OK) {
+        printf("Laite %u: %s\n", slave_id, esp_err_to_name(ret));
+        return 1;
+    }
+    printf("Laite %u: %lu bit/s\n", slave_id, baud_rate);
+    return 0;
+}
+
+// bus_info <slave_id> [probe]: laitteen kyvyt ja tunnistetiedot
+static int cmd_bus_info(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Käyttö: bus_info <slave_id> [probe]\n");
+        return 1;
+    }
+
+    uint8_t slave_id = (uint8_t)atoi(argv[1]);
+    if (argc > 2 && strcmp(argv[2], "probe") == 0) {
+        esp_err_t ret = modbus_probe_capabilities(slave_id);
+        if (ret == ESP_OK) {
+            ret = modbus_slave_save();
+        }
+        if (ret != ESP_OK) {
+            printf("Laite %u: %s\n", slave_id, esp_err_to_name(ret));
+            return 1;
+        }
+    }
+
+    uint8_t caps = modbus_slave_get_capabilities(slave_id);
+    printf("Laite %u: %lu bit/s\n", slave_id, modbus_slave_get_baud_rate(slave_id));
+    if (!(caps & MODBUS_CAP_PROBED)) {
+        printf("Kykyjä ei ole selvitetty (bus_info %u probe)\n", slave_id);
+        return 0;
+    }
+    printf("FC 0x03 %s, FC 0x10 %s, tunnistus %s, enintään %u rekisteriä/luku\n",
+           (caps & MODBUS_CAP_READ_HOLDING) ? "kyllä" : "ei",
+           (caps & MODBUS_CAP_WRITE_MULTIPLE) ? "kyllä" : "ei",
+           (caps & MODBUS_CAP_DEVICE_ID) ? "kyllä" : "ei",
+           modbus_slave_get_max_read(slave_id));
+
+    modbus_device_id_t id;
+    if ((caps & MODBUS_CAP_DEVICE_ID) && modbus_slave_load_device_id(slave_id, &id) == ESP_OK) {
+        printf("Valmistaja: %s\nTuote: %s\nVersio: %s\n", id.vendor, id.product, id.revision);
+    }
+    return 0;
+}
+
+// bus_stats: väylän liikennelaskurit ja jaettujen lukujen säästö
+static int cmd_bus_stats(int argc, char **argv)
+{
+    modbus_stats_t bus;
+    modbus_cache_stats_t cache;
+    modbus_get_stats(&bus);
+    modbus_cache_get_stats(&cache);
+
+    printf("Pyynnöt %lu, aikakatkaisut %lu, poikkeukset %lu, virheet %lu, hylätyt kehykset %lu\n",
+           bus.transactions, bus.timeouts, bus.exceptions, bus.errors, bus.discarded_frames);
+    printf("Lähetetty %lu tavua, vastaanotettu %lu tavua\n", bus.tx_bytes, bus.rx_bytes);
+    printf("Uusintayritykset %lu, eristetyille hylätyt %lu\n", bus.retries, bus.rejected);
+
+    for (int id = MODBUS_SLAVE_ID_MIN; id <= MODBUS_SLAVE_ID_MAX; id++) {
+        modbus_breaker_state_t state = modbus_slave_breaker_get_state(id);
+        if (state != MODBUS_BREAKER_CLOSED) {
+            printf("Laite %d %s\n", id, state == MODBUS_BREAKER_OPEN ? "eristetty" : "kokeilussa");
+        }
+    }
+
+    uint32_t saved = cache.requests - cache.bus_reads - cache.bypassed;
+    printf("Jaetut luvut: %lu pyyntöä, %lu väylälle, %lu odotti kesken olevaa, %lu tuoretta, %lu ohi\n",
+           cache.requests, cache.bus_reads, cache.joined, cache.fresh_hits, cache.bypassed);
+    if (cache.requests > 0) {
+        printf("Säästetty %lu väyläpyyntöä (%lu %%)\n", saved, saved * 100 / cache.requests);
+    }
+    return 0;
+}
+
+static void print_lock_hist(const char *name, const uint32_t *hist)
+{
+    printf("    %-6s", name);
+    for (int i = 0; i < LVGL_PORT_LOCK_HIST_BUCKETS; i++) {
+        uint32_t bound = lvgl_port_lock_hist_bound_us(i);
+        if (bound == UINT32_MAX) {
+            printf("  muut:%lu", hist[i]);
+        } else if (bound < 1000) {
+            printf("  <%luus:%lu", bound, hist[i]);
+        } else {
+            printf("  <%lums:%lu", bound / 1000, hist[i]);
+        }
+    }
+    printf("\n");
+}
+
+// lvgl_lock [reset]: LVGL-lukon odotus- ja pitoajat kutsukohdittain
+static int cmd_lvgl_lock(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        lvgl_port_reset_lock_stats();
+        return 0;
+    }
+
+    static lvgl_port_lock_stats_t stats;
+    lvgl_port_get_lock_stats(&stats);
+
+    for (uint32_t i = 0; i < stats.site_count; i++) {
+        const lvgl_port_lock_site_t *site = &stats.sites[i];
+        uint32_t count = site->count ? site->count : 1;
+        printf("%s:%d  %lu lukitusta, %lu aikakatkaisua\n", site->func, site->line, site->count, site->timeouts);
+        printf("    odotus ka %lu us, max %lu us; pito ka %lu us, max %lu us\n",
+               (uint32_t)(site->wait_us_total / count), site->wait_us_max,
+               (uint32_t)(site->hold_us_total / count), site->hold_us_max);
+        print_lock_hist("odotus", site->wait_hist);
+        print_lock_hist("pito", site->hold_hist);
+    }
+    if (stats.site_overflow > 0) {
+        printf("Taulukon ulkopuolisia lukituksia %lu\n", stats.site_overflow);
+    }
+    printf("Yli %d ms pitoja %lu\n", LVGL_PORT_LOCK_WARN_MS, stats.long_holds);
+    if (stats.longest.func) {
+        printf("Pisin pito %lu us: taski %s, %s:%d\n", stats.longest.hold_us, stats.longest.task,
+               stats.longest.func, stats.longest.line);
+    }
+    return 0;
+}
+
+static void print_frame_times(const lvgl_port_frame_stats_t *stats)
+{
+    printf("             ka us    max us\n");
+    printf("kierros  %8lu  %8lu\n", stats->cycle.avg_us, stats->cycle.max_us);
+    printf("piirto   %8lu  %8lu\n", stats->render.avg_us, stats->render.max_us);
+    printf("kopio    %8lu  %8lu\n", stats->copy.avg_us, stats->copy.max_us);
+    printf("vsync    %8lu  %8lu\n", stats->vsync.avg_us, stats->vsync.max_us);
+}
+
+// lvgl_frames: piirtoaikojen jakauma viimeisimmistä kuvista
+static int cmd_lvgl_frames(int argc, char **argv)
+{
+    lvgl_port_frame_stats_t stats;
+    lvgl_port_get_frame_stats(&stats);
+
+    printf("%lu kuvaa, %lu koko näytön kopiota, %lu.%lu kuvaa/s (viimeiset %lu)\n", stats.frames, stats.full_copies,
+           stats.fps_x10 / 10, stats.fps_x10 % 10, stats.window);
+    print_frame_times(&stats);
+    return 0;
+}
+
+#if LVGL_PORT_BENCH
+// lvgl_bench: läpinäkyviä paneeleja koko näytöllä, vertaa repeilynestotiloja
+static int cmd_lvgl_bench(int argc, char **argv)
+{
+#if CONFIG_LV_USE_DEMO_BENCHMARK
+    if (argc > 1 && strcmp(argv[1], "demo") == 0) {
+        // LVGL:n oma testi korvaa näkymän, tulokset näkyvät lopuksi näytöllä
+        lvgl_port_lock(-1);
+        lv_demo_benchmark();
+        lvgl_port_unlock();
+        printf("lv_demo_benchmark käynnissä, käynnistä laite uudelleen lopuksi\n");
+        return 0;
+    }
+#endif
+    int seconds = (argc > 1) ? atoi(argv[1]) : 10;
+    if (seconds < 1 || seconds > 600) {
+        printf("Kesto 1-600 s\n");
+        return 1;
+    }
+
+#if LVGL_PORT_AVOID_TEAR_ENABLE
+    const int mode = LVGL_PORT_AVOID_TEAR_MODE;
+#else
+    const int mode = 0;
+#endif
+    lvgl_port_bench_result_t result;
+    if (lvgl_port_bench_run(seconds * 1000, &result) != ESP_OK) {
+        printf("LVGL ei ole käynnissä\n");
+        return 1;
+    }
+    printf("Repeilynestotila %d: %lu kuvaa %d s:ssa, %lu.%lu kuvaa/s\n", mode, result.frames,
+           seconds, result.fps_x10 / 10, result.fps_x10 % 10);
+    // Tulokseen vaikuttavat käännösasetukset, tools/lvgl_bench.py nimeää rivit näillä
+    printf("Asetukset: kierto %d, nopea sekoitus %d, kaistasekoitus %d\n", EXAMPLE_LVGL_PORT_ROTATION_DEGREE,
+           LVGL_PORT_FAST_BLEND, LVGL_PORT_BAND_BLEND);
+    print_frame_times(&result.stats);
+    return 0;
+}
+#endif
+
+static void register_commands(void)
+{
+    const esp_console_cmd_t cmds[] = {
+        {
+            .command = "log_recent",
+            .help = "Tulosta viimeisimmät testitulokset",
+            .hint = "[n]",
+            .func = &cmd_log_recent,
+        },
+        {
+            .command = "log_export",
+            .help = "Tulosta koko tulosloki CSV-muodossa",
+            .hint = NULL,
+            .func = &cmd_log_export,
+        },
+        {
+            .command = "export",
+            .help = "Siirrä lokin data paloina (CRC jokaisessa palassa), ks. tools/export_logs.py",
+            .hint = "[list | <lähde> [kohta] [max_tavut]]",
+            .func = &cmd_export,
+        },
+        {
+            .command = "bus_config",
+            .help = "Näytä tai aseta RS485-väylän asetukset (tallennetaan NVS:ään)",
+            .hint = "[nopeus] [none|even|odd] [1|2] [rx_puskuri] [tx_puskuri]",
+            .func = &cmd_bus_config,
+        },
+        {
+            .command = "bus_negotiate",
+            .help = "Siirrä laite suurimmalle luotettavalle nopeudelle",
+            .hint = "<slave_id> [rekisteri]",
+            .func = &cmd_bus_negotiate,
+        },
+        {
+            .command = "bus_info",
+            .help = "Näytä laitteen kyvyt ja tunnistetiedot, probe selvittää ne uudelleen",
+            .hint = "<slave_id> [probe]",
+            .func = &cmd_bus_info,
+        },
+        {
+            .command = "bus_stats",
+            .help = "Tulosta Modbus-liikenteen laskurit ja jaettujen lukujen säästö",
+            .hint = NULL,
+            .func = &cmd_bus_stats,
+        },
+        {
+            .command = "lvgl_lock",
+            .help = "Tulosta LVGL-lukon odotus- ja pitoajat kutsukohdittain, reset nollaa ne",
+            .hint = "[reset]",
+            .func = &cmd_lvgl_lock,
+        },
+        {
+            .command = "lvgl_frames",
+            .help = "Tulosta kuvien piirto-, kopio- ja vsync-odotusajat",
+            .hint = NULL,
+            .func = &cmd_lvgl_frames,
+        },
+#if LVGL_PORT_BENCH
+        {
+            .command = "lvgl_bench",
+            .help = "Piirrä läpinäkyviä liukuvärjättyjä paneeleja ja mittaa kuvanopeus",
+            .hint = "[s | demo]",
+            .func = &cmd_lvgl_bench,
+        },
+#endif
+    };
+
+    for (size_t i = 0; i < sizeof(cmds) / sizeof(cmds[0]); i++) {
+        ESP_ERROR_CHECK(esp_console_cmd_register(&cmds[i]));
+    }
+}
+
+esp_err_t console_init(void)
+{
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "paine>";
+    repl_config.task_stack_size = 6144;
+
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    esp_err_t ret = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Konsolin alustus epäonnistui: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    export_register_result_log_sources();
+
+    esp_console_register_help_command();
+    register_commands();
+
+    return esp_console_start_repl(repl);
+}
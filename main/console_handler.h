@@ -0,0 +1,19 @@
+/**
+ * Console Handler Header
+ *
+ * Sarjakonsolin (UART0 / USB) komennot huoltokäyttöön
+ */
+
+#ifndef CONSOLE_HANDLER_H
+#define CONSOLE_HANDLER_H
+
+#include "esp_err.h"
+
+/**
+ * @brief Käynnistää konsolin REPL-taskin ja rekisteröi komennot
+ *
+ * @return esp_err_t ESP_OK jos alustus onnistui, muutoin virhekoodi
+ */
+esp_err_t console_init(void);
+
+#endif /* CONSOLE_HANDLER_H */
@@ -0,0 +1,211 @@
+/**
+ * Export Stream Functions
+ *
+ * Lähteet luetaan pala kerrallaan suoraan flashista/PSRAMista, joten
+ * siirron muistinkulutus on yhden palan verran riippumatta datan määrästä.
+ */
+
+#include "export_stream.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_rom_crc.h"
+#include "result_log.h"
+
+#define EXPORT_MAX_SOURCES      (8)
+
+_Static_assert(RESULT_LOG_RECORD_MAX <= EXPORT_CHUNK_SIZE, "Tuloslokin tietue ei mahdu yhteen palaan");
+
+static const export_source_t *sources[EXPORT_MAX_SOURCES];
+static size_t source_count = 0;
+
+// Pala ja sen base64-koodattu rivi
+static uint8_t chunk_buf[EXPORT_CHUNK_SIZE];
+static char line_buf[((EXPORT_CHUNK_SIZE + 2) / 3) * 4 + 1];
+
+static const char base64_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static size_t base64_encode(const uint8_t *src, size_t len, char *dst)
+{
+    char *p = dst;
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = (src[i] << 16) | (src[i + 1] << 8) | src[i + 2];
+        *p++ = base64_table[(v >> 18) & 0x3F];
+        *p++ = base64_table[(v >> 12) & 0x3F];
+        *p++ = base64_table[(v >> 6) & 0x3F];
+        *p++ = base64_table[v & 0x3F];
+    }
+    if (i < len) {
+        uint32_t v = src[i] << 16;
+        if (i + 1 < len) {
+            v |= src[i + 1] << 8;
+        }
+        *p++ = base64_table[(v >> 18) & 0x3F];
+        *p++ = base64_table[(v >> 12) & 0x3F];
+        *p++ = (i + 1 < len) ? base64_table[(v >> 6) & 0x3F] : '=';
+        *p++ = '=';
+    }
+    *p = '\0';
+    return p - dst;
+}
+
+esp_err_t export_register_source(const export_source_t *source)
+{
+    if (source == NULL || source->name == NULL || source->begin == NULL || source->read == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (source_count >= EXPORT_MAX_SOURCES) {
+        return ESP_ERR_NO_MEM;
+    }
+    sources[source_count++] = source;
+    return ESP_OK;
+}
+
+const export_source_t *export_find_source(const char *name)
+{
+    for (size_t i = 0; i < source_count; i++) {
+        if (strcmp(sources[i]->name, name) == 0) {
+            return sources[i];
+        }
+    }
+    return NULL;
+}
+
+const export_source_t *export_get_source(size_t index)
+{
+    return (index < source_count) ? sources[index] : NULL;
+}
+
+esp_err_t export_stream(const export_source_t *source, uint32_t position, size_t max_bytes)
+{
+    esp_err_t ret = source->begin(position);
+    if (ret != ESP_OK) {
+        printf("#X %s %lu %s\n", source->name, position, esp_err_to_name(ret));
+        return ret;
+    }
+
+    size_t total = 0;
+    while (max_bytes == 0 || total < max_bytes) {
+        uint32_t next = position;
+        int len = source->read(chunk_buf, sizeof(chunk_buf), &next);
+        if (len < 0) {
+            printf("#X %s %lu read\n", source->name, position);
+            return ESP_FAIL;
+        }
+        if (len == 0) {
+            break;
+        }
+
+        uint32_t crc = esp_rom_crc32_le(0, chunk_buf, len);
+        base64_encode(chunk_buf, len, line_buf);
+        printf("#C %s %lu %lu %d %08lx %s\n", source->name, position, next, len, crc, line_buf);
+
+        position = next;
+        total += len;
+    }
+
+    printf("#E %s %lu\n", source->name, position);
+    fflush(stdout);
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------------------
+ * Tuloslokin lähteet
+ * ------------------------------------------------------------------------- */
+
+static result_log_iter_t results_iter;
+static result_log_entry_t results_entry;
+
+// CSV-rivi, joka ei mahtunut edelliseen palaan
+static char csv_line[EXPORT_CHUNK_SIZE];
+static bool csv_line_pending = false;
+static bool csv_header_pending = false;
+
+static esp_err_t results_begin(uint32_t position)
+{
+    result_log_iter_seek(&results_iter, position);
+    return ESP_OK;
+}
+
+// Tietueet sellaisinaan: [otsake][data][CRC32], kohta = järjestysnumero
+static int results_read(uint8_t *buf, size_t max, uint32_t *position)
+{
+    size_t len = 0;
+    uint32_t seq;
+
+    while (len < max) {
+        int n = result_log_iter_next_raw(&results_iter, buf + len, max - len, &seq);
+        if (n <= 0) {
+            // Seuraava tietue ei mahdu tähän palaan, se luetaan seuraavaan
+            break;
+        }
+        len += n;
+        *position = seq + 1;
+    }
+    return (int)len;
+}
+
+static esp_err_t results_csv_begin(uint32_t position)
+{
+    result_log_iter_seek(&results_iter, position);
+    csv_line_pending = false;
+    csv_header_pending = (position == 0);
+    return ESP_OK;
+}
+
+// CSV-rivit, otsikkorivi vain siirron alussa
+static int results_csv_read(uint8_t *buf, size_t max, uint32_t *position)
+{
+    size_t len = 0;
+
+    if (csv_header_pending) {
+        len = snprintf((char *)buf, max, "seq,timestamp,program,outcome,test_pressure,leak_value,curve_interval_ms,curve\n");
+        csv_header_pending = false;
+    }
+
+    while (true) {
+        if (!csv_line_pending) {
+            if (result_log_iter_next(&results_iter, &results_entry) != ESP_OK) {
+                break;
+            }
+            int n = result_log_format_csv(&results_entry, csv_line, sizeof(csv_line));
+            if (n < 0 || (size_t)n >= sizeof(csv_line)) {
+                return -1;
+            }
+            csv_line_pending = true;
+        }
+        size_t line_len = strlen(csv_line);
+        if (len + line_len > max) {
+            if (len == 0) {
+                csv_line_pending = false;
+                return -1;
+            }
+            break;
+        }
+        memcpy(buf + len, csv_line, line_len);
+        len += line_len;
+        csv_line_pending = false;
+        *position = results_entry.seq + 1;
+    }
+    return (int)len;
+}
+
+static const export_source_t results_source = {
+    .name = "results",
+    .description = "Tulosloki binäärinä (tietueet CRC:n kanssa)",
+    .begin = results_begin,
+    .read = results_read,
+};
+
+static const export_source_t results_csv_source = {
+    .name = "results_csv",
+    .description = "Tulosloki CSV-muodossa",
+    .begin = results_csv_begin,
+    .read = results_csv_read,
+};
+
+void export_register_result_log_sources(void)
+{
+    export_register_source(&results_source);
+    export_register_source(&results_csv_source);
+}
@@ -0,0 +1,85 @@
+/**
+ * Export Stream Header
+ *
+ * Lokien ja mittausdatan siirto konsolin kautta paloina. Jokainen pala
+ * tulostetaan omana rivinään:
+ *
+ *   #C <lähde> <kohta> <seuraava kohta> <pituus> <crc32> <base64-data>
+ *
+ * ja siirron lopuksi:
+ *
+ *   #E <lähde> <seuraava kohta>
+ *
+ * Kohta (position) on lähteen oma osoite, esim. tuloslokissa tietueen
+ * järjestysnumero. Siirto voidaan jatkaa mistä tahansa kohdasta, joten
+ * isäntäohjelma pyytää virheellisen palan uudelleen. Katso
+ * tools/export_logs.py.
+ */
+
+#ifndef EXPORT_STREAM_H
+#define EXPORT_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Yhden palan maksimikoko tavuina (ennen base64-koodausta)
+#define EXPORT_CHUNK_SIZE       (4096)
+
+/**
+ * @brief Siirrettävä datalähde
+ */
+typedef struct {
+    const char *name;
+    const char *description;
+
+    /**
+     * @brief Aloittaa lukemisen annetusta kohdasta
+     */
+    esp_err_t (*begin)(uint32_t position);
+
+    /**
+     * @brief Lukee enintään max tavua
+     *
+     * Lähde palauttaa vain kokonaisia tietueita, jotta jokainen pala
+     * alkaa tietueen rajalta ja siirto voidaan jatkaa palan kohdasta.
+     *
+     * @param position Päivitetään seuraavan lukemattoman tietueen kohdaksi
+     * @return int Luettujen tavujen määrä, 0 kun data on loppu, <0 virhe
+     */
+    int (*read)(uint8_t *buf, size_t max, uint32_t *position);
+} export_source_t;
+
+/**
+ * @brief Rekisteröi datalähteen
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM jos lähteitä on liikaa
+ */
+esp_err_t export_register_source(const export_source_t *source);
+
+/**
+ * @brief Hakee lähteen nimellä
+ */
+const export_source_t *export_find_source(const char *name);
+
+/**
+ * @brief Palauttaa lähteen indeksillä (NULL kun lähteet loppuvat)
+ */
+const export_source_t *export_get_source(size_t index);
+
+/**
+ * @brief Tulostaa lähteen datan paloina stdoutiin
+ *
+ * @param source Lähde
+ * @param position Aloituskohta
+ * @param max_bytes Siirrettävän datan yläraja (0 = ei rajaa)
+ * @return esp_err_t ESP_OK kun siirto on valmis
+ */
+esp_err_t export_stream(const export_source_t *source, uint32_t position, size_t max_bytes);
+
+/**
+ * @brief Rekisteröi tuloslokin lähteet ("results" ja "results_csv")
+ */
+void export_register_result_log_sources(void);
+
+#endif /* EXPORT_STREAM_H */
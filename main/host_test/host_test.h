@@ -0,0 +1,64 @@
+/**
+ * Host Test Header
+ *
+ * Yhteiset apufunktiot isäntäkoneen testeille: tarkistus, joka kertoo
+ * rivin ja jatkaa, satunnaisluvut toistettavalla siemenellä ja ajanotto
+ * nopeusvertailuihin (--bench).
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static int host_test_failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (host_test_failures++ < 10) { \
+                printf("%s:%d: ", __FILE__, __LINE__); \
+                printf(__VA_ARGS__); \
+                printf("\n"); \
+            } \
+        } \
+    } while (0)
+
+// xorshift32, sama sarja joka ajolla
+static uint32_t host_test_seed = 0x12345678u;
+
+static inline uint32_t rnd(void)
+{
+    host_test_seed ^= host_test_seed << 13;
+    host_test_seed ^= host_test_seed >> 17;
+    host_test_seed ^= host_test_seed << 5;
+    return host_test_seed;
+}
+
+static inline double now_s(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static inline int is_bench(int argc, char **argv)
+{
+    return argc > 1 && strcmp(argv[1], "--bench") == 0;
+}
+
+// Tulostaa yhteenvedon ja palauttaa prosessin paluuarvon
+static inline int host_test_result(const char *name, long cases)
+{
+    if (host_test_failures) {
+        printf("%s: %d virhettä (%ld tapausta)\n", name, host_test_failures, cases);
+        return 1;
+    }
+    printf("%s: OK (%ld tapausta)\n", name, cases);
+    return 0;
+}
+
+#endif /* HOST_TEST_H */
@@ -0,0 +1,25 @@
+/**
+ * LVGL Host Header
+ *
+ * LVGL:n ohjelmistopiirto isäntäkoneella lvgl_blend.c:n vertailuun.
+ * lvgl_host-kirjastossa on vain sekoituksen ja kirjainten piirron osat;
+ * näyttönä on yksi 800 pikselin levyinen reunanpehmennetty näyttö.
+ */
+
+#ifndef LVGL_HOST_H
+#define LVGL_HOST_H
+
+#include "lvgl.h"
+#include "src/draw/sw/lv_draw_sw.h"
+
+/**
+ * @brief Alustaa LVGL:n muistin ja näytön, kutsutaan ennen piirtoa
+ */
+void lvgl_host_init(void);
+
+/**
+ * @brief Alustaa sw-piirtokontekstin puskuriin, blend on LVGL:n oma
+ */
+void lvgl_host_ctx_init(lv_draw_sw_ctx_t *ctx, lv_color_t *buf, lv_area_t *buf_area, const lv_area_t *clip);
+
+#endif /* LVGL_HOST_H */
@@ -0,0 +1,8 @@
+/**
+ * ESP-IDF:n esp_attr.h isäntäkoneelle: muistialueattribuutit ovat tyhjiä.
+ */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
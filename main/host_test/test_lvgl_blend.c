@@ -0,0 +1,162 @@
+/**
+ * lvgl_blend.c: vertailu LVGL:n omaan sekoitukseen
+ *
+ * Sama satunnainen piirto tehdään kahteen samaan puskuriin, toiseen
+ * lv_draw_sw_blend_basic()- ja toiseen lvgl_blend()-funktiolla, ja
+ * puskureiden pitää olla pikselilleen samat. Mukana täyttö ja kuva,
+ * läpinäkyvyydet 0-255 (myös LV_OPA_MAX:n ympäristö), maskit, leikkaus
+ * ja alueet puskurin reunoilla. --bench vertaa nopeutta 800x100 alueella
+ * sekä tasaisella että muodon reunaa jäljittelevällä maskilla.
+ */
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "lvgl_host.h"
+#include "lvgl_blend.h"
+
+#define W       64
+#define H       24
+
+static lv_color_t ref[W * H];
+static lv_color_t out[W * H];
+static lv_color_t src[W * H];
+static lv_opa_t mask[W * H];
+
+static long test_random(void)
+{
+    lv_area_t buf_area = { 0, 0, W - 1, H - 1 };
+    long cases = 0;
+
+    for (int round = 0; round < 100000; round++, cases++) {
+        // Parittomilla kierroksilla kohde satunnainen, parillisilla enimmäkseen yhtä väriä
+        for (int i = 0; i < W * H; i++) {
+            ref[i].full = (round & 1) ? (uint16_t)rnd() : ((i % 7) ? 0x1234 : (uint16_t)rnd());
+            src[i].full = (uint16_t)rnd();
+            uint32_t m = rnd() % 4;
+            mask[i] = (m == 0) ? LV_OPA_TRANSP : (m == 1) ? LV_OPA_COVER : (lv_opa_t)rnd();
+        }
+        memcpy(out, ref, sizeof(ref));
+
+        lv_area_t blend_area = { rnd() % 20, rnd() % 8, 0, 0 };
+        blend_area.x2 = blend_area.x1 + rnd() % 40;
+        blend_area.y2 = blend_area.y1 + rnd() % 14;
+        const lv_area_t clip = { rnd() % 10, rnd() % 5, W - 1 - rnd() % 10, H - 1 - rnd() % 5 };
+        lv_area_t mask_area = blend_area;
+        if (rnd() % 2) {
+            mask_area.x1 = LV_MAX(0, mask_area.x1 - (lv_coord_t)(rnd() % 3));
+            mask_area.y1 = LV_MAX(0, mask_area.y1 - (lv_coord_t)(rnd() % 2));
+        }
+
+        lv_draw_sw_blend_dsc_t dsc;
+        memset(&dsc, 0, sizeof(dsc));
+        dsc.blend_area = &blend_area;
+        dsc.color.full = (uint16_t)rnd();
+        uint32_t o = rnd() % 5;
+        dsc.opa = (o == 0) ? LV_OPA_COVER : (o == 1) ? 253 : (o == 2) ? 254 : (lv_opa_t)rnd();
+        if (dsc.opa <= LV_OPA_MIN) {
+            dsc.opa = 100;
+        }
+        if (rnd() % 2) {
+            dsc.src_buf = src;
+        }
+        uint32_t masked = rnd() % 3;
+        if (masked) {
+            dsc.mask_buf = mask;
+            dsc.mask_area = &mask_area;
+            dsc.mask_res = (masked == 1) ? LV_DRAW_MASK_RES_CHANGED : LV_DRAW_MASK_RES_FULL_COVER;
+        }
+
+        lv_draw_sw_ctx_t ctx;
+        lvgl_host_ctx_init(&ctx, ref, &buf_area, &clip);
+        lv_draw_sw_blend_basic(&ctx.base_draw, &dsc);
+        ctx.base_draw.buf = out;
+        lvgl_blend(&ctx.base_draw, &dsc);
+
+        int i = 0;
+        while (i < W * H && ref[i].full == out[i].full) {
+            i++;
+        }
+        CHECK(i == W * H, "kierros %d pikseli %d: LVGL %04x, lvgl_blend %04x (opa %d, kuva %d, maski %u)", round, i,
+              ref[i].full, out[i].full, dsc.opa, dsc.src_buf != NULL, masked);
+    }
+    return cases;
+}
+
+static const char *const bench_names[] = { "täyttö", "täyttö maskilla", "kuva", "kuva maskilla" };
+
+static double bench_one(void (*blend)(lv_draw_ctx_t *, const lv_draw_sw_blend_dsc_t *), lv_draw_sw_ctx_t *ctx,
+                        const lv_draw_sw_blend_dsc_t *dsc, int rounds)
+{
+    lv_color_t *buf = ctx->base_draw.buf;
+    double t0 = now_s();
+    for (int r = 0; r < rounds; r++) {
+        buf[r].full ^= 1;                       // Ei samaa syötettä joka kierroksella
+        blend(&ctx->base_draw, dsc);
+    }
+    return now_s() - t0;
+}
+
+static void bench(void)
+{
+    enum { BW = 800, BH = 100, ROUNDS = 300, REPEATS = 10 };
+    static lv_color_t buf[BW * BH];
+    static lv_color_t image[BW * BH];
+    static lv_opa_t flat_mask[BW * BH];
+    static lv_opa_t shape_mask[BW * BH];
+    lv_area_t area = { 0, 0, BW - 1, BH - 1 };
+
+    lvgl_host_init();
+    for (int i = 0; i < BW * BH; i++) {
+        buf[i].full = (uint16_t)rnd();
+        image[i].full = (uint16_t)rnd();
+        flat_mask[i] = (lv_opa_t)rnd();
+    }
+    // Muodon maski: ulkona 0, reunalla 8 pikselin liuku, sisällä 255
+    for (int y = 0; y < BH; y++) {
+        for (int x = 0; x < BW; x++) {
+            int e = x - 100 - y;
+            shape_mask[y * BW + x] = (e < 0) ? 0 : (e < 8) ? e * 32 : (x > 700) ? 0 : 255;
+        }
+    }
+
+    const double mpx = (double)BW * BH * ROUNDS * REPEATS / 1e6;
+    for (int shape = 0; shape < 2; shape++) {
+        for (int k = 0; k < 4; k++) {
+            if (shape && !(k & 1)) {
+                continue;
+            }
+            lv_draw_sw_ctx_t ctx;
+            lvgl_host_ctx_init(&ctx, buf, &area, &area);
+            lv_draw_sw_blend_dsc_t dsc;
+            memset(&dsc, 0, sizeof(dsc));
+            dsc.blend_area = &area;
+            dsc.color.full = 0x8410;
+            dsc.opa = shape ? LV_OPA_COVER : LV_OPA_50;
+            dsc.src_buf = (k >= 2) ? image : NULL;
+            if (k & 1) {
+                dsc.mask_buf = shape ? shape_mask : flat_mask;
+                dsc.mask_area = &area;
+                dsc.mask_res = LV_DRAW_MASK_RES_CHANGED;
+            }
+            // Vuorotellen, ettei kellotaajuuden muutos suosi kumpaakaan
+            double t_lvgl = 0, t_ours = 0;
+            for (int rep = 0; rep < REPEATS; rep++) {
+                t_lvgl += bench_one(lv_draw_sw_blend_basic, &ctx, &dsc, ROUNDS);
+                t_ours += bench_one(lvgl_blend, &ctx, &dsc, ROUNDS);
+            }
+            printf("%-6s %-16s LVGL %7.1f Mpx/s   lvgl_blend %7.1f Mpx/s\n", shape ? "muoto" : "tasa",
+                   bench_names[k], mpx / t_lvgl, mpx / t_ours);
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (is_bench(argc, argv)) {
+        bench();
+        return 0;
+    }
+    lvgl_host_init();
+    long cases = test_random();
+    return host_test_result("lvgl_blend", cases);
+}
@@ -0,0 +1,122 @@
+/**
+ * lvgl_blend.c: kirjainten piirron vertailu LVGL:n omaan
+ *
+ * Sama satunnainen kirjain piirretään kahteen samaan puskuriin, toiseen
+ * lv_draw_sw_letter()- ja toiseen lvgl_blend_letter()-funktiolla, ja
+ * puskureiden pitää olla pikselilleen samat. Fontteina laitteen Roboto
+ * 14, 20 ja 45, mukana ääkköset, puuttuva merkki, läpinäkyvyydet ja
+ * leikkaus puskurin reunoilla. --bench vertaa aikaa merkkiä kohden.
+ */
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "lvgl_host.h"
+#include "lvgl_blend.h"
+
+#define W       120
+#define H       70
+
+extern const lv_font_t roboto_14;
+extern const lv_font_t roboto_20;
+extern const lv_font_t roboto_45;
+
+static const lv_font_t *const fonts[] = { &roboto_14, &roboto_20, &roboto_45 };
+static const int font_sizes[] = { 14, 20, 45 };
+
+static lv_color_t ref[W * H];
+static lv_color_t out[W * H];
+
+static long test_random(void)
+{
+    lv_area_t buf_area = { 0, 0, W - 1, H - 1 };
+    long cases = 0;
+
+    for (int round = 0; round < 20000; round++, cases++) {
+        // Parittomilla kierroksilla tausta satunnainen, parillisilla yhtä väriä
+        for (int i = 0; i < W * H; i++) {
+            ref[i].full = (round & 1) ? (uint16_t)rnd() : 0x2945;
+        }
+        memcpy(out, ref, sizeof(ref));
+
+        const lv_area_t clip = { rnd() % 30, rnd() % 20, W - 1 - rnd() % 30, H - 1 - rnd() % 20 };
+        lv_draw_label_dsc_t dsc;
+        lv_draw_label_dsc_init(&dsc);
+        const int f = rnd() % 3;
+        dsc.font = fonts[f];
+        dsc.color.full = (uint16_t)rnd();
+        uint32_t o = rnd() % 5;
+        dsc.opa = (o == 0) ? LV_OPA_COVER : (o == 1) ? 253 : (o == 2) ? 254 : (lv_opa_t)(3 + rnd() % 253);
+
+        // Kirjain voi alkaa puskurin vasemmalta tai yläpuolelta
+        lv_point_t pos = { (lv_coord_t)(rnd() % W) - 20, (lv_coord_t)(rnd() % H) - 30 };
+        uint32_t letter = 32 + rnd() % 95;
+        if (rnd() % 20 == 0) {
+            letter = 0xE4;                      // ä
+        } else if (rnd() % 50 == 0) {
+            letter = 0x4E00;                    // Ei fontissa
+        }
+
+        lv_draw_sw_ctx_t ctx;
+        lvgl_host_ctx_init(&ctx, ref, &buf_area, &clip);
+        lv_draw_sw_letter(&ctx.base_draw, &dsc, &pos, letter);
+        ctx.base_draw.buf = out;
+        lvgl_blend_letter(&ctx.base_draw, &dsc, &pos, letter);
+
+        int i = 0;
+        while (i < W * H && ref[i].full == out[i].full) {
+            i++;
+        }
+        CHECK(i == W * H, "kierros %d pikseli %d,%d: LVGL %04x, lvgl_blend_letter %04x (roboto_%d, opa %d, merkki %u)",
+              round, i % W, i / W, ref[i].full, out[i].full, font_sizes[f], dsc.opa, letter);
+    }
+    return cases;
+}
+
+static double bench_one(void (*draw)(lv_draw_ctx_t *, const lv_draw_label_dsc_t *, const lv_point_t *, uint32_t),
+                        lv_draw_sw_ctx_t *ctx, const lv_draw_label_dsc_t *dsc, const char *text, int rounds)
+{
+    double t0 = now_s();
+    for (int r = 0; r < rounds; r++) {
+        for (const char *c = text; *c; c++) {
+            lv_point_t pos = { (*c * 7) % 60, 2 };
+            draw(&ctx->base_draw, dsc, &pos, (uint8_t)*c);
+        }
+    }
+    return now_s() - t0;
+}
+
+static void bench(void)
+{
+    enum { ROUNDS = 2000, REPEATS = 20 };
+    static const char text[] = "Program 12: Modbus RTU 19200 8N1 - Testaus OK";
+    lv_area_t area = { 0, 0, W - 1, H - 1 };
+
+    const double glyphs = (double)(sizeof(text) - 1) * ROUNDS * REPEATS;
+    for (size_t f = 0; f < sizeof(fonts) / sizeof(fonts[0]); f++) {
+        lv_draw_sw_ctx_t ctx;
+        lvgl_host_ctx_init(&ctx, ref, &area, &area);
+        lv_draw_label_dsc_t dsc;
+        lv_draw_label_dsc_init(&dsc);
+        dsc.font = fonts[f];
+        dsc.color.full = 0xFFFF;
+        // Vuorotellen, ettei kellotaajuuden muutos suosi kumpaakaan
+        double t_lvgl = 0, t_ours = 0;
+        for (int rep = 0; rep < REPEATS; rep++) {
+            t_lvgl += bench_one(lv_draw_sw_letter, &ctx, &dsc, text, ROUNDS);
+            t_ours += bench_one(lvgl_blend_letter, &ctx, &dsc, text, ROUNDS);
+        }
+        printf("roboto_%-3d LVGL %6.1f ns/merkki   lvgl_blend_letter %6.1f ns/merkki\n", font_sizes[f],
+               t_lvgl / glyphs * 1e9, t_ours / glyphs * 1e9);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    lvgl_host_init();
+    if (is_bench(argc, argv)) {
+        bench();
+        return 0;
+    }
+    long cases = test_random();
+    return host_test_result("lvgl_letter", cases);
+}
@@ -0,0 +1,156 @@
+/**
+ * lvgl_rotate.c: vertailu pikseli kerrallaan kiertävään silmukkaan
+ *
+ * Vertailukohta on lvgl_port.c:n alkuperäinen rotate_copy_pixel().
+ * Jokainen kierto ajetaan satunnaisille alueille täyden ruudun ja
+ * parittomankokoisten kehysten päällä, ja koko kohdekehystä verrataan,
+ * joten myös alueen ulkopuolelle osuva kirjoitus näkyy. --bench vertaa
+ * nopeutta koko ruudun ja tyypillisen likaisen alueen kierrossa.
+ */
+
+#include <stdlib.h>
+#include "host_test.h"
+#include "lvgl_rotate.h"
+
+// Alkuperäinen toteutus sellaisenaan
+static void ref_rotate(const uint16_t *from, uint16_t *to, uint16_t x_start, uint16_t y_start, uint16_t x_end,
+                       uint16_t y_end, uint16_t w, uint16_t h, uint16_t rotation)
+{
+    int from_index = 0;
+    int to_index = 0;
+    int to_index_const = 0;
+
+    switch (rotation) {
+    case 90:
+        to_index_const = (w - x_start - 1) * h;
+        for (int from_y = y_start; from_y < y_end + 1; from_y++) {
+            from_index = from_y * w + x_start;
+            to_index = to_index_const + from_y;
+            for (int from_x = x_start; from_x < x_end + 1; from_x++) {
+                *(to + to_index) = *(from + from_index);
+                from_index += 1;
+                to_index -= h;
+            }
+        }
+        break;
+    case 180:
+        to_index_const = h * w - x_start - 1;
+        for (int from_y = y_start; from_y < y_end + 1; from_y++) {
+            from_index = from_y * w + x_start;
+            to_index = to_index_const - from_y * w;
+            for (int from_x = x_start; from_x < x_end + 1; from_x++) {
+                *(to + to_index) = *(from + from_index);
+                from_index += 1;
+                to_index -= 1;
+            }
+        }
+        break;
+    case 270:
+        to_index_const = (x_start + 1) * h - 1;
+        for (int from_y = y_start; from_y < y_end + 1; from_y++) {
+            from_index = from_y * w + x_start;
+            to_index = to_index_const - from_y;
+            for (int from_x = x_start; from_x < x_end + 1; from_x++) {
+                *(to + to_index) = *(from + from_index);
+                from_index += 1;
+                to_index += h;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static const uint16_t rotations[] = { 90, 180, 270 };
+
+static long test_frame(uint16_t w, uint16_t h, int areas)
+{
+    const size_t n = (size_t)w * h;
+    uint16_t *src = malloc(n * sizeof(uint16_t));
+    uint16_t *dst = malloc(n * sizeof(uint16_t));
+    uint16_t *ref = malloc(n * sizeof(uint16_t));
+    long cases = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        src[i] = (uint16_t)rnd();
+    }
+
+    for (size_t r = 0; r < sizeof(rotations) / sizeof(rotations[0]); r++) {
+        for (int a = 0; a <= areas; a++, cases++) {
+            // Ensimmäinen alue on koko kehys, muut satunnaisia
+            uint16_t x1 = 0, y1 = 0, x2 = w - 1, y2 = h - 1;
+            if (a > 0) {
+                x1 = rnd() % w;
+                x2 = x1 + rnd() % (w - x1);
+                y1 = rnd() % h;
+                y2 = y1 + rnd() % (h - y1);
+            }
+            // Sama tausta molempiin, jotta ylimääräiset kirjoitukset erottuvat
+            for (size_t i = 0; i < n; i++) {
+                dst[i] = ref[i] = (uint16_t)(i * 0x9E37u);
+            }
+            ref_rotate(src, ref, x1, y1, x2, y2, w, h, rotations[r]);
+            lvgl_rotate_copy(src, dst, x1, y1, x2, y2, w, h, rotations[r]);
+            size_t i = 0;
+            while (i < n && dst[i] == ref[i]) {
+                i++;
+            }
+            CHECK(i == n, "%ux%u kierto %u alue (%u,%u)-(%u,%u): ero indeksissä %zu", w, h, rotations[r], x1, y1,
+                  x2, y2, i);
+        }
+    }
+
+    free(src);
+    free(dst);
+    free(ref);
+    return cases;
+}
+
+static void bench_area(const uint16_t *src, uint16_t *dst, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2,
+                       uint16_t w, uint16_t h, int rounds, const char *name)
+{
+    const double px = (double)(x2 - x1 + 1) * (y2 - y1 + 1) * rounds / 1e6;
+
+    for (size_t r = 0; r < sizeof(rotations) / sizeof(rotations[0]); r++) {
+        double t0 = now_s();
+        for (int i = 0; i < rounds; i++) {
+            ref_rotate(src, dst, x1, y1, x2, y2, w, h, rotations[r]);
+        }
+        double t1 = now_s();
+        for (int i = 0; i < rounds; i++) {
+            lvgl_rotate_copy(src, dst, x1, y1, x2, y2, w, h, rotations[r]);
+        }
+        double t2 = now_s();
+        printf("%-22s %3u°   pikseli kerrallaan %7.1f Mpx/s   lvgl_rotate_copy %7.1f Mpx/s\n", name, rotations[r],
+               px / (t1 - t0), px / (t2 - t1));
+    }
+}
+
+static void bench(void)
+{
+    enum { W = 800, H = 480 };
+    uint16_t *src = malloc(W * H * sizeof(uint16_t));
+    uint16_t *dst = malloc(W * H * sizeof(uint16_t));
+
+    for (size_t i = 0; i < (size_t)W * H; i++) {
+        src[i] = (uint16_t)rnd();
+    }
+    bench_area(src, dst, 0, 0, W - 1, H - 1, W, H, 200, "koko ruutu 800x480");
+    bench_area(src, dst, 301, 117, 500, 216, W, H, 4000, "alue 200x100");
+
+    free(src);
+    free(dst);
+}
+
+int main(int argc, char **argv)
+{
+    if (is_bench(argc, argv)) {
+        bench();
+        return 0;
+    }
+    long cases = test_frame(800, 480, 40);
+    cases += test_frame(37, 23, 300);
+    cases += test_frame(64, 65, 300);
+    return host_test_result("lvgl_rotate", cases);
+}
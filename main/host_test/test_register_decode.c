@@ -0,0 +1,196 @@
+/**
+ * register_decode.c: vertailu tavu kerrallaan laskettuun tulokseen
+ *
+ * Jokainen muunnos ajetaan parittomasta ja parillisesta offsetista
+ * (vastauksen data alkaa parittomasta), kaikilla määrillä 0-64 ja
+ * molemmilla rekisterijärjestyksillä. --bench vertaa nopeutta
+ * rekisteri kerrallaan tehtyyn muunnokseen (rx[3] << 8) | rx[4].
+ */
+
+#include <math.h>
+#include "host_test.h"
+#include "register_decode.h"
+
+#define MAX_COUNT       64
+
+static uint16_t ref_u16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t ref_u32(const uint8_t *p, word_order_t order)
+{
+    uint32_t first = ref_u16(p);
+    uint32_t second = ref_u16(p + 2);
+    return (order == WORD_ORDER_HIGH_FIRST) ? (first << 16) | second : (second << 16) | first;
+}
+
+static long test_plain(void)
+{
+    uint8_t raw[1 + MAX_COUNT * 4];
+    uint16_t u16[MAX_COUNT + 1];
+    int16_t i16[MAX_COUNT + 1];
+    uint32_t u32[MAX_COUNT + 1];
+    int32_t i32[MAX_COUNT + 1];
+    float f32[MAX_COUNT + 1];
+    long cases = 0;
+
+    for (int round = 0; round < 200; round++) {
+        for (size_t i = 0; i < sizeof(raw); i++) {
+            raw[i] = (uint8_t)rnd();
+        }
+        for (int offset = 0; offset < 2; offset++) {
+            const uint8_t *src = raw + offset;
+            for (size_t count = 0; count <= MAX_COUNT; count++, cases++) {
+                // Vartija: muunnos ei saa kirjoittaa yli count-arvon
+                u16[count] = 0xBEEF;
+                register_decode_u16(src, u16, count);
+                register_decode_i16(src, i16, count);
+                for (size_t i = 0; i < count; i++) {
+                    CHECK(u16[i] == ref_u16(src + i * 2), "u16[%zu] offset %d count %zu", i, offset, count);
+                    CHECK(i16[i] == (int16_t)ref_u16(src + i * 2), "i16[%zu]", i);
+                }
+                CHECK(u16[count] == 0xBEEF, "u16 kirjoitti yli, count %zu", count);
+
+                for (int order = WORD_ORDER_HIGH_FIRST; order <= WORD_ORDER_LOW_FIRST; order++) {
+                    u32[count] = 0xDEADBEEF;
+                    register_decode_u32(src, u32, count, order);
+                    register_decode_i32(src, i32, count, order);
+                    register_decode_f32(src, f32, count, order);
+                    for (size_t i = 0; i < count; i++) {
+                        uint32_t ref = ref_u32(src + i * 4, order);
+                        uint32_t bits;
+                        memcpy(&bits, &f32[i], sizeof(bits));
+                        CHECK(u32[i] == ref, "u32[%zu] order %d: %08x != %08x", i, order, u32[i], ref);
+                        CHECK((uint32_t)i32[i] == ref, "i32[%zu] order %d", i, order);
+                        CHECK(bits == ref, "f32[%zu] order %d", i, order);
+                    }
+                    CHECK(u32[count] == 0xDEADBEEF, "u32 kirjoitti yli, count %zu", count);
+                }
+            }
+        }
+    }
+    return cases;
+}
+
+static long test_scaled(void)
+{
+    static const struct {
+        register_type_t type;
+        uint16_t words;
+    } types[] = {
+        { REG_TYPE_U16, 1 }, { REG_TYPE_I16, 1 }, { REG_TYPE_U32, 2 }, { REG_TYPE_I32, 2 }, { REG_TYPE_F32, 2 },
+    };
+    static const uint16_t scales[] = { 1, 10, 100 };
+    uint8_t raw[1 + MAX_COUNT * 4];
+    float out[MAX_COUNT];
+    long cases = 0;
+
+    for (int round = 0; round < 100; round++) {
+        for (size_t i = 0; i < sizeof(raw); i++) {
+            raw[i] = (uint8_t)rnd();
+        }
+        for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+            for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+                for (int order = WORD_ORDER_HIGH_FIRST; order <= WORD_ORDER_LOW_FIRST; order++, cases++) {
+                    const register_desc_t desc = {
+                        .name = "test", .address = 0, .words = types[t].words, .scale = scales[s],
+                        .type = types[t].type, .access = REG_ACCESS_RO, .poll = REG_POLL_NONE,
+                    };
+                    const uint8_t *src = raw + 1;
+                    size_t n = register_decode_scaled(src, &desc, order, out, MAX_COUNT);
+                    CHECK(n == MAX_COUNT, "scaled palautti %zu", n);
+                    for (size_t i = 0; i < MAX_COUNT; i++) {
+                        const uint8_t *p = src + i * desc.words * 2;
+                        float raw_value;
+                        uint32_t bits = ref_u32(p, order);
+                        switch (desc.type) {
+                            case REG_TYPE_U16: raw_value = ref_u16(p); break;
+                            case REG_TYPE_I16: raw_value = (int16_t)ref_u16(p); break;
+                            case REG_TYPE_U32: raw_value = (float)bits; break;
+                            case REG_TYPE_I32: raw_value = (float)(int32_t)bits; break;
+                            default: memcpy(&raw_value, &bits, sizeof(raw_value)); break;
+                        }
+                        float expected = (desc.scale > 1) ? raw_value * (1.0f / desc.scale) : raw_value;
+                        CHECK((isnan(expected) && isnan(out[i])) || out[i] == expected,
+                              "scaled tyyppi %d skaala %u [%zu]: %g != %g", desc.type, desc.scale, i, out[i], expected);
+                    }
+                }
+            }
+        }
+    }
+
+    // Merkkijonoja ei muunneta
+    const register_desc_t str = { .name = "s", .words = 8, .scale = 1, .type = REG_TYPE_STRING };
+    CHECK(register_decode_scaled(raw, &str, WORD_ORDER_HIGH_FIRST, out, 1) == 0, "merkkijono muunnettiin");
+    return cases + 1;
+}
+
+// Vertailukohta: rekisteri kerrallaan, kuten ennen register_decode.c:tä
+static void __attribute__((noinline)) naive_u16(const uint8_t *src, uint16_t *dst, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = (uint16_t)((src[i * 2] << 8) | src[i * 2 + 1]);
+    }
+}
+
+static void __attribute__((noinline)) naive_u32(const uint8_t *src, uint32_t *dst, size_t count, word_order_t order)
+{
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = ref_u32(src + i * 4, order);
+    }
+}
+
+static void bench(void)
+{
+    enum { REGS = 125, ROUNDS = 200000 };       // Yksi täysi FC 0x03 -vastaus
+    static uint8_t raw[1 + REGS * 2];
+    static uint16_t u16[REGS];
+    static uint32_t u32[REGS / 2];
+    volatile uint32_t sink = 0;
+
+    for (size_t i = 0; i < sizeof(raw); i++) {
+        raw[i] = (uint8_t)rnd();
+    }
+    const uint8_t *src = raw + 1;
+
+    double t0 = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+        naive_u16(src, u16, REGS);
+        sink += u16[r % REGS];
+    }
+    double t1 = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+        register_decode_u16(src, u16, REGS);
+        sink += u16[r % REGS];
+    }
+    double t2 = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+        naive_u32(src, u32, REGS / 2, WORD_ORDER_LOW_FIRST);
+        sink += u32[r % (REGS / 2)];
+    }
+    double t3 = now_s();
+    for (int r = 0; r < ROUNDS; r++) {
+        register_decode_u32(src, u32, REGS / 2, WORD_ORDER_LOW_FIRST);
+        sink += u32[r % (REGS / 2)];
+    }
+    double t4 = now_s();
+
+    const double regs = (double)REGS * ROUNDS / 1e6;
+    printf("u16 (125 rekisteriä)   rekisteri kerrallaan %7.1f Mreg/s   register_decode %7.1f Mreg/s\n",
+           regs / (t1 - t0), regs / (t2 - t1));
+    printf("u32 CDAB (62 arvoa)    rekisteri kerrallaan %7.1f Mreg/s   register_decode %7.1f Mreg/s\n",
+           regs / (t3 - t2), regs / (t4 - t3));
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    if (is_bench(argc, argv)) {
+        bench();
+        return 0;
+    }
+    long cases = test_plain();
+    cases += test_scaled();
+    return host_test_result("register_decode", cases);
+}
@@ -0,0 +1,285 @@
+/**
+ * LVGL Blend Functions
+ *
+ * RGB565-pikselin R- ja B-kanava puretaan samaan sanaan 16 bitin välein,
+ * joten yksi kertolasku sekoittaa molemmat; G lasketaan erikseen. LVGL:n
+ * jakolasku LV_UDIV255(x) on sama kuin (x + 1 + (x >> 8)) >> 8 kaikilla
+ * x < 65535, ja sen voi laskea molemmille kentille kerralla. Pikseliin
+ * tarvitaan näin 2-4 kertolaskua LVGL:n 6-9:n sijaan.
+ *
+ * Maskin kanssa aika kuluu maskin lukemiseen eikä sekoitukseen: samalla
+ * tavalla kirjoitetut ytimet eivät olleet LVGL:ää nopeampia, joten ne
+ * jäävät LVGL:lle.
+ */
+
+#include "lvgl_blend.h"
+
+#if LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP == 0 && LV_COLOR_MIX_ROUND_OFS != 0
+#define BLEND_RGB565    1
+#else
+#define BLEND_RGB565    0
+#endif
+
+#if BLEND_RGB565
+#define RB_FIELDS       (0x00010001u)                   // Yksi kummassakin kentässä
+#define RB_MASK         (0x001F001Fu)
+
+// R bitteihin 16-20, B bitteihin 0-4
+static inline uint32_t rb_unpack(uint16_t c)
+{
+    return ((uint32_t)(c & 0xF800) << 5) | (c & 0x001F);
+}
+
+static inline uint32_t g_unpack(uint16_t c)
+{
+    return (c >> 5) & 0x3F;
+}
+
+// fg_rb ja fg_g on jo kerrottu sekoitussuhteella, inv = 255 - suhde
+static inline uint16_t mix_premult(uint32_t fg_rb, uint32_t fg_g, uint16_t bg, uint32_t inv)
+{
+    uint32_t rb = fg_rb + rb_unpack(bg) * inv + LV_COLOR_MIX_ROUND_OFS * RB_FIELDS;
+    uint32_t g = fg_g + g_unpack(bg) * inv + LV_COLOR_MIX_ROUND_OFS;
+    rb = ((rb + RB_FIELDS + ((rb >> 8) & 0x00FF00FFu)) >> 8) & RB_MASK;
+    g = (g + 1 + (g >> 8)) >> 8;
+    return (uint16_t)(((rb >> 5) & 0xF800) | (g << 5) | (rb & 0x001F));
+}
+
+static void LV_ATTRIBUTE_FAST_MEM swar_fill_opa(lv_color_t *dest, lv_coord_t dest_stride, lv_coord_t w,
+                                                lv_coord_t h, lv_color_t color, lv_opa_t opa)
+{
+    const uint32_t fg_rb = rb_unpack(color.full) * opa;
+    const uint32_t fg_g = g_unpack(color.full) * opa;
+    const uint32_t inv = 255 - opa;
+
+    // Tausta on usein yksivärinen: edellinen tulos käy, jos kohde ei muutu
+    uint16_t last_dest = dest[0].full;
+    uint16_t last_res = mix_premult(fg_rb, fg_g, last_dest, inv);
+    for (lv_coord_t y = 0; y < h; y++) {
+        uint16_t *d = (uint16_t *)dest;
+        for (lv_coord_t x = 0; x < w; x++) {
+            if (d[x] != last_dest) {
+                last_dest = d[x];
+                last_res = mix_premult(fg_rb, fg_g, last_dest, inv);
+            }
+            d[x] = last_res;
+        }
+        dest += dest_stride;
+    }
+}
+
+static void LV_ATTRIBUTE_FAST_MEM swar_map_opa(lv_color_t *dest, lv_coord_t dest_stride, const lv_color_t *src,
+                                               lv_coord_t src_stride, lv_coord_t w, lv_coord_t h, lv_opa_t opa)
+{
+    const uint32_t inv = 255 - opa;
+    for (lv_coord_t y = 0; y < h; y++) {
+        uint16_t *d = (uint16_t *)dest;
+        const uint16_t *s = (const uint16_t *)src;
+        for (lv_coord_t x = 0; x < w; x++) {
+            d[x] = mix_premult(rb_unpack(s[x]) * opa, g_unpack(s[x]) * opa, d[x], inv);
+        }
+        dest += dest_stride;
+        src += src_stride;
+    }
+}
+
+const lvgl_blend_backend_t lvgl_blend_swar = {
+    .fill_opa = swar_fill_opa,
+    .fill_mask = NULL,                                  // Maskin luku maksaa enemmän kuin sekoitus, LVGL riittää
+    .map_opa = swar_map_opa,
+    .map_mask = NULL,
+};
+
+static const lvgl_blend_backend_t *backend = &lvgl_blend_swar;
+
+/**
+ * 4-bittisen kirjaimen värisävyt valmiiksi kerrottuina. LVGL kertoo
+ * läpinäkyvyyden ensin maskiin ja sitten uudestaan sekoituksessa; sama
+ * tehdään tässä taulukkoon, jotta tulos on sama pikselilleen.
+ */
+typedef struct {
+    uint32_t rb[16];
+    uint32_t g[16];
+    uint8_t inv[16];
+    lv_color_t color;
+    lv_opa_t opa;
+    bool valid;
+} letter_table_t;
+
+static letter_table_t letter_table;                     // Vain LVGL-tehtävä piirtää kirjaimia
+
+static const letter_table_t *letter_table_get(lv_color_t color, lv_opa_t opa)
+{
+    letter_table_t *t = &letter_table;
+    if (t->valid && t->color.full == color.full && t->opa == opa) {
+        return t;
+    }
+    for (uint32_t n = 0; n < 16; n++) {
+        uint32_t a = n * 17;                            // _lv_bpp4_opa_table
+        if (opa < LV_OPA_MAX) {
+            a = (a == LV_OPA_COVER) ? opa : (a * opa) >> 8;                         // draw_letter_normal
+            a = (a == 0) ? 0 : (a == LV_OPA_COVER) ? opa : (a * opa) >> 8;          // fill_normal
+        }
+        t->rb[n] = rb_unpack(color.full) * a;
+        t->g[n] = g_unpack(color.full) * a;
+        t->inv[n] = 255 - a;
+    }
+    t->color = color;
+    t->opa = opa;
+    t->valid = true;
+    return t;
+}
+
+static inline void letter_px(uint16_t *d, uint32_t n, const letter_table_t *t)
+{
+    if (n == 0) {
+        return;
+    }
+    *d = (t->inv[n] == 0) ? t->color.full : mix_premult(t->rb[n], t->g[n], *d, t->inv[n]);
+}
+#endif /* BLEND_RGB565 */
+
+void lvgl_blend_set_backend(const lvgl_blend_backend_t *new_backend)
+{
+#if BLEND_RGB565
+    backend = new_backend ? new_backend : &lvgl_blend_swar;
+#endif
+}
+
+void LV_ATTRIBUTE_FAST_MEM lvgl_blend(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc)
+{
+#if BLEND_RGB565
+    const lv_opa_t *mask = dsc->mask_buf;
+    if (mask && dsc->mask_res == LV_DRAW_MASK_RES_TRANSP) {
+        return;
+    }
+    if (dsc->mask_res == LV_DRAW_MASK_RES_FULL_COVER) {
+        mask = NULL;
+    }
+
+    // Peittävä täyttö ja kopio ovat LVGL:ssä jo pelkkää kirjoitusta; erikoistilat jäävät LVGL:lle
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    if ((!mask && dsc->opa >= LV_OPA_MAX) || dsc->blend_mode != LV_BLEND_MODE_NORMAL ||
+            disp->driver->set_px_cb || disp->driver->screen_transp || (mask && !disp->driver->antialiasing)) {
+        lv_draw_sw_blend_basic(draw_ctx, dsc);
+        return;
+    }
+
+    // Tyhjä paikka taustaosassa tarkoittaa LVGL:n omaa sekoitusta
+    if (dsc->src_buf ? (mask ? !backend->map_mask : !backend->map_opa) :
+            (mask ? !backend->fill_mask : !backend->fill_opa)) {
+        lv_draw_sw_blend_basic(draw_ctx, dsc);
+        return;
+    }
+
+    lv_area_t blend_area;
+    if (!_lv_area_intersect(&blend_area, dsc->blend_area, draw_ctx->clip_area)) {
+        return;
+    }
+    const lv_coord_t w = lv_area_get_width(&blend_area);
+    const lv_coord_t h = lv_area_get_height(&blend_area);
+    const lv_coord_t dest_stride = lv_area_get_width(draw_ctx->buf_area);
+    lv_color_t *dest = (lv_color_t *)draw_ctx->buf + dest_stride * (blend_area.y1 - draw_ctx->buf_area->y1) +
+                       (blend_area.x1 - draw_ctx->buf_area->x1);
+
+    lv_coord_t mask_stride = 0;
+    if (mask) {
+        mask_stride = lv_area_get_width(dsc->mask_area);
+        mask += mask_stride * (blend_area.y1 - dsc->mask_area->y1) + (blend_area.x1 - dsc->mask_area->x1);
+    }
+
+    if (dsc->src_buf) {
+        const lv_coord_t src_stride = lv_area_get_width(dsc->blend_area);
+        const lv_color_t *src = dsc->src_buf + src_stride * (blend_area.y1 - dsc->blend_area->y1) +
+                                (blend_area.x1 - dsc->blend_area->x1);
+        if (mask) {
+            backend->map_mask(dest, dest_stride, src, src_stride, w, h, dsc->opa, mask, mask_stride);
+        } else {
+            backend->map_opa(dest, dest_stride, src, src_stride, w, h, dsc->opa);
+        }
+    } else if (mask) {
+        backend->fill_mask(dest, dest_stride, w, h, dsc->color, dsc->opa, mask, mask_stride);
+    } else {
+        backend->fill_opa(dest, dest_stride, w, h, dsc->color, dsc->opa);
+    }
+#else
+    lv_draw_sw_blend_basic(draw_ctx, dsc);
+#endif
+}
+
+void LV_ATTRIBUTE_FAST_MEM lvgl_blend_letter(lv_draw_ctx_t *draw_ctx, const lv_draw_label_dsc_t *dsc,
+                                             const lv_point_t *pos_p, uint32_t letter)
+{
+#if BLEND_RGB565
+    // Puuttuvat merkit, muut bittisyydet ja erikoistilat jäävät LVGL:lle
+    lv_font_glyph_dsc_t g;
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    if (dsc->blend_mode != LV_BLEND_MODE_NORMAL || dsc->opa <= LV_OPA_MIN || disp->driver->set_px_cb ||
+            disp->driver->screen_transp || !disp->driver->antialiasing ||
+            !lv_font_get_glyph_dsc(dsc->font, &g, letter, '\0') || g.bpp != 4 || g.resolved_font->subpx) {
+        lv_draw_sw_letter(draw_ctx, dsc, pos_p, letter);
+        return;
+    }
+    if (g.box_w == 0 || g.box_h == 0) {
+        return;
+    }
+
+    lv_area_t glyph_area;
+    glyph_area.x1 = pos_p->x + g.ofs_x;
+    glyph_area.y1 = pos_p->y + (dsc->font->line_height - dsc->font->base_line) - g.box_h - g.ofs_y;
+    glyph_area.x2 = glyph_area.x1 + g.box_w - 1;
+    glyph_area.y2 = glyph_area.y1 + g.box_h - 1;
+    lv_area_t area;
+    if (!_lv_area_intersect(&area, &glyph_area, draw_ctx->clip_area)) {
+        return;
+    }
+    const uint8_t *map_p = lv_font_get_glyph_bitmap(g.resolved_font, letter);
+#if LV_DRAW_COMPLEX
+    const bool masked = lv_draw_mask_is_any(&area);
+#else
+    const bool masked = false;
+#endif
+    if (map_p == NULL || masked) {
+        lv_draw_sw_letter(draw_ctx, dsc, pos_p, letter);
+        return;
+    }
+
+    // Kaksi pikseliä tavussa, ylempi puolisko ensin; tyhjät ja täydet tavut ovat tavallisimmat
+    const letter_table_t *t = letter_table_get(dsc->color, dsc->opa);
+    const uint16_t c = dsc->color.full;
+    const bool cover = (t->inv[15] == 0);
+    const lv_coord_t w = lv_area_get_width(&area);
+    const lv_coord_t dest_stride = lv_area_get_width(draw_ctx->buf_area);
+    uint16_t *dest = (uint16_t *)draw_ctx->buf + dest_stride * (area.y1 - draw_ctx->buf_area->y1) +
+                     (area.x1 - draw_ctx->buf_area->x1);
+    uint32_t nibble = (area.y1 - glyph_area.y1) * g.box_w + (area.x1 - glyph_area.x1);
+    for (lv_coord_t y = area.y1; y <= area.y2; y++) {
+        const uint8_t *m = map_p + (nibble >> 1);
+        lv_coord_t x = 0;
+        if (nibble & 1) {
+            letter_px(&dest[0], *m++ & 0x0F, t);
+            x = 1;
+        }
+        for (; x + 2 <= w; x += 2) {
+            const uint8_t b = *m++;
+            if (b == 0) {
+                continue;
+            }
+            if (b == 0xFF && cover) {
+                dest[x] = c;
+                dest[x + 1] = c;
+                continue;
+            }
+            letter_px(&dest[x], b >> 4, t);
+            letter_px(&dest[x + 1], b & 0x0F, t);
+        }
+        if (x < w) {
+            letter_px(&dest[x], *m >> 4, t);
+        }
+        dest += dest_stride;
+        nibble += g.box_w;
+    }
+#else
+    lv_draw_sw_letter(draw_ctx, dsc, pos_p, letter);
+#endif
+}
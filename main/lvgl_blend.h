@@ -0,0 +1,63 @@
+/**
+ * LVGL Blend Header
+ *
+ * LVGL:n ohjelmistopiirron sekoitus (lv_draw_sw_blend_basic) RGB565-
+ * ytimillä. lvgl_blend() korvaa draw-kontekstin blend-funktion: tavallinen
+ * sekoitustila läpinäkyvyydellä tai maskilla ajetaan valitun taustaosan
+ * (backend) ytimillä, kaikki muu LVGL:n omalla koodilla. Lisäksi
+ * lvgl_blend_letter() piirtää 4-bittiset kirjaimet suoraan puskuriin.
+ *
+ * Ytimet tuottavat täsmälleen samat pikselit kuin LVGL, kun
+ * LV_COLOR_DEPTH on 16, LV_COLOR_16_SWAP 0 ja LV_COLOR_MIX_ROUND_OFS
+ * nollasta poikkeava. Muuten lvgl_blend() kutsuu aina LVGL:n sekoitusta.
+ */
+
+#ifndef LVGL_BLEND_H
+#define LVGL_BLEND_H
+
+#include "lvgl.h"
+#include "src/draw/sw/lv_draw_sw.h"
+
+/**
+ * Sekoitusytimet. Osoittimet on jo siirretty alueen alkuun, leveydet ja
+ * rivivälit ovat pikseleinä. Maskin 0 jättää kohteen ennalleen. NULL
+ * jättää tapauksen LVGL:lle.
+ */
+typedef struct {
+    // Täyttö värillä, läpinäkyvyys alle LV_OPA_MAX
+    void (*fill_opa)(lv_color_t *dest, lv_coord_t dest_stride, lv_coord_t w, lv_coord_t h,
+                     lv_color_t color, lv_opa_t opa);
+    // Täyttö värillä maskin läpi
+    void (*fill_mask)(lv_color_t *dest, lv_coord_t dest_stride, lv_coord_t w, lv_coord_t h,
+                      lv_color_t color, lv_opa_t opa, const lv_opa_t *mask, lv_coord_t mask_stride);
+    // Kuvan sekoitus, läpinäkyvyys alle LV_OPA_MAX
+    void (*map_opa)(lv_color_t *dest, lv_coord_t dest_stride, const lv_color_t *src, lv_coord_t src_stride,
+                    lv_coord_t w, lv_coord_t h, lv_opa_t opa);
+    // Kuvan sekoitus maskin läpi
+    void (*map_mask)(lv_color_t *dest, lv_coord_t dest_stride, const lv_color_t *src, lv_coord_t src_stride,
+                     lv_coord_t w, lv_coord_t h, lv_opa_t opa, const lv_opa_t *mask, lv_coord_t mask_stride);
+} lvgl_blend_backend_t;
+
+// Kannettava C-toteutus, kaksi värikanavaa yhdellä 32-bittisellä kertolaskulla (ei maskeja)
+extern const lvgl_blend_backend_t lvgl_blend_swar;
+
+/**
+ * Valitse ytimet, NULL palauttaa oletuksen (lvgl_blend_swar). Vaihda vain
+ * LVGL-lukon alla, ettei piirto ole kesken.
+ */
+void lvgl_blend_set_backend(const lvgl_blend_backend_t *backend);
+
+/**
+ * Korvaa lv_draw_sw_ctx_t:n blend-funktion
+ */
+void lvgl_blend(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc);
+
+/**
+ * Korvaa draw-kontekstin draw_letter-funktion. 4-bittiset kirjaimet
+ * sekoitetaan suoraan fontin bittikartasta ilman välimaskia, kun piirtoon
+ * ei ole maskeja; muut kulkevat lv_draw_sw_letter()-funktion kautta.
+ */
+void lvgl_blend_letter(lv_draw_ctx_t *draw_ctx, const lv_draw_label_dsc_t *dsc, const lv_point_t *pos_p,
+                       uint32_t letter);
+
+#endif // LVGL_BLEND_H
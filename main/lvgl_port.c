@@ -7,18 +7,598 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include <string.h>
 #include "esp_lcd_panel_ops.h"
 #include "esp_lcd_panel_rgb.h"
 #include "esp_lcd_touch.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "lvgl.h"
 #include "lvgl_port.h"
+#if LVGL_PORT_ASYNC_COPY
+#include "esp_async_memcpy.h"
+#include "esp_cache.h"
+#endif
+#if LVGL_PORT_BAND_BLEND || LVGL_PORT_FAST_BLEND
+#include "src/draw/sw/lv_draw_sw.h"
+#endif
+#if LVGL_PORT_FAST_BLEND
+#include "lvgl_blend.h"
+#endif
+#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0
+#include "lvgl_rotate.h"
+#endif
 
 static const char *TAG = "lv_port";                      // Tag for logging
 static SemaphoreHandle_t lvgl_mux;                       // LVGL mutex for synchronization
 static TaskHandle_t lvgl_task_handle = NULL;             // Handle for the LVGL task
 
+/*
+ * The LVGL task sleeps until its next LVGL timer is due, or until it is woken through notification index
+ * `LVGL_PORT_WAKE_INDEX`. Index 0 is left to the vsync notification of the RGB driver.
+ */
+#define LVGL_PORT_WAKE_INDEX        (1)
+_Static_assert(LVGL_PORT_WAKE_INDEX < configTASK_NOTIFICATION_ARRAY_ENTRIES,
+               "CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES must be at least 2");
+
+static bool touch_irq_enabled = false;                   // Touch controller interrupt is wired, see touch_isr()
+static uint8_t touch_irq_pending = false;                // Set by touch_isr(), consumed by the LVGL task
+
+void lvgl_port_wake(void)
+{
+    TaskHandle_t task = lvgl_task_handle;
+    if (task && task != xTaskGetCurrentTaskHandle()) {
+        xTaskNotifyGiveIndexed(task, LVGL_PORT_WAKE_INDEX);
+    }
+}
+
+IRAM_ATTR static void touch_isr(esp_lcd_touch_handle_t tp)
+{
+    BaseType_t need_yield = pdFALSE;
+
+    __atomic_store_n(&touch_irq_pending, true, __ATOMIC_RELEASE);
+    if (lvgl_task_handle) {
+        vTaskNotifyGiveIndexedFromISR(lvgl_task_handle, LVGL_PORT_WAKE_INDEX, &need_yield);
+    }
+    portYIELD_FROM_ISR(need_yield);
+}
+
+/*
+ * Frame timing. A pinned LVGL task is timed with the CPU cycle counter; an unpinned task could move between cores
+ * within a frame, so it falls back to the microsecond timer.
+ */
+#if LVGL_PORT_TASK_CORE >= 0
+#define FRAME_CLOCK()               esp_cpu_get_cycle_count()
+#define FRAME_CLOCK_PER_US          (CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ)
+#else
+#define FRAME_CLOCK()               ((uint32_t)esp_timer_get_time())
+#define FRAME_CLOCK_PER_US          (1)
+#endif
+
+typedef struct {
+    uint32_t cycle;                                      // Whole lv_timer_handler() call, in FRAME_CLOCK ticks
+    uint32_t copy;                                       // Copies between frame buffers
+    uint32_t vsync;                                      // Waiting for the frame buffer switch
+    int64_t end_us;                                      // When the frame was done, for the frame rate
+} frame_time_t;
+
+static frame_time_t frame_cur;                           // Frame being rendered, LVGL task only
+static bool frame_rendered;                              // Set by monitor_cb when lv_timer_handler() drew a frame
+static frame_time_t frame_window[LVGL_PORT_FRAME_WINDOW];
+static uint32_t frame_count;
+static uint32_t frame_full_copies;
+static portMUX_TYPE frame_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static inline void frame_add_copy(uint32_t start)
+{
+    frame_cur.copy += FRAME_CLOCK() - start;
+}
+
+static void frame_begin(void)
+{
+    frame_cur.copy = 0;
+    frame_cur.vsync = 0;
+    frame_rendered = false;
+}
+
+static void frame_end(uint32_t start)
+{
+    if (!frame_rendered) {
+        return; // Timers only, nothing was drawn
+    }
+    frame_cur.cycle = FRAME_CLOCK() - start;
+    frame_cur.end_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&frame_mux);
+    frame_window[frame_count % LVGL_PORT_FRAME_WINDOW] = frame_cur;
+    frame_count++;
+    taskEXIT_CRITICAL(&frame_mux);
+}
+
+static void frame_monitor_cb(lv_disp_drv_t *drv, uint32_t time, uint32_t px)
+{
+    frame_rendered = true;
+}
+
+// Timed wrapper of the draw context's buffer copy, which LVGL uses to sync the two buffers in direct mode
+static void (*frame_sw_buffer_copy)(lv_draw_ctx_t *draw_ctx, void *dest_buf, lv_coord_t dest_stride,
+                                    const lv_area_t *dest_area, void *src_buf, lv_coord_t src_stride,
+                                    const lv_area_t *src_area);
+
+static void frame_timed_buffer_copy(lv_draw_ctx_t *draw_ctx, void *dest_buf, lv_coord_t dest_stride,
+                                    const lv_area_t *dest_area, void *src_buf, lv_coord_t src_stride,
+                                    const lv_area_t *src_area)
+{
+    uint32_t start = FRAME_CLOCK();
+    frame_sw_buffer_copy(draw_ctx, dest_buf, dest_stride, dest_area, src_buf, src_stride, src_area);
+    frame_add_copy(start);
+}
+
+#if LVGL_PORT_ASYNC_COPY
+/*
+ * Direct mode buffer sync with the async memcpy (GDMA). Before rendering a frame LVGL copies the areas drawn in the
+ * previous frame from the buffer on screen into the buffer it renders into, minus the areas it is about to redraw. The
+ * rendering never touches the copied areas, so the copy runs while LVGL renders and only has to be finished before the
+ * buffer goes to the panel (`async_copy_wait()` in the flush callback).
+ *
+ * The frame buffers sit behind the data cache and the RGB driver reads them through it (bounce buffers), so they are
+ * never written back on their own. The DMA therefore only copies whole cache lines of each row, after the source has
+ * been written back and the destination written back and invalidated. The few bytes at each end of a row share a cache
+ * line with pixels the CPU is rendering and are copied by the CPU. Transfers are queued to a task on the other core,
+ * which keeps up to `ASYNC_COPY_BACKLOG` of them in flight.
+ */
+#define ASYNC_COPY_JOBS             (32)                 // Queued areas, power of two
+#define ASYNC_COPY_BACKLOG          (8)                  // Transfers in flight
+#define ASYNC_COPY_TASK_STACK       (3 * 1024)
+
+typedef struct {
+    lv_area_t area;                                      // Area being copied, to keep overlapping areas in order
+    uint8_t *dst;
+    const uint8_t *src;
+    uint32_t len;                                        // Bytes per transfer
+    uint32_t dst_stride;                                 // Bytes between transfers
+    uint32_t src_stride;
+    uint32_t count;                                      // Transfers
+} async_copy_job_t;
+
+static async_memcpy_handle_t async_copy_engine;          // NULL if the engine could not be installed
+static size_t async_copy_align;                          // Cache line size of PSRAM
+static TaskHandle_t async_copy_task_handle;
+static SemaphoreHandle_t async_copy_slots;               // Counts free transfer slots, given back by the DMA ISR
+static SemaphoreHandle_t async_copy_done;                // Given when the copy task has finished its queue
+static async_copy_job_t async_copy_jobs[ASYNC_COPY_JOBS];
+static uint32_t async_copy_posted;                       // Jobs queued, written by the LVGL task only
+static uint32_t async_copy_finished;                     // Jobs whose transfers have all completed
+
+_Static_assert((ASYNC_COPY_JOBS & (ASYNC_COPY_JOBS - 1)) == 0, "ASYNC_COPY_JOBS must be a power of two");
+
+static bool async_copy_isr_done(async_memcpy_handle_t mcp_hdl, async_memcpy_event_t *event, void *cb_args)
+{
+    BaseType_t need_yield = pdFALSE;
+    xSemaphoreGiveFromISR(async_copy_slots, &need_yield);
+    return need_yield == pdTRUE;
+}
+
+static void async_copy_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // A job slot is not reused before `async_copy_finished` has passed it
+        uint32_t next = __atomic_load_n(&async_copy_finished, __ATOMIC_RELAXED);
+        uint32_t jobs = 0;
+        while (next + jobs != __atomic_load_n(&async_copy_posted, __ATOMIC_ACQUIRE)) {
+            async_copy_job_t job = async_copy_jobs[(next + jobs) & (ASYNC_COPY_JOBS - 1)];
+            for (uint32_t i = 0; i < job.count; i++) {
+                xSemaphoreTake(async_copy_slots, portMAX_DELAY);
+                if (esp_async_memcpy(async_copy_engine, job.dst, (void *)job.src, job.len,
+                                     async_copy_isr_done, NULL) != ESP_OK) {
+                    xSemaphoreGive(async_copy_slots);
+                    memcpy(job.dst, job.src, job.len); // The CPU writes through the cache, no sync needed
+                }
+                job.dst += job.dst_stride;
+                job.src += job.src_stride;
+            }
+            jobs++;
+        }
+        if (jobs == 0) {
+            continue;
+        }
+
+        // Wait for the transfers still in flight
+        for (int i = 0; i < ASYNC_COPY_BACKLOG; i++) {
+            xSemaphoreTake(async_copy_slots, portMAX_DELAY);
+        }
+        for (int i = 0; i < ASYNC_COPY_BACKLOG; i++) {
+            xSemaphoreGive(async_copy_slots);
+        }
+        __atomic_fetch_add(&async_copy_finished, jobs, __ATOMIC_RELEASE);
+        xSemaphoreGive(async_copy_done);
+    }
+}
+
+// Block until the first `posted` queued copies have landed in their frame buffers, LVGL task only
+static void async_copy_wait_until(uint32_t posted)
+{
+    if ((int32_t)(__atomic_load_n(&async_copy_finished, __ATOMIC_ACQUIRE) - posted) >= 0) {
+        return;
+    }
+    uint32_t start = FRAME_CLOCK();
+    // A stale give from an earlier batch only costs another pass through the loop
+    while ((int32_t)(__atomic_load_n(&async_copy_finished, __ATOMIC_ACQUIRE) - posted) < 0) {
+        xSemaphoreTake(async_copy_done, portMAX_DELAY);
+    }
+    frame_add_copy(start);
+}
+
+// Block until every queued copy has landed in its frame buffer, LVGL task only
+static void async_copy_wait(void)
+{
+    async_copy_wait_until(async_copy_posted);
+}
+
+// True if `area` overlaps a copy that has not finished yet
+static bool async_copy_overlaps(const lv_area_t *area)
+{
+    uint32_t finished = __atomic_load_n(&async_copy_finished, __ATOMIC_ACQUIRE);
+    for (uint32_t i = finished; i != async_copy_posted; i++) {
+        lv_area_t common;
+        if (_lv_area_intersect(&common, &async_copy_jobs[i & (ASYNC_COPY_JOBS - 1)].area, area)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void async_buffer_copy(lv_draw_ctx_t *draw_ctx, void *dest_buf, lv_coord_t dest_stride,
+                              const lv_area_t *dest_area, void *src_buf, lv_coord_t src_stride,
+                              const lv_area_t *src_area)
+{
+    const uint32_t stride = dest_stride * sizeof(lv_color_t);
+    const uint32_t row_len = lv_area_get_width(dest_area) * sizeof(lv_color_t);
+    const uint32_t rows = lv_area_get_height(dest_area);
+    uint8_t *dst = (uint8_t *)dest_buf + dest_area->y1 * stride + dest_area->x1 * sizeof(lv_color_t);
+    const uint8_t *src = (const uint8_t *)src_buf + src_area->y1 * stride + src_area->x1 * sizeof(lv_color_t);
+
+    // Bytes before the first and after the last whole cache line of each row
+    const uint32_t head = (uint32_t)(-(uintptr_t)dst) & (async_copy_align - 1);
+    const uint32_t inner = (row_len > head) ? ((row_len - head) & ~(async_copy_align - 1)) : 0;
+    const uint32_t tail = row_len - head - inner;
+
+    if (!async_copy_engine || inner == 0 || dest_stride != src_stride || !_lv_area_is_equal(dest_area, src_area) ||
+            (stride & (async_copy_align - 1)) || (((uintptr_t)dst ^ (uintptr_t)src) & (async_copy_align - 1))) {
+        frame_timed_buffer_copy(draw_ctx, dest_buf, dest_stride, dest_area, src_buf, src_stride, src_area);
+        return;
+    }
+
+    if (async_copy_posted - __atomic_load_n(&async_copy_finished, __ATOMIC_ACQUIRE) >= ASYNC_COPY_JOBS ||
+            async_copy_overlaps(dest_area)) {
+        async_copy_wait();
+    }
+
+    uint32_t start = FRAME_CLOCK();
+    const uint32_t span = (rows - 1) * stride + inner;
+    esp_cache_msync((void *)(src + head), span, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+    esp_cache_msync(dst + head, span, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE);
+
+    async_copy_job_t *job = &async_copy_jobs[async_copy_posted & (ASYNC_COPY_JOBS - 1)];
+    job->area = *dest_area;
+    job->dst = dst + head;
+    job->src = src + head;
+    if (inner == stride) {
+        // Full, aligned rows are contiguous: one transfer
+        job->len = span;
+        job->count = 1;
+    } else {
+        job->len = inner;
+        job->count = rows;
+    }
+    job->dst_stride = stride;
+    job->src_stride = stride;
+    __atomic_store_n(&async_copy_posted, async_copy_posted + 1, __ATOMIC_RELEASE);
+    xTaskNotifyGive(async_copy_task_handle);
+
+    // Row ends by the CPU while the DMA runs
+    if (head || tail) {
+        for (uint32_t y = 0; y < rows; y++) {
+            memcpy(dst, src, head);
+            memcpy(dst + head + inner, src + head + inner, tail);
+            dst += stride;
+            src += stride;
+        }
+    }
+    frame_add_copy(start);
+}
+
+#if LVGL_PORT_TILED
+/*
+ * Queue the copy of a rendered tile from internal RAM into a frame buffer, LVGL task only. The tile rows must be whole
+ * cache lines of the frame buffer, see `tile_rounder()`. Internal RAM is not cached, so only the destination needs a
+ * cache sync. Returns false, without copying, if the tile cannot be copied by the DMA.
+ */
+static bool async_tile_copy(void *fb, lv_coord_t fb_stride, const lv_area_t *area, const lv_color_t *tile)
+{
+    const uint32_t stride = fb_stride * sizeof(lv_color_t);
+    const uint32_t row_len = lv_area_get_width(area) * sizeof(lv_color_t);
+    const uint32_t rows = lv_area_get_height(area);
+    uint8_t *dst = (uint8_t *)fb + area->y1 * stride + area->x1 * sizeof(lv_color_t);
+
+    if (!async_copy_engine || (((uintptr_t)dst | (uintptr_t)tile | row_len | stride) & (async_copy_align - 1))) {
+        return false;
+    }
+    if (async_copy_posted - __atomic_load_n(&async_copy_finished, __ATOMIC_ACQUIRE) >= ASYNC_COPY_JOBS) {
+        async_copy_wait();
+    }
+
+    uint32_t start = FRAME_CLOCK();
+    esp_cache_msync(dst, (rows - 1) * stride + row_len, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE);
+
+    async_copy_job_t *job = &async_copy_jobs[async_copy_posted & (ASYNC_COPY_JOBS - 1)];
+    job->area = *area;
+    job->dst = dst;
+    job->src = (const uint8_t *)tile;
+    if (row_len == stride) {
+        // Full-width tile: one transfer
+        job->len = rows * row_len;
+        job->count = 1;
+    } else {
+        job->len = row_len;
+        job->count = rows;
+    }
+    job->dst_stride = stride;
+    job->src_stride = row_len;
+    __atomic_store_n(&async_copy_posted, async_copy_posted + 1, __ATOMIC_RELEASE);
+    xTaskNotifyGive(async_copy_task_handle);
+    frame_add_copy(start);
+    return true;
+}
+#endif
+
+static void async_copy_init(void)
+{
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.backlog = ASYNC_COPY_BACKLOG;
+    if (esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &async_copy_align) != ESP_OK || async_copy_align == 0 ||
+            esp_async_memcpy_install(&config, &async_copy_engine) != ESP_OK) {
+        ESP_LOGW(TAG, "Async memcpy not available, frame buffers are synced by the CPU");
+        async_copy_engine = NULL;
+        return;
+    }
+
+    async_copy_slots = xSemaphoreCreateCounting(ASYNC_COPY_BACKLOG, ASYNC_COPY_BACKLOG);
+    async_copy_done = xSemaphoreCreateBinary();
+    assert(async_copy_slots && async_copy_done);
+
+    // Run on the core the LVGL task does not use
+    BaseType_t core_id = (LVGL_PORT_TASK_CORE < 0) ? tskNO_AFFINITY : !LVGL_PORT_TASK_CORE;
+    BaseType_t ret = xTaskCreatePinnedToCore(async_copy_task, "lv_copy", ASYNC_COPY_TASK_STACK, NULL,
+                                             LVGL_PORT_TASK_PRIORITY + 1, &async_copy_task_handle, core_id);
+    if (ret != pdPASS) {
+        ESP_LOGW(TAG, "Failed to create copy task, frame buffers are synced by the CPU");
+        esp_async_memcpy_uninstall(async_copy_engine);
+        async_copy_engine = NULL;
+    }
+}
+#endif /* LVGL_PORT_ASYNC_COPY */
+
+#if LVGL_PORT_BAND_BLEND
+/*
+ * LVGL draws on the LVGL task only, but the software blend, where fills and images are mixed into the draw buffer,
+ * works on a plain rectangle of pixels. A large blend is split into two horizontal bands: the upper band is blended
+ * by a worker task on the other core through a copy of the draw context clipped to it, while the LVGL task blends
+ * the lower band. The LVGL task then waits for the worker, so the blend has finished when it returns, as LVGL expects.
+ */
+#define BAND_BLEND_MIN_PX           (4096)               // Smaller blends cost less than waking the worker
+#define BAND_TASK_STACK             (2 * 1024)
+
+static void (*band_sw_blend)(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc);
+static TaskHandle_t band_task_handle;                    // NULL if the worker could not be created
+static SemaphoreHandle_t band_done;                      // Given by the worker when its band is blended
+static lv_draw_sw_ctx_t band_ctx;                        // Draw context of the upper band
+static lv_area_t band_clip;
+static const lv_draw_sw_blend_dsc_t *band_dsc;
+
+static void band_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        band_sw_blend(&band_ctx.base_draw, band_dsc);
+        xSemaphoreGive(band_done);
+    }
+}
+
+static void band_blend(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc)
+{
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    lv_area_t area;
+    // Per-pixel callbacks, the ARGB buffer and the mask rounding without anti-aliasing are not safe to share
+    if (!_lv_area_intersect(&area, dsc->blend_area, draw_ctx->clip_area) || lv_area_get_height(&area) < 2 ||
+            lv_area_get_size(&area) < BAND_BLEND_MIN_PX || disp->driver->set_px_cb || disp->driver->screen_transp ||
+            (dsc->mask_buf && !disp->driver->antialiasing)) {
+        band_sw_blend(draw_ctx, dsc);
+        return;
+    }
+
+    const lv_coord_t mid = area.y1 + lv_area_get_height(&area) / 2;
+    band_clip = area;
+    band_clip.y2 = mid - 1;
+    band_ctx = *(lv_draw_sw_ctx_t *)draw_ctx;
+    band_ctx.base_draw.clip_area = &band_clip;
+    band_dsc = dsc;
+    xTaskNotifyGive(band_task_handle);
+
+    lv_area_t clip = area;
+    clip.y1 = mid;
+    const lv_area_t *clip_area = draw_ctx->clip_area;
+    draw_ctx->clip_area = &clip;
+    band_sw_blend(draw_ctx, dsc);
+    draw_ctx->clip_area = clip_area;
+
+    xSemaphoreTake(band_done, portMAX_DELAY);
+}
+
+static void band_init(void)
+{
+    band_done = xSemaphoreCreateBinary();
+    assert(band_done);
+
+    // Run on the core the LVGL task does not use
+    BaseType_t core_id = (LVGL_PORT_TASK_CORE < 0) ? tskNO_AFFINITY : !LVGL_PORT_TASK_CORE;
+    if (xTaskCreatePinnedToCore(band_task, "lv_band", BAND_TASK_STACK, NULL, LVGL_PORT_TASK_PRIORITY,
+                                &band_task_handle, core_id) != pdPASS) {
+        ESP_LOGW(TAG, "Failed to create band task, blending on one core");
+        band_task_handle = NULL;
+    }
+}
+#endif /* LVGL_PORT_BAND_BLEND */
+
+static void frame_time_stat(lvgl_port_frame_time_t *stat, uint64_t total, uint32_t max, uint32_t n)
+{
+    stat->avg_us = (uint32_t)(total / n / FRAME_CLOCK_PER_US);
+    stat->max_us = max / FRAME_CLOCK_PER_US;
+}
+
+void lvgl_port_get_frame_stats(lvgl_port_frame_stats_t *stats)
+{
+    uint64_t cycle_total = 0, render_total = 0, copy_total = 0, vsync_total = 0;
+    uint32_t cycle_max = 0, render_max = 0, copy_max = 0, vsync_max = 0;
+    int64_t first_us = INT64_MAX, last_us = 0;
+    uint32_t count;
+    uint32_t n;
+
+    // Summed in place: callers on different tasks (overlay, console) share no scratch copy
+    taskENTER_CRITICAL(&frame_mux);
+    count = frame_count;
+    stats->full_copies = frame_full_copies;
+    n = (count < LVGL_PORT_FRAME_WINDOW) ? count : LVGL_PORT_FRAME_WINDOW;
+    for (uint32_t i = 0; i < n; i++) {
+        const frame_time_t *f = &frame_window[i];
+        uint32_t render = f->cycle - f->copy - f->vsync;
+        cycle_total += f->cycle;
+        render_total += render;
+        copy_total += f->copy;
+        vsync_total += f->vsync;
+        cycle_max = (f->cycle > cycle_max) ? f->cycle : cycle_max;
+        render_max = (render > render_max) ? render : render_max;
+        copy_max = (f->copy > copy_max) ? f->copy : copy_max;
+        vsync_max = (f->vsync > vsync_max) ? f->vsync : vsync_max;
+        first_us = (f->end_us < first_us) ? f->end_us : first_us;
+        last_us = (f->end_us > last_us) ? f->end_us : last_us;
+    }
+    taskEXIT_CRITICAL(&frame_mux);
+
+    stats->frames = count;
+    stats->window = n;
+    stats->fps_x10 = 0;
+    if (n == 0) {
+        memset(&stats->cycle, 0, sizeof(stats->cycle));
+        stats->render = stats->copy = stats->vsync = stats->cycle;
+        return;
+    }
+
+    frame_time_stat(&stats->cycle, cycle_total, cycle_max, n);
+    frame_time_stat(&stats->render, render_total, render_max, n);
+    frame_time_stat(&stats->copy, copy_total, copy_max, n);
+    frame_time_stat(&stats->vsync, vsync_total, vsync_max, n);
+    if (n > 1 && last_us > first_us) {
+        stats->fps_x10 = (uint32_t)((uint64_t)(n - 1) * 10000000 / (last_us - first_us));
+    }
+}
+
+#if LVGL_PORT_FRAME_OVERLAY
+// Fixed-size opaque label on the system layer: a text change invalidates only the label itself
+static void frame_overlay_update(lv_timer_t *timer)
+{
+    lvgl_port_frame_stats_t stats;
+    lvgl_port_get_frame_stats(&stats);
+    lv_label_set_text_fmt((lv_obj_t *)timer->user_data,
+                          "%lu.%lu fps  full %lu\nrender %lu/%lu us\ncopy %lu/%lu us\nvsync %lu/%lu us",
+                          stats.fps_x10 / 10, stats.fps_x10 % 10, stats.full_copies,
+                          stats.render.avg_us, stats.render.max_us, stats.copy.avg_us, stats.copy.max_us,
+                          stats.vsync.avg_us, stats.vsync.max_us);
+}
+
+static void frame_overlay_create(void)
+{
+    lv_obj_t *label = lv_label_create(lv_layer_sys());
+    lv_obj_set_size(label, 170, 70);
+    lv_label_set_long_mode(label, LV_LABEL_LONG_CLIP);
+    lv_obj_set_style_bg_color(label, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(label, LV_OPA_COVER, 0);
+    lv_obj_set_style_text_color(label, lv_color_white(), 0);
+    lv_obj_set_style_pad_all(label, 2, 0);
+    lv_obj_align(label, LV_ALIGN_BOTTOM_RIGHT, 0, 0);
+    lv_label_set_text(label, "");
+    lv_timer_create(frame_overlay_update, LVGL_PORT_FRAME_OVERLAY_PERIOD_MS, label);
+}
+#endif
+
+#if LVGL_PORT_BENCH
+#define BENCH_PANELS                (6)
+
+static void bench_anim_x(void *obj, int32_t x)
+{
+    lv_obj_set_x((lv_obj_t *)obj, x);
+}
+
+esp_err_t lvgl_port_bench_run(uint32_t duration_ms, lvgl_port_bench_result_t *result)
+{
+    if (!lvgl_task_handle || xTaskGetCurrentTaskHandle() == lvgl_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    lv_obj_t *panels[BENCH_PANELS];
+    lvgl_port_lock(-1);
+    for (int i = 0; i < BENCH_PANELS; i++) {
+        lv_obj_t *panel = lv_obj_create(lv_layer_top());
+        lv_obj_remove_style_all(panel);
+        lv_obj_clear_flag(panel, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_set_size(panel, LVGL_PORT_H_RES / 2, LVGL_PORT_V_RES / 2);
+        lv_obj_set_y(panel, i * (LVGL_PORT_V_RES / 2) / (BENCH_PANELS - 1));
+        lv_obj_set_style_radius(panel, 24, 0);
+        lv_obj_set_style_bg_opa(panel, LV_OPA_50, 0);
+        lv_obj_set_style_bg_color(panel, lv_palette_main(LV_PALETTE_RED + i), 0);
+        lv_obj_set_style_bg_grad_color(panel, lv_palette_darken(LV_PALETTE_RED + i, 3), 0);
+        lv_obj_set_style_bg_grad_dir(panel, LV_GRAD_DIR_VER, 0);
+        lv_obj_set_style_border_width(panel, 4, 0);
+        lv_obj_set_style_border_color(panel, lv_color_white(), 0);
+        lv_obj_set_style_border_opa(panel, LV_OPA_60, 0);
+
+        // Different periods, so that the overlaps change every frame
+        lv_anim_t a;
+        lv_anim_init(&a);
+        lv_anim_set_var(&a, panel);
+        lv_anim_set_exec_cb(&a, bench_anim_x);
+        lv_anim_set_values(&a, 0, LVGL_PORT_H_RES / 2);
+        lv_anim_set_time(&a, 1000 + i * 170);
+        lv_anim_set_playback_time(&a, 1000 + i * 170);
+        lv_anim_set_repeat_count(&a, LV_ANIM_REPEAT_INFINITE);
+        lv_anim_start(&a);
+        panels[i] = panel;
+    }
+    lvgl_port_frame_stats_t before;
+    lvgl_port_get_frame_stats(&before);
+    const int64_t start = esp_timer_get_time();
+    lvgl_port_unlock();
+
+    vTaskDelay(pdMS_TO_TICKS(duration_ms));
+
+    lvgl_port_lock(-1);
+    lvgl_port_get_frame_stats(&result->stats);
+    const int64_t elapsed_us = esp_timer_get_time() - start;
+    for (int i = 0; i < BENCH_PANELS; i++) {
+        lv_obj_del(panels[i]); // Deletes the animation too
+    }
+    lvgl_port_unlock();
+
+    result->frames = result->stats.frames - before.frames;
+    result->fps_x10 = (elapsed_us > 0) ? (uint32_t)(result->frames * 10000000ULL / elapsed_us) : 0;
+    return ESP_OK;
+}
+#endif
+
 #if EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0
 // Function to get the next frame buffer for double buffering
 static void *get_next_frame_buffer(esp_lcd_panel_handle_t panel_handle)
@@ -34,163 +614,310 @@ static void *get_next_frame_buffer(esp_lcd_panel_handle_t panel_handle)
     }
     return next_fb;                                       // Return the next frame buffer
 }
+#endif /* EXAMPLE_LVGL_PORT_ROTATION_DEGREE */
 
-// Function to rotate and copy pixels from one buffer to another
-IRAM_ATTR static void rotate_copy_pixel(const uint16_t *from, uint16_t *to, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end, uint16_t w, uint16_t h, uint16_t rotation)
+#if LVGL_PORT_AVOID_TEAR_ENABLE
+// Wait until the RGB driver has switched to the frame buffer just passed to esp_lcd_panel_draw_bitmap()
+static inline void flush_wait_vsync(void)
 {
-    int from_index = 0;                                   // Index for source buffer
-    int to_index = 0;                                     // Index for destination buffer
-    int to_index_const = 0;                               // Constant index for destination buffer
+    uint32_t start = FRAME_CLOCK();
+    ulTaskNotifyValueClear(NULL, ULONG_MAX);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    frame_cur.vsync += FRAME_CLOCK() - start;
+}
 
-    switch (rotation) {
-    case 90:
-        to_index_const = (w - x_start - 1) * h;          // Calculate constant index for 90-degree rotation
-        for (int from_y = y_start; from_y < y_end + 1; from_y++) {
-            from_index = from_y * w + x_start;           // Calculate index in the source buffer
-            to_index = to_index_const + from_y;          // Calculate index in the destination buffer
-            for (int from_x = x_start; from_x < x_end + 1; from_x++) {
-                *(to + to_index) = *(from + from_index);  // Copy pixel
-                from_index += 1;                          // Move to the next pixel in the source
-                to_index -= h;                            // Move to the next pixel in the destination
-            }
+#if (LVGL_PORT_DIRECT_MODE && (EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0)) || LVGL_PORT_DIRECT_MODE_TRIPLE || LVGL_PORT_TILED
+/*
+ * With more than one frame buffer behind LVGL, a frame buffer that was not drawn for a few frames misses every area
+ * drawn meanwhile. Each frame buffer keeps the list of areas it is missing and is brought up to date, once, when its
+ * turn comes.
+ */
+#define FLUSH_DIRTY_AREAS_MAX       (LV_INV_BUF_SIZE)    // Areas kept per frame buffer before they are merged
+
+typedef struct {
+    void *fb;                                         // Frame buffer of this history
+    uint16_t count;                                   // Number of areas the frame buffer is missing
+    bool full;                                        // The frame buffer is missing the whole screen
+    lv_area_t areas[FLUSH_DIRTY_AREAS_MAX];           // Areas drawn since the frame buffer was last updated
+} lv_port_fb_dirty_t;
+
+// Add an area to the history of a frame buffer, merging it with the areas it overlaps or covers
+static void flush_dirty_add(lv_port_fb_dirty_t *dirty, const lv_area_t *area, const lv_area_t *screen)
+{
+    if (dirty->full) {
+        return;
+    }
+    if (_lv_area_is_in(screen, area, 0)) {
+        dirty->full = true;
+        dirty->count = 0;
+        return;
+    }
+
+    lv_area_t add = *area;
+    for (int i = 0; i < dirty->count; i++) {
+        if (_lv_area_is_in(&add, &dirty->areas[i], 0)) {
+            return; // Already missing
         }
-        break;
-    case 180:
-        to_index_const = h * w - x_start - 1;            // Calculate constant index for 180-degree rotation
-        for (int from_y = y_start; from_y < y_end + 1; from_y++) {
-            from_index = from_y * w + x_start;           // Calculate index in the source buffer
-            to_index = to_index_const - from_y * w;      // Calculate index in the destination buffer
-            for (int from_x = x_start; from_x < x_end + 1; from_x++) {
-                *(to + to_index) = *(from + from_index);  // Copy pixel
-                from_index += 1;                          // Move to the next pixel in the source
-                to_index -= 1;                            // Move to the next pixel in the destination
-            }
+    }
+    // Drop the areas the new one covers
+    int kept = 0;
+    for (int i = 0; i < dirty->count; i++) {
+        if (!_lv_area_is_in(&dirty->areas[i], &add, 0)) {
+            dirty->areas[kept++] = dirty->areas[i];
         }
-        break;
-    case 270:
-        to_index_const = (x_start + 1) * h - 1;          // Calculate constant index for 270-degree rotation
-        for (int from_y = y_start; from_y < y_end + 1; from_y++) {
-            from_index = from_y * w + x_start;           // Calculate index in the source buffer
-            to_index = to_index_const - from_y;          // Calculate index in the destination buffer
-            for (int from_x = x_start; from_x < x_end + 1; from_x++) {
-                *(to + to_index) = *(from + from_index);  // Copy pixel
-                from_index += 1;                          // Move to the next pixel in the source
-                to_index += h;                            // Move to the next pixel in the destination
+    }
+    dirty->count = kept;
+
+    if (dirty->count == FLUSH_DIRTY_AREAS_MAX) {
+        // No room: merge into the area whose bounding box grows the least
+        int best = 0;
+        uint32_t best_growth = UINT32_MAX;
+        for (int i = 0; i < dirty->count; i++) {
+            lv_area_t joined;
+            _lv_area_join(&joined, &dirty->areas[i], &add);
+            uint32_t growth = lv_area_get_size(&joined) - lv_area_get_size(&dirty->areas[i]);
+            if (growth < best_growth) {
+                best_growth = growth;
+                best = i;
             }
         }
-        break;
-    default:
-        break;                                             // Do nothing for unsupported rotation angles
+        _lv_area_join(&add, &dirty->areas[best], &add);
+        dirty->areas[best] = dirty->areas[--dirty->count];
+        flush_dirty_add(dirty, &add, screen); // The merged area may cover others
+        return;
     }
+    dirty->areas[dirty->count++] = add;
 }
-#endif /* EXAMPLE_LVGL_PORT_ROTATION_DEGREE */
+#endif
 
-#if LVGL_PORT_AVOID_TEAR_ENABLE
-#if LVGL_PORT_DIRECT_MODE
-#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0
+#if LVGL_PORT_DIRECT_MODE_TRIPLE || LVGL_PORT_TILED
+// Copy an area between frame buffers, an area LVGL is about to render over is copied at once
+static void flush_copy(lv_disp_drv_t *drv, lv_area_t *area, void *src, void *dst, bool overlaps_render)
+{
+    lv_draw_ctx_t *draw_ctx = drv->draw_ctx;
+    if (overlaps_render) {
+        // The async copy must not touch what LVGL is about to render, nor share it with a copy in flight
+#if LVGL_PORT_ASYNC_COPY
+        async_copy_wait();
+#endif
+        frame_timed_buffer_copy(draw_ctx, dst, drv->hor_res, area, src, drv->hor_res, area);
+    } else {
+        draw_ctx->buffer_copy(draw_ctx, dst, drv->hor_res, area, src, drv->hor_res, area);
+    }
+}
 
-// Structure to store information about dirty areas that need refreshing
-typedef struct {
-    uint16_t inv_p;                                   // Number of invalid areas
-    uint8_t inv_area_joined[LV_INV_BUF_SIZE];       // Array to track joined invalid areas
-    lv_area_t inv_areas[LV_INV_BUF_SIZE];            // Array of invalid areas
-} lv_port_dirty_area_t;
+// Copy `area` minus the areas LVGL is about to render
+static void flush_copy_outside(lv_disp_drv_t *drv, const lv_area_t *area, void *src, void *dst)
+{
+    lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing();
+    lv_area_t pieces[16];
+    int count = 1;
+    pieces[0] = *area;
+
+    for (int i = 0; i < disp_refr->inv_p && count > 0; i++) {
+        if (disp_refr->inv_area_joined[i]) {
+            continue;
+        }
+        lv_area_t next[16];
+        int next_count = 0;
+        for (int j = 0; j < count; j++) {
+            lv_area_t res[4];
+            int8_t res_c = _lv_area_diff(res, &pieces[j], &disp_refr->inv_areas[i]);
+            if (res_c == -1) {
+                res[0] = pieces[j]; // No overlap
+                res_c = 1;
+            }
+            if (next_count + res_c > (int)(sizeof(next) / sizeof(next[0]))) {
+                // Too fragmented: copy the piece whole before LVGL draws over it
+                flush_copy(drv, &pieces[j], src, dst, true);
+                continue;
+            }
+            for (int k = 0; k < res_c; k++) {
+                next[next_count++] = res[k];
+            }
+        }
+        memcpy(pieces, next, next_count * sizeof(lv_area_t));
+        count = next_count;
+    }
 
-// Enumeration for flush status
-typedef enum {
-    FLUSH_STATUS_PART,                                // Partial flush
-    FLUSH_STATUS_FULL                                 // Full flush
-} lv_port_flush_status_t;
+    for (int j = 0; j < count; j++) {
+        flush_copy(drv, &pieces[j], src, dst, false);
+    }
+}
 
-// Enumeration for flush probe results
-typedef enum {
-    FLUSH_PROBE_PART_COPY,                           // Probe result for partial copy
-    FLUSH_PROBE_SKIP_COPY,                           // Probe result to skip copy
-    FLUSH_PROBE_FULL_COPY,                           // Probe result for full copy
-} lv_port_flush_probe_t;
+// Bring a frame buffer up to date from `src` before LVGL renders into it, and clear its history
+static void flush_dirty_sync(lv_disp_drv_t *drv, lv_port_fb_dirty_t *dirty, void *src)
+{
+    if (dirty->full) {
+        const lv_area_t screen = { 0, 0, drv->hor_res - 1, drv->ver_res - 1 };
+        flush_copy_outside(drv, &screen, src, dirty->fb);
+        taskENTER_CRITICAL(&frame_mux);
+        frame_full_copies++;
+        taskEXIT_CRITICAL(&frame_mux);
+    } else {
+        for (int i = 0; i < dirty->count; i++) {
+            flush_copy_outside(drv, &dirty->areas[i], src, dirty->fb);
+        }
+    }
+    dirty->full = false;
+    dirty->count = 0;
+}
+#endif
 
-static lv_port_dirty_area_t dirty_area;             // Instance of dirty area structure
+#if LVGL_PORT_DIRECT_MODE
+#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0
+
+/*
+ * LVGL renders into its own full-screen buffer, which is always up to date, and each frame is rotated into one of the
+ * two RGB frame buffers. A frame adds its dirty areas to the histories of both and then copies only the history of the
+ * buffer it is about to show.
+ */
+static lv_port_fb_dirty_t fb_dirty[2];               // One history per RGB frame buffer, fb set on first use
 
-// Function to save the current dirty area information
-static void flush_dirty_save(lv_port_dirty_area_t *dirty_area)
+// History of the given frame buffer, the two histories are assigned to the first two frame buffers seen
+static lv_port_fb_dirty_t *flush_dirty_get(void *fb)
 {
-    lv_disp_t *disp = _lv_refr_get_disp_refreshing(); // Get the currently refreshing display
-    dirty_area->inv_p = disp->inv_p;                  // Save the number of invalid areas
-    for (int i = 0; i < disp->inv_p; i++) {
-        dirty_area->inv_area_joined[i] = disp->inv_area_joined[i]; // Save joined areas status
-        dirty_area->inv_areas[i] = disp->inv_areas[i]; // Save invalid areas
+    for (int i = 0; i < 2; i++) {
+        if (fb_dirty[i].fb == fb || fb_dirty[i].fb == NULL) {
+            fb_dirty[i].fb = fb;
+            return &fb_dirty[i];
+        }
     }
+    assert(false && "more than two RGB frame buffers");
+    return &fb_dirty[0];
 }
 
 /**
- * @brief Probe dirty area to copy
+ * @brief Copy the areas a frame buffer is missing from LVGL's buffer, and clear its history
  *
  * @note This function is used to avoid tearing effect, and only works with LVGL direct mode.
  *
  */
-static lv_port_flush_probe_t flush_copy_probe(lv_disp_drv_t *drv)
+static void flush_dirty_copy(void *dst, void *src, lv_port_fb_dirty_t *dirty)
 {
-    static lv_port_flush_status_t prev_status = FLUSH_STATUS_PART; // Previous flush status
-    lv_port_flush_status_t cur_status;                            // Current flush status
-    lv_port_flush_probe_t probe_result;                           // Result of the probe
-    lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing();       // Get the currently refreshing display
-
-    uint32_t flush_ver = 0;                                       // Vertical size to flush
-    uint32_t flush_hor = 0;                                       // Horizontal size to flush
-    for (int i = 0; i < disp_refr->inv_p; i++) {
-        if (disp_refr->inv_area_joined[i] == 0) {
-            flush_ver = (disp_refr->inv_areas[i].y2 + 1 - disp_refr->inv_areas[i].y1); // Calculate vertical flush size
-            flush_hor = (disp_refr->inv_areas[i].x2 + 1 - disp_refr->inv_areas[i].x1); // Calculate horizontal flush size
-            break; // Exit the loop after finding the first unjoined area
+    uint32_t start = FRAME_CLOCK(); // Start of the copy for the frame timing
+    if (dirty->full) {
+        lvgl_rotate_copy(src, dst, 0, 0, LV_HOR_RES - 1, LV_VER_RES - 1, LV_HOR_RES, LV_VER_RES, EXAMPLE_LVGL_PORT_ROTATION_DEGREE);
+        taskENTER_CRITICAL(&frame_mux);
+        frame_full_copies++;
+        taskEXIT_CRITICAL(&frame_mux);
+    } else {
+        for (int i = 0; i < dirty->count; i++) {
+            const lv_area_t *area = &dirty->areas[i];
+            // Rotate and copy pixel data from source to destination buffer
+            lvgl_rotate_copy(src, dst, area->x1, area->y1, area->x2, area->y2, LV_HOR_RES, LV_VER_RES, EXAMPLE_LVGL_PORT_ROTATION_DEGREE);
         }
     }
-    /* Check if the current full screen refreshes */
-    cur_status = ((flush_ver == drv->ver_res) && (flush_hor == drv->hor_res)) ? (FLUSH_STATUS_FULL) : (FLUSH_STATUS_PART);
+    dirty->full = false;
+    dirty->count = 0;
+    frame_add_copy(start);
+}
 
-    // Determine the probe result based on previous and current status
-    if (prev_status == FLUSH_STATUS_FULL) {
-        if ((cur_status == FLUSH_STATUS_PART)) {
-            probe_result = FLUSH_PROBE_FULL_COPY; // Full copy needed
-        } else {
-            probe_result = FLUSH_PROBE_SKIP_COPY; // Skip copy
+static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    esp_lcd_panel_handle_t panel_handle = (esp_lcd_panel_handle_t) drv->user_data; // Get the panel handle from driver user data
+    const int offsetx1 = area->x1; // Start X coordinate of the area to flush
+    const int offsetx2 = area->x2; // End X coordinate of the area to flush
+    const int offsety1 = area->y1; // Start Y coordinate of the area to flush
+    const int offsety2 = area->y2; // End Y coordinate of the area to flush
+
+    /* Action after last area refresh */
+    if (lv_disp_flush_is_last(drv)) {
+        lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing(); // Get the currently refreshing display
+        const lv_area_t screen = { 0, 0, drv->hor_res - 1, drv->ver_res - 1 };
+
+        /* Both frame buffers now miss the areas drawn in this frame */
+        for (int i = 0; i < disp_refr->inv_p; i++) {
+            if (disp_refr->inv_area_joined[i] == 0) {
+                flush_dirty_add(&fb_dirty[0], &disp_refr->inv_areas[i], &screen);
+                flush_dirty_add(&fb_dirty[1], &disp_refr->inv_areas[i], &screen);
+            }
         }
-    } else {
-        probe_result = FLUSH_PROBE_PART_COPY; // Partial copy needed
+
+        /* Bring the next frame buffer up to date */
+        void *next_fb = get_next_frame_buffer(panel_handle);
+        flush_dirty_copy(next_fb, color_map, flush_dirty_get(next_fb));
+
+        /* Switch the current RGB frame buffer to `next_fb` */
+        esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, next_fb);
+
+        /* Wait for the current frame buffer to complete transmission */
+        flush_wait_vsync();
     }
-    prev_status = cur_status; // Update previous status
 
-    return probe_result; // Return the result of the probe
+    lv_disp_flush_ready(drv); // Mark the display flush as complete
 }
 
-// Inline function to get the next buffer for flushing
-static inline void *flush_get_next_buf(void *panel_handle)
-{
-    return get_next_frame_buffer(panel_handle); // Return the next frame buffer
-}
+#elif LVGL_PORT_DIRECT_MODE_TRIPLE
 
-/**
- * @brief Copy dirty area
+/*
+ * Three RGB frame buffers: one scanned out, one queued for the next vsync (possibly the same one) and one that LVGL
+ * renders into in direct mode. The render buffer is never scanned or queued, so a finished frame is queued with
+ * `esp_lcd_panel_draw_bitmap()` and LVGL goes on with the next frame without waiting for vsync. A frame that is still
+ * queued when the next one finishes is replaced by it and never shown.
  *
- * @note This function is used to avoid tearing effect, and only works with LVGL direct mode.
+ * LVGL is given a single buffer, so it does no buffer sync of its own. Before rendering, `triple_render_start()`
+ * copies into the render buffer the areas it is missing, taken from the newest frame, minus the areas about to be
+ * redrawn.
  *
+ * The driver does not tell which buffer it scans. Its ISR latches the buffer last passed to
+ * `esp_lcd_panel_draw_bitmap()` and only then calls `lvgl_port_notify_rgb_vsync()`, so a buffer handed over between
+ * those two steps may or may not have been latched. The vsync callback therefore keeps a conservative set: the
+ * buffer that was newest at the previous callback plus every buffer handed over since then may be on screen. Only
+ * a buffer outside that set, and not handed over since the last callback, is picked for rendering. If there is
+ * none, which happens when two frames finish within one refresh, the LVGL task waits for the next vsync.
  */
-static void flush_dirty_copy(void *dst, void *src, lv_port_dirty_area_t *dirty_area)
+static lv_port_fb_dirty_t triple_fbs[3];              // History of each frame buffer
+static lv_port_fb_dirty_t *triple_queued;             // Newest frame, last handed to the driver
+static lv_port_fb_dirty_t *triple_render;             // LVGL renders here, LVGL task only
+static uint32_t triple_on_screen;                     // Buffers (bit per index) that may be scanned, vsync ISR
+static uint32_t triple_newest_at_vsync;               // Newest handed-over buffer at the last vsync callback
+static uint32_t triple_handed;                        // Buffers handed to the driver since the last vsync callback
+static portMUX_TYPE triple_mux = portMUX_INITIALIZER_UNLOCKED;
+
+#define TRIPLE_BIT(fb_dirty)    (1u << ((fb_dirty) - triple_fbs))
+
+static void triple_init(void *fb0, void *fb1, void *fb2)
 {
-    lv_coord_t x_start, x_end, y_start, y_end; // Coordinates for the area to be copied
-    for (int i = 0; i < dirty_area->inv_p; i++) {
-        /* Refresh the unjoined areas */
-        if (dirty_area->inv_area_joined[i] == 0) {
-            x_start = dirty_area->inv_areas[i].x1; // Start X coordinate
-            x_end = dirty_area->inv_areas[i].x2;   // End X coordinate
-            y_start = dirty_area->inv_areas[i].y1; // Start Y coordinate
-            y_end = dirty_area->inv_areas[i].y2;   // End Y coordinate
+    triple_fbs[0].fb = fb0;
+    triple_fbs[1].fb = fb1;
+    triple_fbs[2].fb = fb2;
+    triple_queued = &triple_fbs[0];                  // The RGB driver starts with the first frame buffer
+    triple_on_screen = triple_newest_at_vsync = TRIPLE_BIT(&triple_fbs[0]);
+    triple_handed = 0;
+    triple_render = &triple_fbs[1];
+}
 
-            // Rotate and copy pixel data from source to destination buffer
-            rotate_copy_pixel(src, dst, x_start, y_start, x_end, y_end, LV_HOR_RES, LV_VER_RES, EXAMPLE_LVGL_PORT_ROTATION_DEGREE);
+// Called from the vsync ISR
+IRAM_ATTR static void triple_vsync(void)
+{
+    taskENTER_CRITICAL_ISR(&triple_mux);
+    triple_on_screen = triple_newest_at_vsync | triple_handed;
+    triple_newest_at_vsync = TRIPLE_BIT(triple_queued);
+    triple_handed = 0;
+    taskEXIT_CRITICAL_ISR(&triple_mux);
+}
+
+// Buffer that cannot be scanned before LVGL has finished it, NULL if every buffer may still be on screen
+static lv_port_fb_dirty_t *triple_pick_render(void)
+{
+    lv_port_fb_dirty_t *free_fb = NULL;
+    taskENTER_CRITICAL(&triple_mux);
+    const uint32_t busy = triple_on_screen | triple_newest_at_vsync | triple_handed;
+    for (int i = 0; i < 3; i++) {
+        if (!(busy & TRIPLE_BIT(&triple_fbs[i]))) {
+            free_fb = &triple_fbs[i];
+            break;
         }
     }
+    taskEXIT_CRITICAL(&triple_mux);
+    return free_fb;
 }
 
+static void triple_render_start(lv_disp_drv_t *drv)
+{
+    flush_dirty_sync(drv, triple_render, triple_queued->fb);
+}
 
 static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
 {
@@ -199,67 +926,56 @@ static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     const int offsetx2 = area->x2; // End X coordinate of the area to flush
     const int offsety1 = area->y1; // Start Y coordinate of the area to flush
     const int offsety2 = area->y2; // End Y coordinate of the area to flush
-    void *next_fb = NULL; // Pointer for the next frame buffer
-    lv_port_flush_probe_t probe_result = FLUSH_PROBE_PART_COPY; // Default probe result
-    lv_disp_t *disp = lv_disp_get_default(); // Get the default display
 
     /* Action after last area refresh */
     if (lv_disp_flush_is_last(drv)) {
-        /* Check if the `full_refresh` flag has been triggered */
-        if (drv->full_refresh) {
-            /* Reset flag */
-            drv->full_refresh = 0;
-
-            // Rotate and copy data from the whole screen LVGL's buffer to the next frame buffer
-            next_fb = flush_get_next_buf(panel_handle);
-            rotate_copy_pixel((uint16_t *)color_map, next_fb, offsetx1, offsety1, offsetx2, offsety2, LV_HOR_RES, LV_VER_RES, EXAMPLE_LVGL_PORT_ROTATION_DEGREE);
-
-            /* Switch the current RGB frame buffer to `next_fb` */
-            esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, next_fb);
+        lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing(); // Get the currently refreshing display
+        const lv_area_t screen = { 0, 0, drv->hor_res - 1, drv->ver_res - 1 };
+        lv_port_fb_dirty_t *done = triple_render;
+
+        /* The other two frame buffers now miss the areas drawn in this frame */
+        for (int i = 0; i < 3; i++) {
+            if (&triple_fbs[i] == done) {
+                continue;
+            }
+            for (int j = 0; j < disp_refr->inv_p; j++) {
+                if (disp_refr->inv_area_joined[j] == 0) {
+                    flush_dirty_add(&triple_fbs[i], &disp_refr->inv_areas[j], &screen);
+                }
+            }
+        }
+#if LVGL_PORT_ASYNC_COPY
+        /* The areas carried over from the previous frame must be in place before it is shown */
+        async_copy_wait();
+#endif
 
-            /* Wait for the current frame buffer to complete transmission */
-            ulTaskNotifyValueClear(NULL, ULONG_MAX);
-            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        /*
+         * Mark `done` handed over before the driver gets it, so that a vsync callback from here on counts it as
+         * possibly latched. Then switch the RGB frame buffer to `color_map` at the next vsync.
+         */
+        taskENTER_CRITICAL(&triple_mux);
+        triple_handed |= TRIPLE_BIT(done);
+        triple_queued = done;
+        taskEXIT_CRITICAL(&triple_mux);
+        esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
 
-            /* Synchronously update the dirty area for another frame buffer */
-            flush_dirty_copy(flush_get_next_buf(panel_handle), color_map, &dirty_area);
-            flush_get_next_buf(panel_handle);
-        } else {
-            /* Probe the copy method for the current dirty area */
-            probe_result = flush_copy_probe(drv);
-
-            if (probe_result == FLUSH_PROBE_FULL_COPY) {
-                /* Save current dirty area for the next frame buffer */
-                flush_dirty_save(&dirty_area);
-
-                /* Set LVGL full-refresh flag and set flush ready in advance */
-                drv->full_refresh = 1; // Indicate that a full refresh is required
-                disp->rendering_in_progress = false; // Mark rendering as not in progress
-                lv_disp_flush_ready(drv); // Mark flush as ready
-
-                /* Force to refresh the whole screen, will invoke `flush_callback` recursively */
-                lv_refr_now(_lv_refr_get_disp_refreshing());
-            } else {
-                /* Update current dirty area for the next frame buffer */
-                next_fb = flush_get_next_buf(panel_handle);
-                flush_dirty_save(&dirty_area);
-                flush_dirty_copy(next_fb, color_map, &dirty_area);
-
-                /* Switch the current RGB frame buffer to `next_fb` */
-                esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, next_fb);
-
-                /* Wait for the current frame buffer to complete transmission */
+        /* Render the next frame into a buffer that cannot be on screen, waiting for a vsync if there is none */
+        lv_port_fb_dirty_t *next = triple_pick_render();
+        if (next == NULL) {
+            uint32_t start = FRAME_CLOCK();
+            do {
                 ulTaskNotifyValueClear(NULL, ULONG_MAX);
-                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-                if (probe_result == FLUSH_PROBE_PART_COPY) {
-                    /* Synchronously update the dirty area for another frame buffer */
-                    flush_dirty_save(&dirty_area);
-                    flush_dirty_copy(flush_get_next_buf(panel_handle), color_map, &dirty_area);
-                    flush_get_next_buf(panel_handle);
+                next = triple_pick_render();
+                if (next == NULL) {
+                    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
                 }
-            }
+            } while (next == NULL);
+            frame_cur.vsync += FRAME_CLOCK() - start;
         }
+        triple_render = next;
+
+        drv->draw_buf->buf1 = triple_render->fb;
+        drv->draw_buf->buf_act = triple_render->fb;
     }
 
     lv_disp_flush_ready(drv); // Mark the display flush as complete
@@ -277,18 +993,119 @@ static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
 
     /* Action after last area refresh */
     if (lv_disp_flush_is_last(drv)) {
+#if LVGL_PORT_ASYNC_COPY
+        /* The areas synced from the other buffer must be in place before it is shown */
+        async_copy_wait();
+#endif
         /* Switch the current RGB frame buffer to `color_map` */
         esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
 
         /* Wait for the last frame buffer to complete transmission */
-        ulTaskNotifyValueClear(NULL, ULONG_MAX);
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        flush_wait_vsync();
     }
 
     lv_disp_flush_ready(drv); // Mark the display flush as complete
 }
 #endif /* EXAMPLE_LVGL_PORT_ROTATION_DEGREE */
 
+#elif LVGL_PORT_TILED
+
+/*
+ * LVGL renders in partial mode into two tiles in internal RAM, so blending never reads PSRAM. Each finished tile is
+ * written into the frame buffer that is not on screen while LVGL renders the next tile into the other one. After the
+ * last tile the frame buffers are swapped at vsync, as in mode 3, and before the next frame the new back buffer gets
+ * the areas it is missing from the one on screen.
+ */
+#define TILE_ALIGN                  (64)                 // Largest PSRAM cache line of the ESP32-S3
+#define TILE_ALIGN_PX               (TILE_ALIGN / sizeof(lv_color_t))
+
+static lv_port_fb_dirty_t tile_fbs[2];               // History of each frame buffer, the first one is on screen
+static lv_port_fb_dirty_t *tile_back = &tile_fbs[1]; // Tiles are written here, LVGL task only
+#if LVGL_PORT_ASYNC_COPY
+static uint32_t tile_posted;                         // Copy jobs queued up to the last tile
+#endif
+
+static inline lv_port_fb_dirty_t *tile_front(void)
+{
+    return (tile_back == &tile_fbs[0]) ? &tile_fbs[1] : &tile_fbs[0];
+}
+
+#if LVGL_PORT_ASYNC_COPY
+// Widen the areas to whole cache lines of the frame buffer, so that the DMA copies every tile row alone
+static void tile_rounder(lv_disp_drv_t *drv, lv_area_t *area)
+{
+    area->x1 &= ~(lv_coord_t)(TILE_ALIGN_PX - 1);
+    area->x2 |= (lv_coord_t)(TILE_ALIGN_PX - 1);
+    if (area->x2 >= drv->hor_res) {
+        area->x2 = drv->hor_res - 1;
+    }
+}
+#endif
+
+static void tile_render_start(lv_disp_drv_t *drv)
+{
+    flush_dirty_sync(drv, tile_back, tile_front()->fb);
+}
+
+// Write a rendered tile into the back frame buffer
+static void tile_write(const lv_area_t *area, const lv_color_t *tile)
+{
+#if LVGL_PORT_ASYNC_COPY
+    // LVGL renders the next tile into the buffer of the previous one, so that one must have landed
+    async_copy_wait_until(tile_posted);
+    if (async_tile_copy(tile_back->fb, LVGL_PORT_H_RES, area, tile)) {
+        tile_posted = async_copy_posted;
+        return;
+    }
+#endif
+    uint32_t start = FRAME_CLOCK();
+    const uint32_t stride = LVGL_PORT_H_RES * sizeof(lv_color_t);
+    const uint32_t row_len = lv_area_get_width(area) * sizeof(lv_color_t);
+    uint8_t *dst = (uint8_t *)tile_back->fb + area->y1 * stride + area->x1 * sizeof(lv_color_t);
+    const uint8_t *src = (const uint8_t *)tile;
+    for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+        memcpy(dst, src, row_len);
+        dst += stride;
+        src += row_len;
+    }
+    frame_add_copy(start);
+}
+
+static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
+{
+    esp_lcd_panel_handle_t panel_handle = (esp_lcd_panel_handle_t) drv->user_data; // Get the panel handle from driver user data
+
+    tile_write(area, color_map);
+
+    /* Action after last area refresh */
+    if (lv_disp_flush_is_last(drv)) {
+        lv_disp_t *disp_refr = _lv_refr_get_disp_refreshing(); // Get the currently refreshing display
+        const lv_area_t screen = { 0, 0, drv->hor_res - 1, drv->ver_res - 1 };
+        lv_port_fb_dirty_t *front = tile_front();
+
+        /* The frame buffer on screen now misses the areas drawn in this frame */
+        for (int i = 0; i < disp_refr->inv_p; i++) {
+            if (disp_refr->inv_area_joined[i] == 0) {
+                flush_dirty_add(front, &disp_refr->inv_areas[i], &screen);
+            }
+        }
+#if LVGL_PORT_ASYNC_COPY
+        /* Every tile and carried-over area must be in place before the frame buffer is shown */
+        async_copy_wait();
+#endif
+
+        /* Switch the current RGB frame buffer to the back buffer */
+        esp_lcd_panel_draw_bitmap(panel_handle, 0, 0, drv->hor_res, drv->ver_res, tile_back->fb);
+
+        /* Wait for the last frame buffer to complete transmission */
+        flush_wait_vsync();
+        tile_back = front;
+    }
+
+    /* The tile buffer is free once the copy has been queued, the next flush waits for it */
+    lv_disp_flush_ready(drv); // Mark the display flush as complete
+}
+
 #elif LVGL_PORT_FULL_REFRESH && LVGL_PORT_LCD_RGB_BUFFER_NUMS == 2
 
 static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
@@ -303,8 +1120,7 @@ static void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, color_map);
 
     /* Wait for the last frame buffer to complete transmission */
-    ulTaskNotifyValueClear(NULL, ULONG_MAX);
-    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    flush_wait_vsync();
 
     lv_disp_flush_ready(drv); // Mark the display flush as complete
 }
@@ -329,7 +1145,9 @@ void flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color
     void *next_fb = get_next_frame_buffer(panel_handle); // Get the next frame buffer
 
     /* Rotate and copy dirty area from the current LVGL's buffer to the next RGB frame buffer */
-    rotate_copy_pixel((uint16_t *)color_map, next_fb, offsetx1, offsety1, offsetx2, offsety2, LV_HOR_RES, LV_VER_RES, EXAMPLE_LVGL_PORT_ROTATION_DEGREE);
+    uint32_t copy_start = FRAME_CLOCK();
+    lvgl_rotate_copy((uint16_t *)color_map, next_fb, offsetx1, offsety1, offsetx2, offsety2, LV_HOR_RES, LV_VER_RES, EXAMPLE_LVGL_PORT_ROTATION_DEGREE);
+    frame_add_copy(copy_start);
 
     /* Switch the current RGB frame buffer to `next_fb` */
     esp_lcd_panel_draw_bitmap(panel_handle, offsetx1, offsety1, offsetx2 + 1, offsety2 + 1, next_fb);
@@ -387,6 +1205,20 @@ static lv_disp_t *display_init(esp_lcd_panel_handle_t panel_handle)
     ESP_ERROR_CHECK(esp_lcd_rgb_panel_get_frame_buffer(panel_handle, 3, &lvgl_port_rgb_last_buf, &buf1, &buf2));
     lvgl_port_rgb_next_buf = lvgl_port_rgb_last_buf; // Set the next RGB buffer
     lvgl_port_flush_next_buf = buf2; // Set the flush next buffer
+#elif LVGL_PORT_DIRECT_MODE_TRIPLE
+    // Three frame buffers, LVGL renders into the one that is neither scanned nor queued
+    void *fbs[3];
+    ESP_ERROR_CHECK(esp_lcd_rgb_panel_get_frame_buffer(panel_handle, 3, &fbs[0], &fbs[1], &fbs[2]));
+    triple_init(fbs[0], fbs[1], fbs[2]);
+    buf1 = fbs[1]; // Set buf1 to the first render buffer
+#elif LVGL_PORT_TILED
+    // Two frame buffers for the RGB driver, LVGL renders into two tiles in internal RAM that the DMA can read
+    ESP_ERROR_CHECK(esp_lcd_rgb_panel_get_frame_buffer(panel_handle, 2, &tile_fbs[0].fb, &tile_fbs[1].fb));
+    buffer_size = LVGL_PORT_H_RES * LVGL_PORT_TILE_HEIGHT;
+    buf1 = heap_caps_aligned_alloc(TILE_ALIGN, buffer_size * sizeof(lv_color_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    buf2 = heap_caps_aligned_alloc(TILE_ALIGN, buffer_size * sizeof(lv_color_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    assert(buf1 && buf2); // Ensure allocation succeeded
+    ESP_LOGI(TAG, "LVGL tile size: 2 x %dKB", buffer_size * sizeof(lv_color_t) / 1024); // Log tile size
 #elif (LVGL_PORT_LCD_RGB_BUFFER_NUMS == 3) && (EXAMPLE_LVGL_PORT_ROTATION_DEGREE != 0)
     // Using three frame buffers, one for LVGL rendering and two for RGB driver (one used for rotation)
     void *fbs[3];
@@ -418,12 +1250,42 @@ static lv_disp_t *display_init(esp_lcd_panel_handle_t panel_handle)
     disp_drv.flush_cb = flush_callback; // Set the flush callback
     disp_drv.draw_buf = &disp_buf; // Set the draw buffer
     disp_drv.user_data = panel_handle; // Set user data to panel handle
+    disp_drv.monitor_cb = frame_monitor_cb; // Marks the cycles that drew a frame
 #if LVGL_PORT_FULL_REFRESH
     disp_drv.full_refresh = 1; // Enable full refresh
 #elif LVGL_PORT_DIRECT_MODE
     disp_drv.direct_mode = 1; // Enable direct mode
 #endif
-    return lv_disp_drv_register(&disp_drv); // Register the display driver
+#if LVGL_PORT_DIRECT_MODE_TRIPLE
+    disp_drv.render_start_cb = triple_render_start; // Carry over the areas the render buffer is missing
+#elif LVGL_PORT_TILED
+    disp_drv.render_start_cb = tile_render_start; // Carry over the areas the back buffer is missing
+#if LVGL_PORT_ASYNC_COPY
+    disp_drv.rounder_cb = tile_rounder; // Tile rows of whole cache lines
+#endif
+#endif
+    lv_disp_t *disp = lv_disp_drv_register(&disp_drv); // Register the display driver
+    if (disp) {
+        // Time the buffer sync of direct mode as part of the copy time
+        frame_sw_buffer_copy = disp_drv.draw_ctx->buffer_copy;
+#if LVGL_PORT_ASYNC_COPY
+        disp_drv.draw_ctx->buffer_copy = async_buffer_copy; // Falls back to frame_timed_buffer_copy()
+#else
+        disp_drv.draw_ctx->buffer_copy = frame_timed_buffer_copy;
+#endif
+#if LVGL_PORT_FAST_BLEND
+        ((lv_draw_sw_ctx_t *)disp_drv.draw_ctx)->blend = lvgl_blend; // Before the bands, so both halves use it
+        disp_drv.draw_ctx->draw_letter = lvgl_blend_letter;           // 4-bpp glyphs without the A8 mask
+#endif
+#if LVGL_PORT_BAND_BLEND
+        if (band_task_handle) {
+            lv_draw_sw_ctx_t *sw_ctx = (lv_draw_sw_ctx_t *)disp_drv.draw_ctx;
+            band_sw_blend = sw_ctx->blend;
+            sw_ctx->blend = band_blend; // Large blends on both cores
+        }
+#endif
+    }
+    return disp;
 }
 
 static void touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
@@ -483,23 +1345,300 @@ static esp_err_t tick_init(void)
     return esp_timer_start_periodic(lvgl_tick_timer, LVGL_PORT_TICK_PERIOD_MS * 1000); // Start the timer
 }
 
+/*
+ * UI command queue: bounded MPSC ring (Vyukov). Each slot carries a sequence number. A producer claims a slot by
+ * advancing `ui_queue_head` with compare-and-swap, fills it and publishes it by setting the sequence to `pos + 1`.
+ * The LVGL task is the only consumer; it frees a slot by setting the sequence to `pos + LVGL_PORT_UI_QUEUE_LEN`.
+ */
+_Static_assert((LVGL_PORT_UI_QUEUE_LEN & (LVGL_PORT_UI_QUEUE_LEN - 1)) == 0, "UI queue length must be a power of two");
+
+typedef enum {
+    UI_CMD_SET_TEXT = 0,
+    UI_CMD_ADD_STATE,
+    UI_CMD_CLEAR_STATE,
+    UI_CMD_SET_VALUE,
+} ui_cmd_type_t;
+
+typedef struct {
+    uint32_t seq;                                        // Slot sequence, see above
+    uint8_t type;                                        // ui_cmd_type_t
+    lvgl_port_ui_obj_t obj;
+    union {
+        char text[LVGL_PORT_UI_TEXT_MAX];
+        lv_state_t state;
+        int32_t value;
+    };
+} ui_cmd_t;
+
+static ui_cmd_t ui_queue[LVGL_PORT_UI_QUEUE_LEN];
+static uint32_t ui_queue_head;                           // Next position to claim, shared by producers
+static uint32_t ui_queue_tail;                           // Next position to apply, LVGL task only
+static uint32_t ui_queue_dropped;
+
+/*
+ * Objects bound for UI commands. A handle holds the slot number (index + 1) in its low byte and the slot generation
+ * above it. Deleting the object bumps the generation, so older handles stop matching the slot. The table is only
+ * used with the LVGL mutex held: binding, the delete event and the drain all run on the LVGL task or under the lock.
+ */
+_Static_assert(LVGL_PORT_UI_OBJECTS < 256, "UI object slot number must fit in the low byte of a handle");
+
+typedef struct {
+    lv_obj_t *obj;
+    uint32_t generation;
+} ui_binding_t;
+
+static ui_binding_t ui_bindings[LVGL_PORT_UI_OBJECTS];
+
+static lvgl_port_ui_obj_t ui_binding_handle(int slot)
+{
+    return ((ui_bindings[slot].generation & 0xFFFFFF) << 8) | (uint32_t)(slot + 1);
+}
+
+static void ui_binding_delete_cb(lv_event_t *e)
+{
+    ui_binding_t *binding = lv_event_get_user_data(e);
+    binding->obj = NULL;
+    binding->generation++;
+}
+
+lvgl_port_ui_obj_t lvgl_port_ui_bind(lv_obj_t *obj)
+{
+    int free_slot = -1;
+    for (int i = 0; i < LVGL_PORT_UI_OBJECTS; i++) {
+        if (ui_bindings[i].obj == obj) {
+            return ui_binding_handle(i);
+        }
+        if (ui_bindings[i].obj == NULL && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+    if (obj == NULL || free_slot < 0) {
+        return 0;
+    }
+    ui_bindings[free_slot].obj = obj;
+    lv_obj_add_event_cb(obj, ui_binding_delete_cb, LV_EVENT_DELETE, &ui_bindings[free_slot]);
+    return ui_binding_handle(free_slot);
+}
+
+// Object of a handle, NULL if the object has been deleted since the handle was made
+static lv_obj_t *ui_binding_get(lvgl_port_ui_obj_t handle)
+{
+    uint32_t slot = (handle & 0xFF) - 1;
+    if (slot >= LVGL_PORT_UI_OBJECTS || ui_bindings[slot].obj == NULL || ui_binding_handle(slot) != handle) {
+        return NULL;
+    }
+    return ui_bindings[slot].obj;
+}
+
+static void ui_queue_init(void)
+{
+    for (uint32_t i = 0; i < LVGL_PORT_UI_QUEUE_LEN; i++) {
+        ui_queue[i].seq = i;
+    }
+}
+
+static ui_cmd_t *ui_queue_claim(uint32_t *pos_out)
+{
+    uint32_t pos = __atomic_load_n(&ui_queue_head, __ATOMIC_RELAXED);
+    while (1) {
+        ui_cmd_t *cmd = &ui_queue[pos & (LVGL_PORT_UI_QUEUE_LEN - 1)];
+        int32_t diff = (int32_t)(__atomic_load_n(&cmd->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            // Slot is free at this lap, try to claim it (pos is reloaded on failure)
+            if (__atomic_compare_exchange_n(&ui_queue_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *pos_out = pos;
+                return cmd;
+            }
+        } else if (diff < 0) {
+            // The slot still holds a command from the previous lap: queue is full
+            __atomic_fetch_add(&ui_queue_dropped, 1, __ATOMIC_RELAXED);
+            return NULL;
+        } else {
+            // Another producer claimed this position, retry at the new head
+            pos = __atomic_load_n(&ui_queue_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static void ui_queue_publish(ui_cmd_t *cmd, uint32_t pos)
+{
+    __atomic_store_n(&cmd->seq, pos + 1, __ATOMIC_RELEASE);
+    lvgl_port_wake();
+}
+
+static void ui_cmd_apply(const ui_cmd_t *cmd)
+{
+    lv_obj_t *obj = ui_binding_get(cmd->obj);
+    if (obj == NULL) {
+        return; // Deleted after the command was queued, e.g. by a screen change
+    }
+
+    switch (cmd->type) {
+    case UI_CMD_SET_TEXT:
+        if (lv_obj_check_type(obj, &lv_label_class)) {
+            lv_label_set_text(obj, cmd->text);
+        }
+        break;
+    case UI_CMD_ADD_STATE:
+        lv_obj_add_state(obj, cmd->state);
+        break;
+    case UI_CMD_CLEAR_STATE:
+        lv_obj_clear_state(obj, cmd->state);
+        break;
+    case UI_CMD_SET_VALUE:
+#if LV_USE_SLIDER
+        if (lv_obj_check_type(obj, &lv_slider_class)) {
+            lv_slider_set_value(obj, cmd->value, LV_ANIM_OFF);
+            break;
+        }
+#endif
+#if LV_USE_BAR
+        if (lv_obj_check_type(obj, &lv_bar_class)) {
+            lv_bar_set_value(obj, cmd->value, LV_ANIM_OFF);
+            break;
+        }
+#endif
+#if LV_USE_ARC
+        if (lv_obj_check_type(obj, &lv_arc_class)) {
+            lv_arc_set_value(obj, cmd->value);
+        }
+#endif
+        break;
+    default:
+        break;
+    }
+}
+
+// Apply queued commands, at most one lap so that a busy producer cannot hold off rendering
+static void ui_queue_drain(void)
+{
+    for (int i = 0; i < LVGL_PORT_UI_QUEUE_LEN; i++) {
+        ui_cmd_t *cmd = &ui_queue[ui_queue_tail & (LVGL_PORT_UI_QUEUE_LEN - 1)];
+        if (__atomic_load_n(&cmd->seq, __ATOMIC_ACQUIRE) != ui_queue_tail + 1) {
+            break; // Empty, or the next producer has not published yet
+        }
+        ui_cmd_apply(cmd);
+        __atomic_store_n(&cmd->seq, ui_queue_tail + LVGL_PORT_UI_QUEUE_LEN, __ATOMIC_RELEASE);
+        ui_queue_tail++;
+    }
+}
+
+bool lvgl_port_ui_set_text(lvgl_port_ui_obj_t label, const char *text)
+{
+    uint32_t pos;
+    if (label == 0) {
+        return false;
+    }
+    ui_cmd_t *cmd = ui_queue_claim(&pos);
+    if (cmd == NULL) {
+        return false;
+    }
+    cmd->type = UI_CMD_SET_TEXT;
+    cmd->obj = label;
+    strlcpy(cmd->text, text, sizeof(cmd->text));
+    ui_queue_publish(cmd, pos);
+    return true;
+}
+
+bool lvgl_port_ui_set_state(lvgl_port_ui_obj_t obj, lv_state_t state, bool on)
+{
+    uint32_t pos;
+    if (obj == 0) {
+        return false;
+    }
+    ui_cmd_t *cmd = ui_queue_claim(&pos);
+    if (cmd == NULL) {
+        return false;
+    }
+    cmd->type = on ? UI_CMD_ADD_STATE : UI_CMD_CLEAR_STATE;
+    cmd->obj = obj;
+    cmd->state = state;
+    ui_queue_publish(cmd, pos);
+    return true;
+}
+
+bool lvgl_port_ui_set_value(lvgl_port_ui_obj_t obj, int32_t value)
+{
+    uint32_t pos;
+    if (obj == 0) {
+        return false;
+    }
+    ui_cmd_t *cmd = ui_queue_claim(&pos);
+    if (cmd == NULL) {
+        return false;
+    }
+    cmd->type = UI_CMD_SET_VALUE;
+    cmd->obj = obj;
+    cmd->value = value;
+    ui_queue_publish(cmd, pos);
+    return true;
+}
+
+uint32_t lvgl_port_ui_get_dropped(void)
+{
+    return __atomic_load_n(&ui_queue_dropped, __ATOMIC_RELAXED);
+}
+
+static lvgl_port_cycle_cb_t cycle_cb = NULL; // Called before every lv_timer_handler()
+
+void lvgl_port_set_cycle_cb(lvgl_port_cycle_cb_t cb)
+{
+    cycle_cb = cb;
+}
+
+/*
+ * With the touch interrupt wired, the touchpad is only polled while it is pressed or a scroll is still coasting.
+ * Otherwise the read timer would wake the LVGL task every LV_INDEV_DEF_READ_PERIOD ms on an idle screen.
+ */
+static void touch_poll_update(void)
+{
+    lv_indev_t *indev = NULL;
+    while ((indev = lv_indev_get_next(indev)) != NULL) {
+        if (indev->driver->type != LV_INDEV_TYPE_POINTER || !indev->driver->read_timer) {
+            continue;
+        }
+        if (__atomic_exchange_n(&touch_irq_pending, false, __ATOMIC_ACQUIRE)) {
+            lv_timer_resume(indev->driver->read_timer);
+            lv_timer_ready(indev->driver->read_timer); // Read the new touch in this cycle
+        } else if (indev->proc.state == LV_INDEV_STATE_RELEASED && indev->proc.types.pointer.scroll_obj == NULL) {
+            lv_timer_pause(indev->driver->read_timer);
+        }
+    }
+}
+
 static void lvgl_port_task(void *arg)
 {
     ESP_LOGD(TAG, "Starting LVGL task"); // Log the task start
 
-    uint32_t task_delay_ms = LVGL_PORT_TASK_MAX_DELAY_MS; // Set initial task delay
+    uint32_t task_delay_ms = LV_NO_TIMER_READY; // Time until the next LVGL timer is due
     while (1) {
         if (lvgl_port_lock(-1)) { // Try to lock the LVGL mutex
+            ui_queue_drain(); // Apply UI commands queued by other tasks
+            if (cycle_cb) {
+                cycle_cb(); // Deliver work queued by other tasks before rendering
+            }
+            if (touch_irq_enabled) {
+                touch_poll_update();
+            }
+            uint32_t frame_start = FRAME_CLOCK();
+            frame_begin();
             task_delay_ms = lv_timer_handler(); // Handle LVGL timer events
+#if LVGL_PORT_ASYNC_COPY
+            async_copy_wait(); // Only waits if a refresh synced areas but flushed nothing
+#endif
+            frame_end(frame_start);
             lvgl_port_unlock(); // Unlock the mutex
         }
-        // Ensure the delay time is within limits
-        if (task_delay_ms > LVGL_PORT_TASK_MAX_DELAY_MS) {
-            task_delay_ms = LVGL_PORT_TASK_MAX_DELAY_MS;
-        } else if (task_delay_ms < LVGL_PORT_TASK_MIN_DELAY_MS) {
-            task_delay_ms = LVGL_PORT_TASK_MIN_DELAY_MS;
+        // Sleep until the next timer is due or another task wakes us. At least one tick, so that a timer that is
+        // always ready cannot starve the idle task.
+        TickType_t wait_ticks = portMAX_DELAY;
+        if (task_delay_ms != LV_NO_TIMER_READY) {
+            wait_ticks = pdMS_TO_TICKS(task_delay_ms);
+            if (wait_ticks == 0) {
+                wait_ticks = 1;
+            }
         }
-        vTaskDelay(pdMS_TO_TICKS(task_delay_ms)); // Delay the task for the calculated time
+        ulTaskNotifyTakeIndexed(LVGL_PORT_WAKE_INDEX, pdTRUE, wait_ticks);
     }
 }
 
@@ -507,9 +1646,18 @@ esp_err_t lvgl_port_init(esp_lcd_panel_handle_t lcd_handle, esp_lcd_touch_handle
 {
     lv_init(); // Initialize LVGL
     ESP_ERROR_CHECK(tick_init()); // Initialize the tick timer
+#if LVGL_PORT_ASYNC_COPY
+    async_copy_init(); // Before display_init(), which picks the buffer copy
+#endif
+#if LVGL_PORT_BAND_BLEND
+    band_init(); // Before display_init(), which installs the banded blend
+#endif
 
     lv_disp_t *disp = display_init(lcd_handle); // Initialize the display
     assert(disp); // Ensure the display initialization was successful
+#if LVGL_PORT_FRAME_OVERLAY
+    frame_overlay_create(); // The LVGL task is not running yet, no lock needed
+#endif
 
     if (tp_handle) {
         lv_indev_t *indev = indev_init(tp_handle); // Initialize the touchpad input device
@@ -526,10 +1674,15 @@ esp_err_t lvgl_port_init(esp_lcd_panel_handle_t lcd_handle, esp_lcd_touch_handle
         esp_lcd_touch_set_swap_xy(tp_handle, true); // Swap X and Y coordinates
         esp_lcd_touch_set_mirror_x(tp_handle, true); // Mirror X coordinates
 #endif
+
+        // Without an interrupt pin the touchpad is polled every LV_INDEV_DEF_READ_PERIOD ms
+        touch_irq_enabled = (esp_lcd_touch_register_interrupt_callback(tp_handle, touch_isr) == ESP_OK);
+        ESP_LOGI(TAG, "Touch %s", touch_irq_enabled ? "interrupt driven" : "polled");
     }
 
     lvgl_mux = xSemaphoreCreateRecursiveMutex(); // Create a recursive mutex for LVGL
     assert(lvgl_mux); // Ensure mutex creation was successful
+    ui_queue_init(); // Mark every slot of the UI command queue free
 
     ESP_LOGI(TAG, "Create LVGL task"); // Log task creation
     BaseType_t core_id = (LVGL_PORT_TASK_CORE < 0) ? tskNO_AFFINITY : LVGL_PORT_TASK_CORE; // Determine core ID for the task
@@ -543,18 +1696,161 @@ esp_err_t lvgl_port_init(esp_lcd_panel_handle_t lcd_handle, esp_lcd_touch_handle
     return ESP_OK; // Return success
 }
 
-bool lvgl_port_lock(int timeout_ms)
+/*
+ * LVGL mutex statistics. The per-site counters are only updated by the task that owns the mutex, the spinlock only
+ * keeps `lvgl_port_get_lock_stats()` from copying a half-updated site.
+ */
+static const uint32_t lock_hist_bounds_us[LVGL_PORT_LOCK_HIST_BUCKETS] = {
+    100, 1000, 5000, 10000, 20000, 50000, 100000, UINT32_MAX
+};
+
+static lvgl_port_lock_stats_t lock_stats;
+static portMUX_TYPE lock_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t lock_depth;                              // Recursion depth of the current owner
+static int64_t lock_hold_start;                          // When the outermost lock was taken
+static lvgl_port_lock_site_t *lock_hold_site;            // Site of the outermost lock, NULL if not tracked
+
+static int lock_hist_bucket(uint32_t us)
+{
+    int bucket = 0;
+    while (us >= lock_hist_bounds_us[bucket] && bucket < LVGL_PORT_LOCK_HIST_BUCKETS - 1) {
+        bucket++;
+    }
+    return bucket;
+}
+
+// Call site entry, sites are identified by the function name pointer and line
+static lvgl_port_lock_site_t *lock_site_get(const char *func, int line)
+{
+    for (uint32_t i = 0; i < lock_stats.site_count; i++) {
+        if (lock_stats.sites[i].func == func && lock_stats.sites[i].line == line) {
+            return &lock_stats.sites[i];
+        }
+    }
+    if (lock_stats.site_count == LVGL_PORT_LOCK_SITES) {
+        return NULL;
+    }
+
+    lvgl_port_lock_site_t *site = &lock_stats.sites[lock_stats.site_count];
+    site->func = func;
+    site->line = line;
+    lock_stats.site_count++;
+    return site;
+}
+
+uint32_t lvgl_port_lock_hist_bound_us(int bucket)
+{
+    return (bucket >= 0 && bucket < LVGL_PORT_LOCK_HIST_BUCKETS) ? lock_hist_bounds_us[bucket] : UINT32_MAX;
+}
+
+bool lvgl_port_lock_at(int timeout_ms, const char *func, int line)
 {
     assert(lvgl_mux && "lvgl_port_init must be called first"); // Ensure the mutex is initialized
 
     const TickType_t timeout_ticks = (timeout_ms < 0) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms); // Convert timeout to ticks
-    return xSemaphoreTakeRecursive(lvgl_mux, timeout_ticks) == pdTRUE; // Try to take the mutex
+    const int64_t start = esp_timer_get_time();
+    if (xSemaphoreTakeRecursive(lvgl_mux, timeout_ticks) != pdTRUE) { // Try to take the mutex
+        // Not the owner, so the site table may be changing: only count the timeout if the site already exists
+        taskENTER_CRITICAL(&lock_stats_mux);
+        for (uint32_t i = 0; i < lock_stats.site_count; i++) {
+            if (lock_stats.sites[i].func == func && lock_stats.sites[i].line == line) {
+                lock_stats.sites[i].timeouts++;
+                break;
+            }
+        }
+        taskEXIT_CRITICAL(&lock_stats_mux);
+        return false;
+    }
+    if (lock_depth++ > 0) {
+        return true; // Recursive lock, the outermost one is already being measured
+    }
+
+    const int64_t now = esp_timer_get_time();
+    const uint32_t wait_us = (uint32_t)(now - start);
+
+    taskENTER_CRITICAL(&lock_stats_mux);
+    lvgl_port_lock_site_t *site = lock_site_get(func, line);
+    if (site) {
+        site->count++;
+        site->wait_us_total += wait_us;
+        site->wait_hist[lock_hist_bucket(wait_us)]++;
+        if (wait_us > site->wait_us_max) {
+            site->wait_us_max = wait_us;
+        }
+    } else {
+        lock_stats.site_overflow++;
+    }
+    taskEXIT_CRITICAL(&lock_stats_mux);
+
+    lock_hold_site = site;
+    lock_hold_start = now;
+    return true;
 }
 
 void lvgl_port_unlock(void)
 {
     assert(lvgl_mux && "lvgl_port_init must be called first"); // Ensure the mutex is initialized
+
+    if (--lock_depth > 0) {
+        xSemaphoreGiveRecursive(lvgl_mux); // Inner lock of a recursive sequence
+        return;
+    }
+
+    const uint32_t hold_us = (uint32_t)(esp_timer_get_time() - lock_hold_start);
+    lvgl_port_lock_site_t *site = lock_hold_site;
+    const bool long_hold = hold_us > LVGL_PORT_LOCK_WARN_MS * 1000;
+
+    taskENTER_CRITICAL(&lock_stats_mux);
+    if (site) {
+        site->hold_us_total += hold_us;
+        site->hold_hist[lock_hist_bucket(hold_us)]++;
+        if (hold_us > site->hold_us_max) {
+            site->hold_us_max = hold_us;
+        }
+    }
+    if (long_hold) {
+        lock_stats.long_holds++;
+    }
+    if (site && hold_us > lock_stats.longest.hold_us) {
+        strlcpy(lock_stats.longest.task, pcTaskGetName(NULL), sizeof(lock_stats.longest.task));
+        lock_stats.longest.func = site->func;
+        lock_stats.longest.line = site->line;
+        lock_stats.longest.hold_us = hold_us;
+    }
+    taskEXIT_CRITICAL(&lock_stats_mux);
+
     xSemaphoreGiveRecursive(lvgl_mux); // Release the mutex
+    lvgl_port_wake(); // Another task may have changed widgets, render them now
+
+    if (long_hold && site) {
+        ESP_LOGW(TAG, "LVGL mutex held for %lu ms by task %s, locked at %s:%d",
+                 hold_us / 1000, pcTaskGetName(NULL), site->func, site->line);
+    }
+}
+
+void lvgl_port_get_lock_stats(lvgl_port_lock_stats_t *stats)
+{
+    taskENTER_CRITICAL(&lock_stats_mux);
+    *stats = lock_stats;
+    taskEXIT_CRITICAL(&lock_stats_mux);
+}
+
+void lvgl_port_reset_lock_stats(void)
+{
+    taskENTER_CRITICAL(&lock_stats_mux);
+    // Keep the call sites so that a site currently holding the mutex stays valid
+    for (uint32_t i = 0; i < lock_stats.site_count; i++) {
+        lvgl_port_lock_site_t *site = &lock_stats.sites[i];
+        const char *func = site->func;
+        int line = site->line;
+        memset(site, 0, sizeof(*site));
+        site->func = func;
+        site->line = line;
+    }
+    lock_stats.site_overflow = 0;
+    lock_stats.long_holds = 0;
+    memset(&lock_stats.longest, 0, sizeof(lock_stats.longest));
+    taskEXIT_CRITICAL(&lock_stats_mux);
 }
 
 bool lvgl_port_notify_rgb_vsync(void)
@@ -565,6 +1861,10 @@ bool lvgl_port_notify_rgb_vsync(void)
         lvgl_port_flush_next_buf = lvgl_port_rgb_last_buf; // Set next buffer for flushing
         lvgl_port_rgb_last_buf = lvgl_port_rgb_next_buf; // Update the last buffer
     }
+#elif LVGL_PORT_DIRECT_MODE_TRIPLE
+    // Update the buffers that may be on screen, and wake the LVGL task if it waits for a free one
+    triple_vsync();
+    vTaskNotifyGiveFromISR(lvgl_task_handle, &need_yield);
 #elif LVGL_PORT_AVOID_TEAR_ENABLE
     // Notify that the current RGB frame buffer has been transmitted
     xTaskNotifyFromISR(lvgl_task_handle, ULONG_MAX, eNoAction, &need_yield); // Notify the LVGL task
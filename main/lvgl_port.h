@@ -9,6 +9,7 @@
 #include <stdint.h>
 
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
 #include "esp_lcd_types.h"
 #include "esp_lcd_touch.h"
 #include "lvgl.h"
@@ -29,12 +30,38 @@ extern "C" {
  * LVGL timer handle task related parameters, can be adjusted by users
  *
  */
-#define LVGL_PORT_TASK_MAX_DELAY_MS (CONFIG_EXAMPLE_LVGL_PORT_TASK_MAX_DELAY_MS)    // The maximum delay of the LVGL timer task, in milliseconds
-#define LVGL_PORT_TASK_MIN_DELAY_MS (CONFIG_EXAMPLE_LVGL_PORT_TASK_MIN_DELAY_MS)    // The minimum delay of the LVGL timer task, in milliseconds
 #define LVGL_PORT_TASK_STACK_SIZE   (CONFIG_EXAMPLE_LVGL_PORT_TASK_STACK_SIZE_KB * 1024) // The stack size of the LVGL timer task, in bytes
 #define LVGL_PORT_TASK_PRIORITY     (CONFIG_EXAMPLE_LVGL_PORT_TASK_PRIORITY)        // The priority of the LVGL timer task
 #define LVGL_PORT_TASK_CORE         (CONFIG_EXAMPLE_LVGL_PORT_TASK_CORE)            // The core of the LVGL timer task,
 // `-1` means the don't specify the core
+#define LVGL_PORT_UI_QUEUE_LEN      (CONFIG_EXAMPLE_LVGL_PORT_UI_QUEUE_LEN)         // Slots in the UI command queue, power of two
+#define LVGL_PORT_UI_TEXT_MAX       (48)                                            // Longest queued text, including the terminator
+#define LVGL_PORT_UI_OBJECTS        (16)                                            // Objects bound for UI commands at the same time
+
+/**
+ * LVGL mutex instrumentation parameters
+ *
+ */
+#define LVGL_PORT_LOCK_SITES        (16)                                            // Call sites tracked, later ones are counted as overflow
+#define LVGL_PORT_LOCK_HIST_BUCKETS (8)                                             // See lvgl_port_lock_hist_bound_us()
+#define LVGL_PORT_LOCK_WARN_MS      (CONFIG_EXAMPLE_LVGL_PORT_LOCK_WARN_MS)          // Holds longer than this are logged
+
+/**
+ * Frame timing parameters
+ *
+ */
+#define LVGL_PORT_FRAME_WINDOW      (64)                                            // Frames in the rolling statistics
+#ifdef CONFIG_EXAMPLE_LVGL_PORT_FRAME_OVERLAY
+#define LVGL_PORT_FRAME_OVERLAY     (1)                                             // Show the frame timing on screen
+#else
+#define LVGL_PORT_FRAME_OVERLAY     (0)
+#endif
+#define LVGL_PORT_FRAME_OVERLAY_PERIOD_MS   (500)                                   // Overlay refresh period
+#ifdef CONFIG_EXAMPLE_LVGL_PORT_BENCH
+#define LVGL_PORT_BENCH             (1)                                             // Build `lvgl_port_bench_run()`
+#else
+#define LVGL_PORT_BENCH             (0)
+#endif
 /**
  *
  * LVGL buffer related parameters, can be adjusted by users:
@@ -65,6 +92,8 @@ extern "C" {
  *      - 1: LCD double-buffer & LVGL full-refresh
  *      - 2: LCD triple-buffer & LVGL full-refresh
  *      - 3: LCD double-buffer & LVGL direct-mode (recommended)
+ *      - 4: LCD triple-buffer & LVGL direct-mode, never waits for vsync (same as 3 when rotated)
+ *      - 5: LCD double-buffer & LVGL partial mode in two internal RAM tiles (same as 3 when rotated)
  *
  */
 #define LVGL_PORT_AVOID_TEAR_MODE       (CONFIG_EXAMPLE_LVGL_PORT_AVOID_TEAR_MODE)
@@ -92,6 +121,20 @@ extern "C" {
 #elif LVGL_PORT_AVOID_TEAR_MODE == 3
 #define LVGL_PORT_LCD_RGB_BUFFER_NUMS   (2)
 #define LVGL_PORT_DIRECT_MODE           (1)
+#elif LVGL_PORT_AVOID_TEAR_MODE == 4
+#define LVGL_PORT_LCD_RGB_BUFFER_NUMS   (3)
+#define LVGL_PORT_DIRECT_MODE           (1)
+#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE == 0
+#define LVGL_PORT_DIRECT_MODE_TRIPLE    (1)
+#endif
+#elif LVGL_PORT_AVOID_TEAR_MODE == 5
+#define LVGL_PORT_LCD_RGB_BUFFER_NUMS   (2)
+#if EXAMPLE_LVGL_PORT_ROTATION_DEGREE == 0
+#define LVGL_PORT_TILED                 (1)
+#define LVGL_PORT_TILE_HEIGHT           (CONFIG_EXAMPLE_LVGL_PORT_TILE_HEIGHT)  // Lines of each tile at full width
+#else
+#define LVGL_PORT_DIRECT_MODE           (1)
+#endif
 #endif /* LVGL_PORT_AVOID_TEAR_MODE */
 
 #if EXAMPLE_LVGL_PORT_ROTATION_DEGREE == 0
@@ -115,6 +158,38 @@ extern "C" {
 #define LVGL_PORT_DIRECT_MODE           (0)
 #endif /* LVGL_PORT_AVOID_TEAR_ENABLE */
 
+/**
+ * Sync the two frame buffers of direct mode with the async memcpy (GDMA) while LVGL renders, see `async_buffer_copy()`.
+ * In mode 5 the tiles are written into the frame buffer the same way, see `async_tile_copy()`.
+ *
+ */
+#if (LVGL_PORT_DIRECT_MODE || LVGL_PORT_TILED) && EXAMPLE_LVGL_PORT_ROTATION_0 && defined(CONFIG_EXAMPLE_LVGL_PORT_ASYNC_COPY)
+#define LVGL_PORT_ASYNC_COPY            (1)
+#else
+#define LVGL_PORT_ASYNC_COPY            (0)
+#endif
+
+/**
+ * Blend large areas on both cores, the upper half by a worker task on the core the LVGL task does not use, see
+ * `band_blend()`
+ *
+ */
+#ifdef CONFIG_EXAMPLE_LVGL_PORT_BAND_BLEND
+#define LVGL_PORT_BAND_BLEND            (1)
+#else
+#define LVGL_PORT_BAND_BLEND            (0)
+#endif
+
+/**
+ * Blend semi-transparent fills, images and 4-bpp glyphs of RGB565 with the kernels of `lvgl_blend.h`
+ *
+ */
+#ifdef CONFIG_EXAMPLE_LVGL_PORT_FAST_BLEND
+#define LVGL_PORT_FAST_BLEND            (1)
+#else
+#define LVGL_PORT_FAST_BLEND            (0)
+#endif
+
 /**
  * @brief Initialize LVGL port
  *
@@ -131,20 +206,211 @@ esp_err_t lvgl_port_init(esp_lcd_panel_handle_t lcd_handle, esp_lcd_touch_handle
 /**
  * @brief Take LVGL mutex
  *
- * @param[in] timeout_ms: Timeout in [ms]. 0 will block indefinitely.
+ * The call site (function and line) is recorded for the mutex statistics, see `lvgl_port_get_lock_stats()`.
+ *
+ * @note Tasks other than the LVGL task should prefer the `lvgl_port_ui_*()` commands below, which never block.
+ *
+ * @param[in] timeout_ms: Timeout in [ms]. Negative will block indefinitely.
  *
  * @return
  *      - true:  Mutex was taken
  *      - false: Mutex was NOT taken
  */
-bool lvgl_port_lock(int timeout_ms);
+#define lvgl_port_lock(timeout_ms)  lvgl_port_lock_at((timeout_ms), __func__, __LINE__)
+
+/**
+ * @brief Take LVGL mutex on behalf of a call site, use `lvgl_port_lock()` instead
+ */
+bool lvgl_port_lock_at(int timeout_ms, const char *func, int line);
 
 /**
  * @brief Give LVGL mutex
  *
+ * When the outermost lock is released, its hold time is recorded for the call site that took it. A hold longer than
+ * `LVGL_PORT_LOCK_WARN_MS` is logged with the task name and call site.
  */
 void lvgl_port_unlock(void);
 
+/**
+ * @brief Wait and hold statistics of one `lvgl_port_lock()` call site
+ *
+ * Only the outermost lock of a recursive sequence is counted. Times are in microseconds.
+ */
+typedef struct {
+    const char *func;                                   // Function that took the mutex
+    int line;
+    uint32_t count;                                     // Successful locks
+    uint32_t timeouts;                                  // Locks that timed out
+    uint64_t wait_us_total;
+    uint64_t hold_us_total;
+    uint32_t wait_us_max;
+    uint32_t hold_us_max;
+    uint32_t wait_hist[LVGL_PORT_LOCK_HIST_BUCKETS];
+    uint32_t hold_hist[LVGL_PORT_LOCK_HIST_BUCKETS];
+} lvgl_port_lock_site_t;
+
+/**
+ * @brief Statistics of all call sites and the longest hold seen
+ */
+typedef struct {
+    lvgl_port_lock_site_t sites[LVGL_PORT_LOCK_SITES];
+    uint32_t site_count;
+    uint32_t site_overflow;                             // Locks from call sites that did not fit in the table
+    uint32_t long_holds;                                // Holds longer than LVGL_PORT_LOCK_WARN_MS
+    struct {
+        char task[configMAX_TASK_NAME_LEN];
+        const char *func;
+        int line;
+        uint32_t hold_us;
+    } longest;                                          // Longest single hold
+} lvgl_port_lock_stats_t;
+
+/**
+ * @brief Upper bound of a histogram bucket in microseconds, UINT32_MAX for the last bucket
+ */
+uint32_t lvgl_port_lock_hist_bound_us(int bucket);
+
+/**
+ * @brief Copy the mutex statistics, can be called from any task without taking the LVGL mutex
+ */
+void lvgl_port_get_lock_stats(lvgl_port_lock_stats_t *stats);
+
+/**
+ * @brief Clear the mutex statistics
+ */
+void lvgl_port_reset_lock_stats(void);
+
+/**
+ * @brief Wake the LVGL task so that it runs a cycle now
+ *
+ * The LVGL task sleeps until its next LVGL timer is due. `lvgl_port_unlock()` from another task and the UI command
+ * queue wake it themselves; call this after queueing other work for the LVGL task. Does nothing when called from
+ * the LVGL task itself.
+ */
+void lvgl_port_wake(void);
+
+/**
+ * @brief Callback run by the LVGL task on every cycle, with the LVGL mutex held, before `lv_timer_handler()`
+ */
+typedef void (*lvgl_port_cycle_cb_t)(void);
+
+/**
+ * @brief Set the per-cycle callback of the LVGL task
+ *
+ * @param[in] cb: Callback, or NULL to remove it
+ */
+void lvgl_port_set_cycle_cb(lvgl_port_cycle_cb_t cb);
+
+/**
+ * UI commands for other tasks
+ *
+ * The commands are put in a bounded lock-free queue and applied by the LVGL task at the start of its next cycle,
+ * in the order they were queued. The caller never takes the LVGL mutex, so it never waits for rendering.
+ *
+ * Commands address an object through a handle from `lvgl_port_ui_bind()`, not through the object pointer. Deleting
+ * the object invalidates its handle, so a command queued for a deleted object is ignored, even if a new object has
+ * since been created at the same address.
+ */
+
+/**
+ * @brief Handle of an object bound for UI commands, 0 is never a valid handle
+ */
+typedef uint32_t lvgl_port_ui_obj_t;
+
+/**
+ * @brief Bind an object for UI commands
+ *
+ * Call from the LVGL task or with the LVGL mutex held. The binding is released when the object is deleted.
+ *
+ * @return Handle for the `lvgl_port_ui_set_*()` functions, or 0 if `LVGL_PORT_UI_OBJECTS` objects are already bound
+ */
+lvgl_port_ui_obj_t lvgl_port_ui_bind(lv_obj_t *obj);
+
+/**
+ * @brief Queue `lv_label_set_text()`, the text is copied and truncated to `LVGL_PORT_UI_TEXT_MAX - 1` characters
+ *
+ * @return
+ *      - true:  Command queued
+ *      - false: Queue full or handle 0, the command was dropped
+ */
+bool lvgl_port_ui_set_text(lvgl_port_ui_obj_t label, const char *text);
+
+/**
+ * @brief Queue `lv_obj_add_state()` (on) or `lv_obj_clear_state()` (off)
+ *
+ * @return Same as `lvgl_port_ui_set_text()`
+ */
+bool lvgl_port_ui_set_state(lvgl_port_ui_obj_t obj, lv_state_t state, bool on);
+
+/**
+ * @brief Queue a value change of a bar, slider or arc, without animation
+ *
+ * @return Same as `lvgl_port_ui_set_text()`
+ */
+bool lvgl_port_ui_set_value(lvgl_port_ui_obj_t obj, int32_t value);
+
+/**
+ * @brief Number of UI commands dropped because the queue was full
+ */
+uint32_t lvgl_port_ui_get_dropped(void);
+
+/**
+ * @brief Average and maximum of one part of the frame time, in microseconds
+ */
+typedef struct {
+    uint32_t avg_us;
+    uint32_t max_us;
+} lvgl_port_frame_time_t;
+
+/**
+ * @brief Frame timing over the last `LVGL_PORT_FRAME_WINDOW` frames
+ *
+ * A frame is an `lv_timer_handler()` call that drew something. Its time is split into copies between frame buffers
+ * (`flush_dirty_copy()`, rotation and the direct mode buffer sync), waiting for the frame buffer switch (vsync) and
+ * the rest, which is mostly rendering.
+ */
+typedef struct {
+    uint32_t frames;                                    // Frames since start
+    uint32_t full_copies;                               // Full-screen copies into a rotated frame buffer since start
+    uint32_t window;                                    // Frames in the statistics below
+    uint32_t fps_x10;                                   // Frame rate over the window, in 0.1 fps
+    lvgl_port_frame_time_t cycle;                       // Whole `lv_timer_handler()` call
+    lvgl_port_frame_time_t render;                      // cycle - copy - vsync
+    lvgl_port_frame_time_t copy;
+    lvgl_port_frame_time_t vsync;
+} lvgl_port_frame_stats_t;
+
+/**
+ * @brief Copy the frame timing statistics, can be called from any task without taking the LVGL mutex
+ */
+void lvgl_port_get_frame_stats(lvgl_port_frame_stats_t *stats);
+
+#if LVGL_PORT_BENCH
+/**
+ * @brief Result of `lvgl_port_bench_run()`
+ */
+typedef struct {
+    uint32_t frames;                                    // Frames drawn during the run
+    uint32_t fps_x10;                                   // Frame rate over the whole run, in 0.1 fps
+    lvgl_port_frame_stats_t stats;                      // Frame timing at the end of the run
+} lvgl_port_bench_result_t;
+
+/**
+ * @brief Animate a blend-heavy scene on the top layer and measure the frame rate
+ *
+ * Semi-transparent panels with gradients, rounded corners and borders move over each other across the screen, so
+ * every frame blends large areas. Run it with each avoid tearing mode to compare them. The timing in `stats` covers
+ * the last `LVGL_PORT_FRAME_WINDOW` frames, so the run should be longer than that.
+ *
+ * @note Blocks the caller for `duration_ms`, must not be called from the LVGL task.
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_STATE: LVGL task not running, or called from it
+ */
+esp_err_t lvgl_port_bench_run(uint32_t duration_ms, lvgl_port_bench_result_t *result);
+#endif
+
 /**
  * @brief Notifies the LVGL task when the transmission of the RGB frame buffer is completed.
  *
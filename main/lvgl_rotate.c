@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include "esp_attr.h"
+#include "lvgl_rotate.h"
+
+/*
+ * 90 and 270 degree rotation is a transpose: the pixels of one source row land in one destination column. Copying a
+ * row at a time would touch a different destination cache line on every pixel, so the area is walked in tiles of
+ * `ROTATE_TILE` x `ROTATE_TILE` pixels, which keeps the source and destination lines of a tile in the cache. Inside a
+ * tile each destination row is written in order, two pixels per 32-bit store.
+ */
+#define ROTATE_TILE                 (32)                 // Pixels, one 64-byte cache line of RGB565
+#define ROTATE_MIN(a, b)            ((a) < (b) ? (a) : (b))
+
+typedef uint32_t __attribute__((may_alias)) rotate_pair_t; // Two RGB565 pixels in one store
+
+// Copy `n` pixels of a source column (stride `w`) to a destination row, forwards (90) or backwards (270)
+IRAM_ATTR static inline void rotate_copy_column(const uint16_t *src, uint16_t *dst, int n, int w, bool backwards)
+{
+    if (!backwards) {
+        if (n > 0 && ((uintptr_t)dst & 2)) {
+            *dst++ = *src;
+            src += w;
+            n--;
+        }
+        for (; n >= 2; n -= 2) {
+            *(rotate_pair_t *)dst = src[0] | ((uint32_t)src[w] << 16);
+            dst += 2;
+            src += 2 * w;
+        }
+        if (n) {
+            *dst = *src;
+        }
+    } else {
+        if (n > 0 && !((uintptr_t)dst & 2)) {
+            *dst-- = *src;
+            src += w;
+            n--;
+        }
+        for (; n >= 2; n -= 2) {
+            *(rotate_pair_t *)(dst - 1) = src[w] | ((uint32_t)src[0] << 16);
+            dst -= 2;
+            src += 2 * w;
+        }
+        if (n) {
+            *dst = *src;
+        }
+    }
+}
+
+IRAM_ATTR void lvgl_rotate_copy(const uint16_t *from, uint16_t *to, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end,
+                                uint16_t w, uint16_t h, uint16_t rotation)
+{
+    int from_index = 0;                                   // Index for source buffer
+    int to_index = 0;                                     // Index for destination buffer
+    int to_index_const = 0;                               // Constant index for destination buffer
+
+    switch (rotation) {
+    case 90:
+    case 270:
+        for (int tile_y = y_start; tile_y <= y_end; tile_y += ROTATE_TILE) {
+            const int rows = ROTATE_MIN(ROTATE_TILE, y_end + 1 - tile_y);
+            for (int tile_x = x_start; tile_x <= x_end; tile_x += ROTATE_TILE) {
+                const int tile_x_end = ROTATE_MIN(tile_x + ROTATE_TILE - 1, x_end);
+                for (int from_x = tile_x; from_x <= tile_x_end; from_x++) {
+                    from_index = tile_y * w + from_x;    // Top of the source column inside the tile
+                    if (rotation == 90) {
+                        to_index = (w - from_x - 1) * h + tile_y;
+                    } else {
+                        to_index = from_x * h + (h - tile_y - 1);
+                    }
+                    rotate_copy_column(from + from_index, to + to_index, rows, w, rotation == 270);
+                }
+            }
+        }
+        break;
+    case 180:
+        to_index_const = h * w - x_start - 1;            // Calculate constant index for 180-degree rotation
+        for (int from_y = y_start; from_y < y_end + 1; from_y++) {
+            from_index = from_y * w + x_start;           // Calculate index in the source buffer
+            to_index = to_index_const - from_y * w;      // Calculate index in the destination buffer
+            for (int from_x = x_start; from_x < x_end + 1; from_x++) {
+                *(to + to_index) = *(from + from_index);  // Copy pixel
+                from_index += 1;                          // Move to the next pixel in the source
+                to_index -= 1;                            // Move to the next pixel in the destination
+            }
+        }
+        break;
+    default:
+        break;                                             // Do nothing for unsupported rotation angles
+    }
+}
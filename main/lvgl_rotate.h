@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Copy an area of an RGB565 frame into a rotated frame
+ *
+ * @param[in] from Source frame, `w` x `h` pixels
+ * @param[out] to Destination frame, `h` x `w` pixels for 90 and 270, `w` x `h` for 180
+ * @param[in] x_start, y_start, x_end, y_end Inclusive source area
+ * @param[in] rotation 90, 180 or 270 degrees; any other value copies nothing
+ *
+ * Kept free of LVGL and driver types so that the host tests can build it.
+ */
+void lvgl_rotate_copy(const uint16_t *from, uint16_t *to, uint16_t x_start, uint16_t y_start, uint16_t x_end, uint16_t y_end,
+                      uint16_t w, uint16_t h, uint16_t rotation);
+
+#ifdef __cplusplus
+}
+#endif
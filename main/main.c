@@ -4,41 +4,21 @@
 #include "waveshare_rgb_lcd_port.h"
 #include "lvgl.h"
 #include "screen_manager.h"
-#include "manual_content.h"
-#include "modbus_content.h"
-#include "testing_content.h"
 #include "rs485_handler.h"
-#include "program_content.h"
 #include "style_manager.h"
+#include "result_log.h"
+#include "console_handler.h"
+#include "modbus_slave.h"
+#include "modbus_cache.h"
+#include "modbus_command.h"
+#include "nvs_flash.h"
+#include "app_events.h"
+#include "app_state.h"
 
 
 
 static const char *MAIN_TAG = "main_app";
 
-// Function to update active screens, called from main loop
-static void update_active_screen(void) {
-    screen_type_t current_screen = screen_manager_get_current_screen();
-    
-    // Kutsu vain aktiivisen näytön päivitysfunktiota
-    switch(current_screen) {
-        case SCREEN_MANUAL:
-            manual_content_update();
-            break;
-        case SCREEN_MODBUS:
-            modbus_content_update();
-            break;
-        case SCREEN_TESTING:
-            testing_content_update();
-            break;
-        case SCREEN_PROGRAM:
-            program_content_update();
-            break;
-        default:
-            // Etusivu tai muu näyttö
-            break;
-    }
-}
-
 void app_main(void)
 {
     ESP_LOGI(MAIN_TAG, "Initializing display");
@@ -47,22 +27,47 @@ void app_main(void)
     // Alusta tyylit
     style_manager_init();
 
+    // NVS: väylän slave-taulukko ja asetukset
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(MAIN_TAG, "Failed to initialize NVS: %d", ret);
+    }
+
     ESP_LOGI(MAIN_TAG, "Initializing RS485 communication");
-    esp_err_t ret = rs485_init();
+    ret = rs485_init();
     if (ret != ESP_OK) {
         ESP_LOGE(MAIN_TAG, "Failed to initialize RS485: %d", ret);
     } else {
         ESP_LOGI(MAIN_TAG, "RS485 initialized successfully");
     }
+    modbus_slave_load();
+    modbus_cache_init();
+    ret = modbus_command_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(MAIN_TAG, "Failed to start Modbus command task: %d", ret);
+    }
     
+    ESP_LOGI(MAIN_TAG, "Initializing result log");
+    ret = result_log_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(MAIN_TAG, "Failed to initialize result log: %d", ret);
+    }
+
+    app_state_init();
+
     ESP_LOGI(MAIN_TAG, "Initializing screen management");
     if (lvgl_port_lock(-1)) {
         screen_manager_init();
+        lvgl_port_set_cycle_cb(app_events_dispatch);
         lvgl_port_unlock();
     }
-    
-    while (1) {
-        update_active_screen();
-        vTaskDelay(pdMS_TO_TICKS(10));
-    }
+
+    ESP_LOGI(MAIN_TAG, "Starting console");
+    console_init();
+
+    // Näkymät päivittyvät tapahtumista (app_events.h), pääsilmukkaa ei tarvita
 }
\ No newline at end of file
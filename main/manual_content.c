@@ -5,6 +5,9 @@
 #include "esp_log.h"
 #include "rs485_handler.h"
 #include "modbus_handler.h"
+#include "modbus_command.h"
+#include "app_state.h"
+#include "app_events.h"
 #include <stdio.h>
 #include <string.h>
 #include "fonts/my_custom_fonts.h"
@@ -12,34 +15,44 @@
 
 static const char *TAG = "manual_content";
 
-static lv_obj_t* relay_leds[8] = {NULL};
-static bool is_screen_active = false;
-static bool rs485_initialized = false;  // Lisää tämä globaaliksi muuttujaksi
+static lv_obj_t* relay_leds[OPTA_RELAY_COUNT] = {NULL};
+static uint32_t shown_relays_version;
+
+#define RELAY_LED_ON_COLOR      (0x00ff00)
+#define RELAY_LED_OFF_COLOR     (0x888888)
+
+// Ledit piirretään app_state-releiden tilasta, vain kun versio on muuttunut
+static void render_relays(bool force) {
+    if (!force && app_state_version(APP_STATE_RELAYS) == shown_relays_version) {
+        return;
+    }
+    uint8_t relays;
+    shown_relays_version = app_state_get_relays(&relays);
+
+    for (int i = 0; i < OPTA_RELAY_COUNT; i++) {
+        if (relay_leds[i]) {
+            bool on = relays & (1u << i);
+            lv_obj_set_style_bg_color(relay_leds[i],
+                lv_color_hex(on ? RELAY_LED_ON_COLOR : RELAY_LED_OFF_COLOR), 0);
+        }
+    }
+}
+
+static void state_changed_msg_cb(lv_event_t *e) {
+    render_relays(false);
+}
 
 static void relay_btn_event_cb(lv_event_t *e) {
     int relay_index = (int)lv_event_get_user_data(e);
     int relay_num = relay_index + 1;
     
-    if (relay_leds[relay_index]) {
-        lv_obj_t* led = relay_leds[relay_index];
-        lv_color_t current_color = lv_obj_get_style_bg_color(led, 0);
-        lv_color_t green_color = lv_color_hex(0x00ff00);
-        
-        // Check if colors match (simplified check)
-        bool is_on = (current_color.full == green_color.full);
-        
-        // Lähetä Modbus-komento kaikille releille 1-8
-        uint8_t new_state = is_on ? 0 : 1;
-        esp_err_t ret = modbus_toggle_relay(relay_num, new_state);
-        
-        if (ret == ESP_OK) {
-            // Vaihda LEDin väri vain jos Modbus-komento onnistui
-            lv_obj_set_style_bg_color(led, 
-                is_on ? lv_color_hex(0x888888) : lv_color_hex(0x00ff00), 0);
-        } else {
-            // LED pysyy samassa tilassa, koska komentoa ei suoritettu onnistuneesti
-        }
-    }
+    uint8_t relays;
+    app_state_get_relays(&relays);
+    bool is_on = relays & (1u << relay_index);
+    
+    // Kirjoitus jonotetaan, onnistuessaan se päivittää releen tilan (app_state), josta ledi piirretään
+    uint8_t new_state = is_on ? 0 : 1;
+    modbus_command_set_relay(relay_num, new_state);
 }
 
 static void create_relay_button(lv_obj_t* parent, int relay_num, int x_pos, int y_pos) {
@@ -61,7 +74,7 @@ static void create_relay_button(lv_obj_t* parent, int relay_num, int x_pos, int
     lv_obj_set_size(status_led, 16, 16);
     lv_obj_set_style_pad_all(status_led, 0, 0);
     lv_obj_set_style_radius(status_led, LV_RADIUS_CIRCLE, 0);
-    lv_obj_set_style_bg_color(status_led, lv_color_hex(0x888888), 0);
+    lv_obj_set_style_bg_color(status_led, lv_color_hex(RELAY_LED_OFF_COLOR), 0);
     lv_obj_set_style_border_width(status_led, 0, 0);
     lv_obj_set_style_shadow_width(status_led, 0, 0);
     lv_obj_set_style_bg_opa(status_led, LV_OPA_COVER, 0);
@@ -77,6 +90,8 @@ void manual_content_create(lv_obj_t *parent) {
     lv_label_set_text(header, "KÄSIKÄYTTÖ");
     lv_obj_align(header, LV_ALIGN_TOP_MID, 0, 20);
     lv_obj_add_style(header, &style_subtitle, 0);
+    lv_msg_subscribe_obj(APP_EVENT_STATE_CHANGED, header, NULL);
+    lv_obj_add_event_cb(header, state_changed_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
     
     create_relay_button(parent, 1, 80, 80);
     create_relay_button(parent, 2, 200, 80);
@@ -86,15 +101,11 @@ void manual_content_create(lv_obj_t *parent) {
     create_relay_button(parent, 6, 200, 180);
     create_relay_button(parent, 7, 320, 180);
     create_relay_button(parent, 8, 440, 180);
-}
-
-bool manual_content_update(void) {
-    is_screen_active = screen_manager_is_screen_active(SCREEN_MANUAL);
-    return is_screen_active;
+    render_relays(true);
 }
 
 void manual_content_deinit(void) {
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < OPTA_RELAY_COUNT; i++) {
         relay_leds[i] = NULL;
     }
 }
\ No newline at end of file
@@ -10,14 +10,6 @@
  */
 void manual_content_create(lv_obj_t *parent);
 
-/**
- * @brief Update manual control screen content (called from screen_manager)
- * 
- * @return true if screen is active
- * @return false if screen is not active
- */
-bool manual_content_update(void);
-
 /**
  * @brief Clean up manual control screen resources
  */
@@ -0,0 +1,168 @@
+/**
+ * Modbus Cache Functions
+ *
+ * Ensimmäinen pyytäjä tekee väyläpyynnön itse, muut odottavat saman
+ * merkinnän tapahtumabittiä. Merkinnät kierrätetään vanhimmasta, mutta
+ * kesken olevaa merkintää ei koskaan kierrätetä.
+ */
+
+#include "modbus_cache.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "modbus_handler.h"
+
+typedef struct {
+    uint8_t slave_id;
+    uint8_t function;
+    uint16_t address;
+    uint16_t count;
+    bool pending;                   // Väyläpyyntö kesken
+    bool valid;                     // values ja result ovat voimassa
+    esp_err_t result;
+    TickType_t completed;           // Valmistumisaika
+    uint32_t generation;            // Kasvaa jokaisen väyläpyynnön alussa
+    uint16_t values[MODBUS_MAX_READ_REGISTERS];
+} cache_entry_t;
+
+static cache_entry_t entries[MODBUS_CACHE_ENTRIES];
+static SemaphoreHandle_t cache_mutex = NULL;
+static EventGroupHandle_t done_events = NULL;
+static modbus_cache_stats_t stats;
+
+_Static_assert(MODBUS_CACHE_ENTRIES <= 24, "Tapahtumaryhmässä on 24 bittiä");
+
+esp_err_t modbus_cache_init(void)
+{
+    if (cache_mutex == NULL) {
+        cache_mutex = xSemaphoreCreateMutex();
+        done_events = xEventGroupCreate();
+        if (cache_mutex == NULL || done_events == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+static cache_entry_t *find_entry(uint8_t slave_id, uint8_t function, uint16_t address, uint16_t count)
+{
+    for (int i = 0; i < MODBUS_CACHE_ENTRIES; i++) {
+        cache_entry_t *e = &entries[i];
+        if ((e->pending || e->valid) && e->slave_id == slave_id && e->function == function &&
+            e->address == address && e->count == count) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Vapaa tai vanhin valmis merkintä, NULL jos kaikki ovat kesken
+static cache_entry_t *claim_entry(TickType_t now)
+{
+    cache_entry_t *oldest = NULL;
+    for (int i = 0; i < MODBUS_CACHE_ENTRIES; i++) {
+        cache_entry_t *e = &entries[i];
+        if (e->pending) {
+            continue;
+        }
+        if (!e->valid) {
+            return e;
+        }
+        if (oldest == NULL || now - e->completed > now - oldest->completed) {
+            oldest = e;
+        }
+    }
+    return oldest;
+}
+
+esp_err_t modbus_read_shared(uint8_t slave_id, uint16_t register_addr, uint16_t count, uint16_t *values,
+                             uint32_t max_age_ms)
+{
+    if (cache_mutex == NULL || count == 0 || count > MODBUS_MAX_READ_REGISTERS) {
+        return modbus_read_holding_registers(slave_id, register_addr, count, values);
+    }
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    stats.requests++;
+
+    TickType_t now = xTaskGetTickCount();
+    cache_entry_t *e = find_entry(slave_id, MODBUS_READ_HOLDING_REGISTERS, register_addr, count);
+
+    // Tuore valmis tulos
+    if (e && !e->pending && e->result == ESP_OK && now - e->completed <= pdMS_TO_TICKS(max_age_ms)) {
+        memcpy(values, e->values, count * sizeof(uint16_t));
+        stats.fresh_hits++;
+        xSemaphoreGive(cache_mutex);
+        return ESP_OK;
+    }
+
+    // Sama luku on jo kesken: odota sen tulosta
+    if (e && e->pending) {
+        EventBits_t bit = BIT(e - entries);
+        uint32_t generation = e->generation;
+        stats.joined++;
+        xSemaphoreGive(cache_mutex);
+
+        EventBits_t bits = xEventGroupWaitBits(done_events, bit, pdFALSE, pdTRUE,
+                                               pdMS_TO_TICKS(2 * MODBUS_BUS_LOCK_TIMEOUT_MS));
+
+        esp_err_t ret = ESP_ERR_TIMEOUT;
+        xSemaphoreTake(cache_mutex, portMAX_DELAY);
+        // Merkintä on voinut kierrättyä toiselle luvulle odotuksen aikana
+        if ((bits & bit) && e->valid && e->slave_id == slave_id && e->address == register_addr &&
+            e->count == count && e->generation == generation) {
+            ret = e->result;
+            if (ret == ESP_OK) {
+                memcpy(values, e->values, count * sizeof(uint16_t));
+            }
+        }
+        xSemaphoreGive(cache_mutex);
+        return ret;
+    }
+
+    // Uusi luku: varaa merkintä ja tee väyläpyyntö itse
+    if (e == NULL) {
+        e = claim_entry(now);
+    }
+    if (e == NULL) {
+        stats.bypassed++;
+        xSemaphoreGive(cache_mutex);
+        return modbus_read_holding_registers(slave_id, register_addr, count, values);
+    }
+
+    e->slave_id = slave_id;
+    e->function = MODBUS_READ_HOLDING_REGISTERS;
+    e->address = register_addr;
+    e->count = count;
+    e->pending = true;
+    e->valid = false;
+    e->generation++;
+    stats.bus_reads++;
+    EventBits_t bit = BIT(e - entries);
+    xEventGroupClearBits(done_events, bit);
+    xSemaphoreGive(cache_mutex);
+
+    // Merkintä on kesken, joten kukaan muu ei lue tai kierrätä sitä
+    esp_err_t ret = modbus_read_holding_registers(slave_id, register_addr, count, e->values);
+
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    e->pending = false;
+    e->valid = true;
+    e->result = ret;
+    e->completed = xTaskGetTickCount();
+    if (ret == ESP_OK) {
+        memcpy(values, e->values, count * sizeof(uint16_t));
+    }
+    xEventGroupSetBits(done_events, bit);
+    xSemaphoreGive(cache_mutex);
+
+    return ret;
+}
+
+void modbus_cache_get_stats(modbus_cache_stats_t *out)
+{
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(cache_mutex);
+}
@@ -0,0 +1,46 @@
+/**
+ * Modbus Cache Header
+ *
+ * Jaetut rekisteriluvut. Samaa slavea, funktiokoodia ja aluetta koskevat
+ * pyynnöt yhdistetään: jos sama luku on jo kesken, pyytäjä odottaa sen
+ * tulosta, ja jos se on valmistunut max_age_ms sisällä, tulos palautetaan
+ * suoraan. Väylälle lähtee siis yksi pyyntö, jonka tulos jaetaan kaikille.
+ */
+
+#ifndef MODBUS_CACHE_H
+#define MODBUS_CACHE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Samanaikaisesti seurattavien eri lukujen määrä
+#define MODBUS_CACHE_ENTRIES        (8)
+
+typedef struct {
+    uint32_t requests;              // modbus_read_shared()-kutsut
+    uint32_t bus_reads;             // Niistä väylälle lähteneet
+    uint32_t joined;                // Liittyi kesken olevaan lukuun
+    uint32_t fresh_hits;            // Palautettiin tuore tulos
+    uint32_t bypassed;              // Taulukko täynnä, luettiin suoraan
+} modbus_cache_stats_t;
+
+/**
+ * @brief Alustaa jaetut luvut
+ */
+esp_err_t modbus_cache_init(void);
+
+/**
+ * @brief Lukee holding-rekisterit jakaen tuloksen samanaikaisten lukijoiden kesken
+ *
+ * @param max_age_ms Kuinka vanha valmis tulos kelpaa (0 = vain kesken oleva luku jaetaan)
+ * @return esp_err_t Kuten modbus_read_holding_registers()
+ */
+esp_err_t modbus_read_shared(uint8_t slave_id, uint16_t register_addr, uint16_t count, uint16_t *values,
+                             uint32_t max_age_ms);
+
+/**
+ * @brief Kopioi jaettujen lukujen tilastot
+ */
+void modbus_cache_get_stats(modbus_cache_stats_t *stats);
+
+#endif /* MODBUS_CACHE_H */
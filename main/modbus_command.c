@@ -0,0 +1,111 @@
+/**
+ * Modbus Command Functions
+ *
+ * Yksi taski tyhjentää jonon, joten komennot lähtevät väylälle samassa
+ * järjestyksessä kuin ne jonotettiin (esim. napin painallus ennen
+ * vapautusta). Väylän varaus ja uusintayritykset tapahtuvat tässä
+ * taskissa eivätkä koskaan LVGL-taskissa.
+ */
+
+#include "modbus_command.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "modbus_handler.h"
+#include "app_events.h"
+
+static const char *TAG = "modbus_command";
+
+static QueueHandle_t command_queue = NULL;
+static modbus_command_status_t status;
+static portMUX_TYPE status_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void command_task(void *arg)
+{
+    modbus_command_t command;
+
+    for (;;) {
+        xQueueReceive(command_queue, &command, portMAX_DELAY);
+
+        esp_err_t ret;
+        if (command.type == MODBUS_COMMAND_SET_RELAY) {
+            ret = modbus_toggle_relay((uint8_t)command.address, (uint8_t)command.value);
+        } else {
+            ret = modbus_write_single_register(command.slave_id, command.address, command.value);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Komento %d osoite 0x%04X arvo %u epäonnistui: %s", command.type, command.address,
+                     command.value, esp_err_to_name(ret));
+        }
+
+        taskENTER_CRITICAL(&status_lock);
+        status.command = command;
+        status.result = ret;
+        status.completed++;
+        if (ret != ESP_OK) {
+            status.failed++;
+        }
+        taskEXIT_CRITICAL(&status_lock);
+        app_events_post(APP_EVENT_BUS_COMMAND);
+    }
+}
+
+esp_err_t modbus_command_init(void)
+{
+    if (command_queue != NULL) {
+        return ESP_OK;
+    }
+    command_queue = xQueueCreate(MODBUS_COMMAND_QUEUE_LEN, sizeof(modbus_command_t));
+    if (command_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(command_task, "modbus_cmd", 3072, NULL, 2, NULL) != pdPASS) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t post(const modbus_command_t *command)
+{
+    if (command_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xQueueSend(command_queue, command, 0) != pdTRUE) {
+        taskENTER_CRITICAL(&status_lock);
+        status.dropped++;
+        taskEXIT_CRITICAL(&status_lock);
+        ESP_LOGW(TAG, "Komentojono täynnä, osoite 0x%04X hylätty", command->address);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t modbus_command_write(uint8_t slave_id, uint16_t register_addr, uint16_t value)
+{
+    const modbus_command_t command = {
+        .type = MODBUS_COMMAND_WRITE_REGISTER,
+        .slave_id = slave_id,
+        .address = register_addr,
+        .value = value,
+    };
+    return post(&command);
+}
+
+esp_err_t modbus_command_set_relay(uint8_t relay_num, uint8_t state)
+{
+    const modbus_command_t command = {
+        .type = MODBUS_COMMAND_SET_RELAY,
+        .slave_id = MODBUS_DEFAULT_SLAVE_ID,
+        .address = relay_num,
+        .value = state,
+    };
+    return post(&command);
+}
+
+void modbus_command_get_status(modbus_command_status_t *out)
+{
+    taskENTER_CRITICAL(&status_lock);
+    *out = status;
+    taskEXIT_CRITICAL(&status_lock);
+}
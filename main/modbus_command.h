@@ -0,0 +1,69 @@
+/**
+ * Modbus Command Header
+ *
+ * Käyttöliittymän kirjoitukset väylälle. LVGL-tapahtumakäsittelijä vain
+ * jonottaa komennon eikä odota väylää: oma taski suorittaa komennot
+ * järjestyksessä uusintayrityksineen (MODBUS_RETRY_DEFAULT), joten
+ * vastaamaton laite ei pysäytä piirtoa eikä kosketusta. Jokaisen komennon
+ * jälkeen lähetetään APP_EVENT_BUS_COMMAND, ja tulos luetaan
+ * modbus_command_get_status()-funktiolla.
+ */
+
+#ifndef MODBUS_COMMAND_H
+#define MODBUS_COMMAND_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Jonossa odottavien komentojen enimmäismäärä
+#define MODBUS_COMMAND_QUEUE_LEN    (8)
+
+typedef enum {
+    MODBUS_COMMAND_WRITE_REGISTER,  // modbus_write_single_register()
+    MODBUS_COMMAND_SET_RELAY,       // modbus_toggle_relay(), onnistuessa app_state päivittyy
+} modbus_command_type_t;
+
+typedef struct {
+    modbus_command_type_t type;
+    uint8_t slave_id;               // Vain WRITE_REGISTER
+    uint16_t address;               // Rekisteri tai releen numero 1-8
+    uint16_t value;
+} modbus_command_t;
+
+/**
+ * @brief Viimeksi suoritetun komennon tulos
+ */
+typedef struct {
+    modbus_command_t command;
+    esp_err_t result;
+    uint32_t completed;             // Suoritetut komennot käynnistyksestä
+    uint32_t failed;                // Niistä epäonnistuneet
+    uint32_t dropped;               // Jono täynnä, komentoa ei otettu vastaan
+} modbus_command_status_t;
+
+/**
+ * @brief Luo komentojonon ja sen taskin, kutsutaan rs485_init():n jälkeen
+ */
+esp_err_t modbus_command_init(void);
+
+/**
+ * @brief Jonottaa rekisterin kirjoituksen, ei odota
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NO_MEM jos jono on täynnä,
+ *                   ESP_ERR_INVALID_STATE jos jonoa ei ole alustettu
+ */
+esp_err_t modbus_command_write(uint8_t slave_id, uint16_t register_addr, uint16_t value);
+
+/**
+ * @brief Jonottaa releen ohjauksen, ei odota
+ *
+ * @return esp_err_t Kuten modbus_command_write()
+ */
+esp_err_t modbus_command_set_relay(uint8_t relay_num, uint8_t state);
+
+/**
+ * @brief Kopioi viimeisimmän komennon tuloksen ja laskurit
+ */
+void modbus_command_get_status(modbus_command_status_t *status);
+
+#endif /* MODBUS_COMMAND_H */
@@ -1,9 +1,13 @@
 #include "modbus_content.h"
 #include "screen_manager.h"
-#include "modbus_handler.h"   // Lisätty: sisältää modbus_write_single_register ja MODBUS_DEFAULT_SLAVE_ID
+#include "modbus_handler.h"   // MODBUS_DEFAULT_SLAVE_ID ja rekisteriosoitteet
+#include "modbus_command.h"
 #include <stdio.h>
 #include <string.h>
 #include "rs485_handler.h"
+#include "modbus_scan.h"
+#include "modbus_slave.h"
+#include "app_events.h"
 
 // LED-indikaattorit (jää käyttöliittymän palautteeksi)
 static lv_obj_t* rx_led = NULL;
@@ -11,47 +15,136 @@ static lv_obj_t* tx_led = NULL;
 static lv_obj_t* user_button_led = NULL;
 static lv_obj_t* estop_led = NULL;
 
-// Näytön aktiivisuuden seuranta
-static bool is_screen_active = false;
+// Viimeisimmän napin kirjoituksen tulos
+static lv_obj_t* command_label = NULL;
 
-// RS485-kommunikoinnin tila (simuloitu vilkkuva indikaattori)
-static bool rs485_tx_active = false;
-static bool rs485_rx_active = false;
-static uint32_t rs485_last_update = 0;
+// Väylähaku
+static lv_obj_t* scan_btn = NULL;
+static lv_obj_t* scan_label = NULL;
+
+// RX/TX-ledit syttyvät väylätapahtumasta ja sammuvat ajastimella
+#define BUS_LED_ON_MS       (100)
+#define BUS_LED_ON_COLOR    (0x00FF00)
+#define BUS_LED_OFF_COLOR   (0x444444)
+static lv_timer_t* rx_led_timer = NULL;
+static lv_timer_t* tx_led_timer = NULL;
 
 /* 
  * Nappuloiden tapahtumakäsittelijät, jotka lähettävät modbus-komennot:
  *
- * TEST-nappi: rekisteri 19000
- * RUN-nappi:  rekisteri 19099
- * STOP-nappi: rekisteri 19101
+ * TEST-nappi: OPTA_TEST_BUTTON
+ * RUN-nappi:  OPTA_RUN_BUTTON
+ * STOP-nappi: OPTA_STOP_BUTTON
  *
- * Painettaessa lähetetään arvo 1 ja vapautettaessa arvo 0.
+ * Painettaessa lähetetään arvo 1 ja vapautettaessa arvo 0. Kirjoitukset
+ * jonotetaan (modbus_command.h), joten käsittelijä ei odota väylää.
  */
 static void test_button_event_cb(lv_event_t* e) {
     uint32_t code = lv_event_get_code(e);
     if(code == LV_EVENT_PRESSED) {
-        modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, 19000, 1);
+        modbus_command_write(MODBUS_DEFAULT_SLAVE_ID, OPTA_TEST_BUTTON_ADDR, 1);
     } else if(code == LV_EVENT_RELEASED) {
-        modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, 19000, 0);
+        modbus_command_write(MODBUS_DEFAULT_SLAVE_ID, OPTA_TEST_BUTTON_ADDR, 0);
     }
 }
 
 static void run_button_event_cb(lv_event_t* e) {
     uint32_t code = lv_event_get_code(e);
     if(code == LV_EVENT_PRESSED) {
-        modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, 19099, 1);
+        modbus_command_write(MODBUS_DEFAULT_SLAVE_ID, OPTA_RUN_BUTTON_ADDR, 1);
     } else if(code == LV_EVENT_RELEASED) {
-        modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, 19099, 0);
+        modbus_command_write(MODBUS_DEFAULT_SLAVE_ID, OPTA_RUN_BUTTON_ADDR, 0);
     }
 }
 
 static void stop_button_event_cb(lv_event_t* e) {
     uint32_t code = lv_event_get_code(e);
     if(code == LV_EVENT_PRESSED) {
-        modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, 19101, 1);
+        modbus_command_write(MODBUS_DEFAULT_SLAVE_ID, OPTA_STOP_BUTTON_ADDR, 1);
     } else if(code == LV_EVENT_RELEASED) {
-        modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, 19101, 0);
+        modbus_command_write(MODBUS_DEFAULT_SLAVE_ID, OPTA_STOP_BUTTON_ADDR, 0);
+    }
+}
+
+static void command_status_msg_cb(lv_event_t* e) {
+    modbus_command_status_t status;
+    modbus_command_get_status(&status);
+    if (status.result == ESP_OK) {
+        lv_label_set_text(command_label, "");
+    } else {
+        lv_label_set_text_fmt(command_label, "Kirjoitus 0x%04X epäonnistui: %s",
+                              status.command.address, esp_err_to_name(status.result));
+    }
+}
+
+// Päivittää haun tilan ja löydetyt laitteet listaan
+static void refresh_scan_results(void) {
+    modbus_scan_status_t scan;
+    modbus_scan_get_status(&scan);
+
+    char text[512];
+    int len;
+    if (scan.running) {
+        len = snprintf(text, sizeof(text), "Haetaan %lu bit/s: osoite %u (%u %%)\nLöydetty: %u\n",
+                       scan.baud_rate, scan.slave_id, scan.progress, scan.found);
+    } else {
+        len = snprintf(text, sizeof(text), "Laitteet:\n");
+    }
+
+    int count = 0;
+    for (int id = MODBUS_SLAVE_ID_MIN; id <= MODBUS_SLAVE_ID_MAX && len < (int)sizeof(text) - 40; id++) {
+        if (modbus_slave_is_present(id)) {
+            len += snprintf(text + len, sizeof(text) - len, "  #%d  %lu bit/s", id, modbus_slave_get_baud_rate(id));
+            if (modbus_slave_get_max_read(id) > 0) {
+                len += snprintf(text + len, sizeof(text) - len, "  max %u", modbus_slave_get_max_read(id));
+            }
+            len += snprintf(text + len, sizeof(text) - len, "\n");
+            count++;
+        }
+    }
+    if (count == 0 && !scan.running) {
+        snprintf(text + len, sizeof(text) - len, "  Ei löydettyjä laitteita");
+    }
+
+    lv_label_set_text(scan_label, text);
+    if (scan.running) {
+        lv_obj_add_state(scan_btn, LV_STATE_DISABLED);
+    } else {
+        lv_obj_clear_state(scan_btn, LV_STATE_DISABLED);
+    }
+}
+
+static void scan_status_msg_cb(lv_event_t* e) {
+    refresh_scan_results();
+}
+
+// Sammutusajastin on pysäytettynä kun ledi ei pala, joten se ei herätä LVGL:ää turhaan
+static void bus_led_off_timer_cb(lv_timer_t* timer) {
+    lv_obj_set_style_bg_color((lv_obj_t*)timer->user_data, lv_color_hex(BUS_LED_OFF_COLOR), 0);
+    lv_timer_pause(timer);
+}
+
+static void bus_led_msg_cb(lv_event_t* e) {
+    lv_obj_t* led = lv_event_get_target(e);
+    lv_timer_t* timer = lv_msg_get_user_data(lv_event_get_msg(e));
+
+    lv_obj_set_style_bg_color(led, lv_color_hex(BUS_LED_ON_COLOR), 0);
+    lv_timer_reset(timer);
+    lv_timer_resume(timer);
+}
+
+static lv_timer_t* bus_led_subscribe(lv_obj_t* led, app_event_t event) {
+    lv_timer_t* timer = lv_timer_create(bus_led_off_timer_cb, BUS_LED_ON_MS, led);
+    lv_timer_pause(timer);
+    lv_msg_subscribe_obj(event, led, timer);
+    lv_obj_add_event_cb(led, bus_led_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
+    return timer;
+}
+
+static void scan_button_event_cb(lv_event_t* e) {
+    if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
+        modbus_scan_start();
+        refresh_scan_results();
     }
 }
 
@@ -77,7 +170,8 @@ void modbus_content_create(lv_obj_t *parent) {
     lv_obj_set_size(rx_led, 30, 30);
     lv_obj_align_to(rx_led, rx_label, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
     lv_obj_set_style_radius(rx_led, LV_RADIUS_CIRCLE, 0);
-    lv_obj_set_style_bg_color(rx_led, lv_color_hex(0x444444), 0);
+    lv_obj_set_style_bg_color(rx_led, lv_color_hex(BUS_LED_OFF_COLOR), 0);
+    rx_led_timer = bus_led_subscribe(rx_led, APP_EVENT_BUS_RX);
     
     // TX LED
     lv_obj_t* tx_label = lv_label_create(led_panel);
@@ -89,7 +183,8 @@ void modbus_content_create(lv_obj_t *parent) {
     lv_obj_set_size(tx_led, 30, 30);
     lv_obj_align_to(tx_led, tx_label, LV_ALIGN_OUT_RIGHT_MID, 10, 0);
     lv_obj_set_style_radius(tx_led, LV_RADIUS_CIRCLE, 0);
-    lv_obj_set_style_bg_color(tx_led, lv_color_hex(0x444444), 0);
+    lv_obj_set_style_bg_color(tx_led, lv_color_hex(BUS_LED_OFF_COLOR), 0);
+    tx_led_timer = bus_led_subscribe(tx_led, APP_EVENT_BUS_TX);
     
     // Käyttäjän nappulan paneeli
     lv_obj_t* user_button_panel = lv_obj_create(parent);
@@ -154,34 +249,50 @@ void modbus_content_create(lv_obj_t *parent) {
     lv_label_set_text(stop_label, "STOP");
     lv_obj_center(stop_label);
     lv_obj_add_event_cb(stop_btn, stop_button_event_cb, LV_EVENT_ALL, NULL);
-}
 
-bool modbus_content_update(void) {
-    is_screen_active = screen_manager_is_screen_active(SCREEN_MODBUS);
-    
-    // Simuloidaan TX/RX LED -indikaattoreiden vilkkumista
-    if (is_screen_active) {
-        uint32_t now = (uint32_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
-        if (now - rs485_last_update > 100) {
-            rs485_last_update = now;
-            rs485_tx_active = (now % 1000 < 200);
-            rs485_rx_active = (now % 1000 > 300 && now % 1000 < 500);
-            if (tx_led) {
-                lv_obj_set_style_bg_color(tx_led, 
-                    rs485_tx_active ? lv_color_hex(0x00FF00) : lv_color_hex(0x444444), 0);
-            }
-            if (rx_led) {
-                lv_obj_set_style_bg_color(rx_led, 
-                    rs485_rx_active ? lv_color_hex(0x00FF00) : lv_color_hex(0x444444), 0);
-            }
-        }
-    }
-    return is_screen_active;
+    command_label = lv_label_create(parent);
+    lv_label_set_text(command_label, "");
+    lv_obj_set_pos(command_label, 20, 350);
+    lv_msg_subscribe_obj(APP_EVENT_BUS_COMMAND, command_label, NULL);
+    lv_obj_add_event_cb(command_label, command_status_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
+
+    // Väylähaun paneeli
+    lv_obj_t* scan_panel = lv_obj_create(parent);
+    lv_obj_set_size(scan_panel, 340, 340);
+    lv_obj_align(scan_panel, LV_ALIGN_TOP_RIGHT, -20, 40);
+    lv_obj_set_style_pad_all(scan_panel, 10, 0);
+
+    scan_btn = lv_btn_create(scan_panel);
+    lv_obj_set_size(scan_btn, 100, 40);
+    lv_obj_align(scan_btn, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_obj_set_style_bg_color(scan_btn, lv_color_hex(0x2196F3), 0);
+    lv_obj_t* scan_btn_label = lv_label_create(scan_btn);
+    lv_label_set_text(scan_btn_label, "SCAN");
+    lv_obj_center(scan_btn_label);
+    lv_obj_add_event_cb(scan_btn, scan_button_event_cb, LV_EVENT_CLICKED, NULL);
+
+    scan_label = lv_label_create(scan_panel);
+    lv_obj_set_width(scan_label, lv_pct(100));
+    lv_obj_align(scan_label, LV_ALIGN_TOP_LEFT, 0, 50);
+    lv_msg_subscribe_obj(APP_EVENT_SCAN_STATUS, scan_label, NULL);
+    lv_obj_add_event_cb(scan_label, scan_status_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
+    refresh_scan_results();
 }
 
 void modbus_content_deinit(void) {
+    if (rx_led_timer) {
+        lv_timer_del(rx_led_timer);
+        rx_led_timer = NULL;
+    }
+    if (tx_led_timer) {
+        lv_timer_del(tx_led_timer);
+        tx_led_timer = NULL;
+    }
     rx_led = NULL;
     tx_led = NULL;
     user_button_led = NULL;
     estop_led = NULL;
+    command_label = NULL;
+    scan_btn = NULL;
+    scan_label = NULL;
 }
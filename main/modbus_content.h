@@ -10,14 +10,6 @@
  */
 void modbus_content_create(lv_obj_t *parent);
 
-/**
- * @brief Update Modbus screen content (called from screen_manager)
- * 
- * @return true if screen is active
- * @return false if screen is not active 
- */
-bool modbus_content_update(void);
-
 /**
  * @brief Clean up Modbus screen resources
  */
@@ -1,7 +1,21 @@
 #include "modbus_handler.h"
 #include "rs485_handler.h"
+#include "modbus_slave.h"
+#include "app_state.h"
 #include "esp_rom_sys.h"  // esp_rom_delay_us funktiota varten
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/task.h"
+#include <string.h>
 
+static const char *TAG = "MODBUS";
+
+// Suurin RTU-kehys, väylän lukko suojaa puskuria
+#define MODBUS_MAX_ADU_SIZE     256
+static uint8_t frame_buf[MODBUS_MAX_ADU_SIZE];
+
+// Väylän tilastot, päivitetään väylän lukon alla (paitsi retries)
+static modbus_stats_t stats;
 
 uint16_t modbus_crc16(uint8_t *buffer, uint16_t length)
 {
@@ -22,6 +36,221 @@ uint16_t modbus_crc16(uint8_t *buffer, uint16_t length)
     return crc;
 }
  
+// Vastauksen pituus otsakkeen perusteella
+static size_t response_length(const uint8_t *frame, size_t available)
+{
+    if (frame[1] & 0x80) {
+        return 5;                                   // Poikkeus: slave, fc, koodi, crc
+    }
+    switch (frame[1]) {
+        case 0x01:
+        case 0x02:
+        case MODBUS_READ_HOLDING_REGISTERS:
+        case 0x04:
+            return 5 + frame[2];                    // slave, fc, tavumäärä, data, crc
+        case 0x05:
+        case MODBUS_WRITE_SINGLE_REGISTER:
+        case 0x0F:
+        case 0x10:
+            return 8;                               // Kaiku: slave, fc, osoite, arvo/määrä, crc
+        default:
+            return available;                       // Muut: koko kehys
+    }
+}
+
+// Etsii kehyksestä pyyntöön kuuluvan vastauksen ja ohittaa sitä edeltävät tavut
+static int find_response(const uint8_t *request, uint8_t *frame, size_t len)
+{
+    for (size_t offset = 0; offset + 5 <= len; offset++) {
+        uint8_t *candidate = frame + offset;
+        if (candidate[0] != request[0] || (candidate[1] & 0x7F) != request[1]) {
+            continue;
+        }
+
+        size_t n = response_length(candidate, len - offset);
+        if (n < 5 || n > len - offset) {
+            continue;
+        }
+
+        uint16_t crc = (candidate[n - 1] << 8) | candidate[n - 2];
+        if (modbus_crc16(candidate, n - 2) != crc) {
+            continue;
+        }
+
+        if (offset > 0) {
+            memmove(frame, candidate, n);
+        }
+        return n;
+    }
+    return 0;
+}
+
+// Pyyntö-vastaus-pari. Kutsujalla on väylä varattuna ja nopeus asetettuna.
+static int exchange(const uint8_t *request, size_t request_len, uint8_t *response, size_t response_max,
+                    TickType_t timeout)
+{
+    int len;
+
+    // Edellisten pyyntöjen myöhästyneet vastaukset ja häiriöt luetaan pois
+    // kehyksinä, jolloin kesken oleva kehys ei katkea keskeltä
+    while ((len = rs485_receive_frame(frame_buf, sizeof(frame_buf), 0)) > 0) {
+        ESP_LOGD(TAG, "Ohitettiin %d tavun kehys ennen pyyntöä", len);
+        stats.discarded_frames++;
+    }
+
+    // Palaa vasta kun pyyntö on kokonaan linjalla, joten aikaraja alkaa siitä
+    stats.transactions++;
+    if (rs485_send_data(request, request_len) != ESP_OK) {
+        stats.errors++;
+        return -1;
+    }
+    stats.tx_bytes += request_len;
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t elapsed = 0;
+    do {
+        len = rs485_receive_frame(frame_buf, sizeof(frame_buf), timeout - elapsed);
+        if (len == 0) {
+            break;
+        }
+        if (len > 0) {
+            stats.rx_bytes += len;
+            int n = find_response(request, frame_buf, len);
+            if (n > 0) {
+                if (frame_buf[1] & 0x80) {
+                    stats.exceptions++;
+                }
+                if ((size_t)n > response_max) {
+                    n = response_max;
+                }
+                memcpy(response, frame_buf, n);
+                return n;
+            }
+            ESP_LOGD(TAG, "Ohitettiin %d tavua, ei vastaus pyyntöön", len);
+            stats.discarded_frames++;
+        }
+        elapsed = xTaskGetTickCount() - start;
+    } while (elapsed < timeout);
+
+    stats.timeouts++;
+    return 0;
+}
+
+void modbus_get_stats(modbus_stats_t *out)
+{
+    // Yksittäiset 32-bittiset laskurit, pieni epätarkkuus kesken pyynnön ei haittaa
+    *out = stats;
+}
+
+int modbus_transaction(const uint8_t *request, size_t request_len, uint8_t *response, size_t response_max,
+                       TickType_t timeout)
+{
+    if (!rs485_bus_lock(pdMS_TO_TICKS(MODBUS_BUS_LOCK_TIMEOUT_MS))) {
+        return -1;
+    }
+
+    // Eristetty laite ei vie väyläaikaa
+    if (!modbus_slave_breaker_allow(request[0])) {
+        stats.rejected++;
+        rs485_bus_unlock();
+        return -1;
+    }
+
+    // Laite voi olla siirretty oletusta nopeammalle (modbus_negotiate_baud)
+    rs485_config_t config;
+    rs485_get_config(&config);
+    uint32_t baud_rate = modbus_slave_get_baud_rate(request[0]);
+    rs485_set_baud_rate(baud_rate ? baud_rate : config.baud_rate);
+
+    // Myös lähetysvirhe kirjataan vastaamattomaksi, jotta puoliavoin koe ei jää kesken
+    int len = exchange(request, request_len, response, response_max, timeout);
+    modbus_slave_breaker_record(request[0], len > 0);
+
+    rs485_bus_unlock();
+    return len;
+}
+
+int modbus_transaction_retry(const uint8_t *request, size_t request_len, uint8_t *response, size_t response_max,
+                             TickType_t timeout, const modbus_retry_t *retry)
+{
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t deadline = pdMS_TO_TICKS(retry->deadline_ms);
+    uint32_t backoff_ms = retry->backoff_ms;
+    int len = -1;
+
+    for (uint8_t attempt = 1; ; attempt++) {
+        // Viimeinen yritys saa vain aikarajasta jäljellä olevan ajan
+        TickType_t attempt_timeout = timeout;
+        if (deadline > 0) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= deadline) {
+                break;
+            }
+            if (attempt_timeout > deadline - elapsed) {
+                attempt_timeout = deadline - elapsed;
+            }
+        }
+
+        len = modbus_transaction(request, request_len, response, response_max, attempt_timeout);
+        if (len > 0 || attempt >= retry->attempts ||
+            modbus_slave_breaker_get_state(request[0]) == MODBUS_BREAKER_OPEN) {
+            break;
+        }
+
+        uint32_t delay_ms = backoff_ms / 2 + esp_random() % (backoff_ms / 2 + 1);
+        if (deadline > 0 && xTaskGetTickCount() - start + pdMS_TO_TICKS(delay_ms) >= deadline) {
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+
+        backoff_ms *= 2;
+        if (backoff_ms > retry->backoff_max_ms) {
+            backoff_ms = retry->backoff_max_ms;
+        }
+        stats.retries++;
+        ESP_LOGD(TAG, "Laite %d: uusi yritys %d", request[0], attempt + 1);
+    }
+    return len;
+}
+
+esp_err_t modbus_probe(uint8_t slave_id, uint32_t baud_rate, TickType_t turnaround)
+{
+    // Lyhin mahdollinen pyyntö: yhden rekisterin luku osoitteesta 0.
+    // Myös poikkeusvastaus kertoo, että osoitteessa on laite.
+    uint8_t buffer[8] = { slave_id, MODBUS_READ_HOLDING_REGISTERS, 0x00, 0x00, 0x00, 0x01 };
+    uint8_t rx_buffer[8];
+
+    uint16_t crc = modbus_crc16(buffer, 6);
+    buffer[6] = crc & 0xFF;
+    buffer[7] = (crc >> 8) & 0xFF;
+
+    if (!rs485_bus_lock(pdMS_TO_TICKS(MODBUS_BUS_LOCK_TIMEOUT_MS))) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // Nopeus vaihdetaan vain tämän pyynnön ajaksi, muu liikenne jatkuu normaalisti
+    esp_err_t ret = rs485_set_baud_rate(baud_rate);
+    int len = 0;
+
+    if (ret == ESP_OK) {
+        // Kehysväli + laitteen käsittelyaika: kuollut osoite maksaa vain tämän
+        TickType_t timeout = rs485_chars_to_ticks(RS485_FRAME_GAP) + turnaround;
+        len = exchange(buffer, sizeof(buffer), rx_buffer, sizeof(rx_buffer), timeout);
+
+        // Haku ohittaa katkaisijan, mutta löytynyt laite palautetaan käyttöön
+        if (len > 0) {
+            modbus_slave_breaker_record(slave_id, true);
+        }
+    }
+
+    rs485_bus_unlock();
+
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return (len > 0) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
 esp_err_t modbus_write_single_register(uint8_t slave_id, uint16_t register_addr, uint16_t value)
 {
     uint8_t buffer[8];
@@ -39,24 +268,72 @@ esp_err_t modbus_write_single_register(uint8_t slave_id, uint16_t register_addr,
     buffer[6] = crc & 0xFF;
     buffer[7] = (crc >> 8) & 0xFF;
         
-    esp_err_t ret = rs485_send_data(buffer, 8);
-
-    if (ret != ESP_OK) {
-        return ret;
+    // Odota vastausta, lyhennä aikakatkaisu. Saman arvon kirjoitus on turvallista toistaa.
+    const modbus_retry_t retry = MODBUS_RETRY_DEFAULT;
+    int len = modbus_transaction_retry(buffer, 8, rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(100), &retry);
+    if (len < 0) {
+        return ESP_FAIL;
     }
     
-    // Odota vastausta, lyhennä aikakatkaisu
-    int len = rs485_receive_data(rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(100));
+    // Tarkista mahdollinen virhekoodi Modbus-vastauksessa
+    if (len >= 5 && (rx_buffer[1] & 0x80)) {
+        return ESP_ERR_MODBUS_EXCEPTION;
+    }
     
     if (len < 8) {
         return ESP_ERR_TIMEOUT;
     }
     
-    // Tarkista mahdollinen virhekoodi Modbus-vastauksessa
-    if (rx_buffer[1] & 0x80) {
+    return ESP_OK;
+}
+
+esp_err_t modbus_write_multiple_registers(uint8_t slave_id, uint16_t register_addr, uint16_t count,
+                                          const uint16_t *values)
+{
+    uint8_t buffer[9 + MODBUS_MAX_WRITE_REGISTERS * 2];
+    uint8_t rx_buffer[8];
+
+    if (count == 0 || count > MODBUS_MAX_WRITE_REGISTERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // slave, fc, osoite, määrä, tavumäärä, arvot, crc
+    buffer[0] = slave_id;
+    buffer[1] = MODBUS_WRITE_MULTIPLE_REGISTERS;
+    buffer[2] = (register_addr >> 8) & 0xFF;
+    buffer[3] = register_addr & 0xFF;
+    buffer[4] = (count >> 8) & 0xFF;
+    buffer[5] = count & 0xFF;
+    buffer[6] = count * 2;
+    for (uint16_t i = 0; i < count; i++) {
+        buffer[7 + i * 2] = (values[i] >> 8) & 0xFF;
+        buffer[8 + i * 2] = values[i] & 0xFF;
+    }
+
+    size_t length = 7 + count * 2;
+    uint16_t crc = modbus_crc16(buffer, length);
+    buffer[length++] = crc & 0xFF;
+    buffer[length++] = (crc >> 8) & 0xFF;
+
+    const modbus_retry_t retry = MODBUS_RETRY_DEFAULT;
+    int len = modbus_transaction_retry(buffer, length, rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(100), &retry);
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+
+    if (len >= 5 && (rx_buffer[1] & 0x80)) {
         return ESP_ERR_MODBUS_EXCEPTION;
     }
-    
+
+    if (len < 8) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // Vastaus toistaa osoitteen ja määrän
+    if (memcmp(&rx_buffer[2], &buffer[2], 4) != 0) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
     return ESP_OK;
 }
 
@@ -76,68 +353,282 @@ esp_err_t modbus_read_holding_register(uint8_t slave_id, uint16_t register_addr,
     buffer[6] = crc & 0xFF;
     buffer[7] = (crc >> 8) & 0xFF;
     
-    esp_err_t ret = rs485_send_data(buffer, 8);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-    
     // Odota vastausta
-    int len = rs485_receive_data(rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(100));
-    
-    if (len < 7) {  // 1 (slave) + 1 (fc) + 1 (byte count) + 2 (data) + 2 (crc)
-        return ESP_ERR_TIMEOUT;
+    const modbus_retry_t retry = MODBUS_RETRY_DEFAULT;
+    int len = modbus_transaction_retry(buffer, 8, rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(100), &retry);
+    if (len < 0) {
+        return ESP_FAIL;
     }
     
     // Tarkista mahdolliset virheet
-    if (rx_buffer[1] & 0x80) {
+    if (len >= 5 && (rx_buffer[1] & 0x80)) {
         return ESP_ERR_MODBUS_EXCEPTION;
     }
     
+    if (len < 7) {  // 1 (slave) + 1 (fc) + 1 (byte count) + 2 (data) + 2 (crc)
+        return ESP_ERR_TIMEOUT;
+    }
+    
     // Kaikki ok, palauta arvo
     *value = (rx_buffer[3] << 8) | rx_buffer[4];
     
     return ESP_OK;
 }
 
+// Lähettää FC 0x03 -pyynnön ja palauttaa vastauksen rekisterilohkon
+static esp_err_t read_register_block(uint8_t slave_id, uint16_t register_addr, uint16_t count,
+                                     uint8_t *rx_buffer, const uint8_t **data, uint8_t *exception)
+{
+    uint8_t buffer[8];
+
+    if (count == 0 || count > MODBUS_MAX_READ_REGISTERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    buffer[0] = slave_id;
+    buffer[1] = MODBUS_READ_HOLDING_REGISTERS;
+    buffer[2] = (register_addr >> 8) & 0xFF;
+    buffer[3] = register_addr & 0xFF;
+    buffer[4] = (count >> 8) & 0xFF;
+    buffer[5] = count & 0xFF;
+
+    uint16_t crc = modbus_crc16(buffer, 6);
+    buffer[6] = crc & 0xFF;
+    buffer[7] = (crc >> 8) & 0xFF;
+
+    // 1 (slave) + 1 (fc) + 1 (byte count) + data + 2 (crc)
+    int expected = 5 + count * 2;
+    int len = modbus_transaction(buffer, 8, rx_buffer, expected, pdMS_TO_TICKS(100));
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+
+    if (len >= 5 && rx_buffer[0] == slave_id && (rx_buffer[1] & 0x80)) {
+        if (exception) {
+            *exception = rx_buffer[2];
+        }
+        return ESP_ERR_MODBUS_EXCEPTION;
+    }
+    if (len < expected) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (rx_buffer[0] != slave_id || rx_buffer[1] != MODBUS_READ_HOLDING_REGISTERS || rx_buffer[2] != count * 2) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    uint16_t response_crc = (rx_buffer[expected - 1] << 8) | rx_buffer[expected - 2];
+    if (modbus_crc16(rx_buffer, expected - 2) != response_crc) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    *data = &rx_buffer[3];
+    return ESP_OK;
+}
+
+// Laitteen suurin yhdellä pyynnöllä luettava rekisterimäärä
+static uint16_t max_read_registers(uint8_t slave_id)
+{
+    uint16_t max = modbus_slave_get_max_read(slave_id);
+    return (max == 0 || max > MODBUS_MAX_READ_REGISTERS) ? MODBUS_MAX_READ_REGISTERS : max;
+}
+
+esp_err_t modbus_read_holding_registers(uint8_t slave_id, uint16_t register_addr, uint16_t count, uint16_t *values)
+{
+    uint8_t rx_buffer[5 + MODBUS_MAX_READ_REGISTERS * 2];
+    const uint8_t *data;
+    const uint16_t max = max_read_registers(slave_id);
+
+    if (count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint16_t done = 0; done < count; ) {
+        uint16_t n = (count - done > max) ? max : count - done;
+        esp_err_t ret = read_register_block(slave_id, register_addr + done, n, rx_buffer, &data, NULL);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        register_decode_u16(data, values + done, n);
+        done += n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t modbus_read_holding_block(uint8_t slave_id, uint16_t register_addr, uint16_t count, uint16_t *values,
+                                    uint8_t *exception)
+{
+    uint8_t rx_buffer[5 + MODBUS_MAX_READ_REGISTERS * 2];
+    const uint8_t *data;
+
+    esp_err_t ret = read_register_block(slave_id, register_addr, count, rx_buffer, &data, exception);
+    if (ret == ESP_OK) {
+        register_decode_u16(data, values, count);
+    }
+    return ret;
+}
+
+esp_err_t modbus_read_scaled(uint8_t slave_id, const register_desc_t *desc, float *values, size_t count)
+{
+    uint8_t rx_buffer[5 + MODBUS_MAX_READ_REGISTERS * 2];
+    const uint8_t *data;
+
+    // Kokonaisia arvoja pyyntöä kohden
+    const size_t per_request = max_read_registers(slave_id) / desc->words;
+    if (per_request == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    word_order_t order = modbus_slave_get_word_order(slave_id);
+    for (size_t done = 0; done < count; ) {
+        size_t n = (count - done > per_request) ? per_request : count - done;
+        esp_err_t ret = read_register_block(slave_id, desc->address + done * desc->words, n * desc->words,
+                                            rx_buffer, &data, NULL);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        if (register_decode_scaled(data, desc, order, values + done, n) != n) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        done += n;
+    }
+    return ESP_OK;
+}
+
+// Kopioi tunnistusobjektin merkkijonoksi, liian pitkä arvo katkaistaan
+static void copy_object(char *dst, size_t dst_size, const uint8_t *src, uint8_t len)
+{
+    size_t n = (len < dst_size - 1) ? len : dst_size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+esp_err_t modbus_read_device_id(uint8_t slave_id, modbus_device_id_t *id)
+{
+    uint8_t buffer[7];
+    uint8_t rx_buffer[MODBUS_MAX_ADU_SIZE];
+    uint8_t object_id = 0x00;
+
+    memset(id, 0, sizeof(*id));
+
+    // Laite voi jakaa vastauksen osiin ("more follows"), perusobjekteja on kolme
+    for (int part = 0; part < 3; part++) {
+        buffer[0] = slave_id;
+        buffer[1] = MODBUS_ENCAPSULATED_INTERFACE;
+        buffer[2] = MODBUS_MEI_DEVICE_ID;
+        buffer[3] = 0x01;                           // Read Device ID code: basic
+        buffer[4] = object_id;
+
+        uint16_t crc = modbus_crc16(buffer, 5);
+        buffer[5] = crc & 0xFF;
+        buffer[6] = (crc >> 8) & 0xFF;
+
+        int len = modbus_transaction(buffer, sizeof(buffer), rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(100));
+        if (len < 0) {
+            return ESP_FAIL;
+        }
+        if (len >= 5 && (rx_buffer[1] & 0x80)) {
+            return ESP_ERR_MODBUS_EXCEPTION;
+        }
+        if (len < 10) {                             // Otsake 8 tavua + crc
+            return ESP_ERR_TIMEOUT;
+        }
+        if (rx_buffer[2] != MODBUS_MEI_DEVICE_ID) {
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+
+        // slave, fc, mei, code, conformity, more follows, next object, objektien määrä
+        const uint8_t more_follows = rx_buffer[5];
+        const uint8_t next_object = rx_buffer[6];
+        const uint8_t objects = rx_buffer[7];
+        const size_t end = len - 2;
+        size_t pos = 8;
+
+        for (uint8_t i = 0; i < objects; i++) {
+            if (pos + 2 > end || pos + 2 + rx_buffer[pos + 1] > end) {
+                return ESP_ERR_INVALID_RESPONSE;
+            }
+            const uint8_t obj = rx_buffer[pos];
+            const uint8_t obj_len = rx_buffer[pos + 1];
+            const uint8_t *value = &rx_buffer[pos + 2];
+
+            switch (obj) {
+                case 0x00: copy_object(id->vendor, sizeof(id->vendor), value, obj_len); break;
+                case 0x01: copy_object(id->product, sizeof(id->product), value, obj_len); break;
+                case 0x02: copy_object(id->revision, sizeof(id->revision), value, obj_len); break;
+                default: break;
+            }
+            pos += 2 + obj_len;
+        }
+
+        if (more_follows != 0xFF || next_object <= object_id) {
+            return ESP_OK;
+        }
+        object_id = next_object;
+    }
+    return ESP_OK;
+}
+
+esp_err_t modbus_check_function(uint8_t slave_id, uint8_t function)
+{
+    // slave, fc, osoite 0, määrä 0 (FC 0x10: tavumäärä 0), crc
+    uint8_t buffer[9] = { slave_id, function, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    uint8_t rx_buffer[MODBUS_MAX_ADU_SIZE];
+    size_t length;
+
+    switch (function) {
+        case MODBUS_READ_HOLDING_REGISTERS:   length = 6; break;
+        case MODBUS_WRITE_MULTIPLE_REGISTERS: length = 7; break;
+        default: return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t crc = modbus_crc16(buffer, length);
+    buffer[length++] = crc & 0xFF;
+    buffer[length++] = (crc >> 8) & 0xFF;
+
+    int len = modbus_transaction(buffer, length, rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(100));
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+    if (len == 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (len < 5 || rx_buffer[0] != slave_id) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (rx_buffer[1] == function) {
+        return ESP_OK;
+    }
+    if (rx_buffer[1] != (function | 0x80)) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    // Poikkeus koskee pyynnön sisältöä, joten laite tuntee funktion
+    switch (rx_buffer[2]) {
+        case MODBUS_EXCEPTION_ILLEGAL_FUNCTION:
+            return ESP_ERR_NOT_SUPPORTED;
+        case MODBUS_EXCEPTION_ILLEGAL_ADDRESS:
+        case MODBUS_EXCEPTION_ILLEGAL_VALUE:
+        case MODBUS_EXCEPTION_DEVICE_FAILURE:
+            return ESP_OK;
+        default:
+            return ESP_ERR_INVALID_RESPONSE;
+    }
+}
+
 // modbus_toggle_relay funktio päivitetty tukemaan releitä 1-8
 esp_err_t modbus_toggle_relay(uint8_t relay_num, uint8_t state)
 {
     // Varmistetaan, että releen numero on sallitulla alueella (1-8)
-    if (relay_num < 1 || relay_num > 8) {
+    if (relay_num < 1 || relay_num > OPTA_RELAY_COUNT) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Määritetään rekisterin osoite releen numeron perusteella
-    uint16_t register_addr;
-    
-    switch (relay_num) {
-        case 1:
-            register_addr = MODBUS_RELAY1_REGISTER;
-            break;
-        case 2:
-            register_addr = MODBUS_RELAY2_REGISTER;
-            break;
-        case 3:
-            register_addr = MODBUS_RELAY3_REGISTER;
-            break;
-        case 4:
-            register_addr = MODBUS_RELAY4_REGISTER;
-            break;
-        case 5:
-            register_addr = MODBUS_RELAY5_REGISTER;
-            break;
-        case 6:
-            register_addr = MODBUS_RELAY6_REGISTER;
-            break;
-        case 7:
-            register_addr = MODBUS_RELAY7_REGISTER;
-            break;
-        case 8:
-            register_addr = MODBUS_RELAY8_REGISTER;
-            break;
-        default:
-            return ESP_ERR_INVALID_ARG;
+    // Releiden rekisterit ovat peräkkäin (register_map.h)
+    uint16_t register_addr = OPTA_RELAY1_ADDR + (relay_num - 1);
+
+    esp_err_t ret = modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, register_addr, state);
+    if (ret == ESP_OK) {
+        app_state_set_relay(relay_num, state != 0);
     }
-    
-    return modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, register_addr, state);
+    return ret;
 }
\ No newline at end of file
@@ -3,31 +3,186 @@
 #define MODBUS_HANDLER_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
+#include "register_map.h"
+#include "register_decode.h"
+#include "modbus_slave.h"
 
 // Modbus function codes
 #define MODBUS_READ_HOLDING_REGISTERS    0x03
 #define MODBUS_WRITE_SINGLE_REGISTER     0x06
+#define MODBUS_WRITE_MULTIPLE_REGISTERS  0x10
+#define MODBUS_ENCAPSULATED_INTERFACE    0x2B
+#define MODBUS_MEI_DEVICE_ID             0x0E
 
-// Slave ID ja rekisterimääritykset
+// Poikkeuskoodit
+#define MODBUS_EXCEPTION_ILLEGAL_FUNCTION 0x01      // Laite ei tue funktiota
+#define MODBUS_EXCEPTION_ILLEGAL_ADDRESS  0x02      // Osoitealue ei ole laitteessa
+#define MODBUS_EXCEPTION_ILLEGAL_VALUE    0x03      // Esim. liian suuri rekisterimäärä
+#define MODBUS_EXCEPTION_DEVICE_FAILURE   0x04
+
+// Yhdellä pyynnöllä luettavien ja kirjoitettavien rekisterien enimmäismäärä (Modbus-spesifikaatio)
+#define MODBUS_MAX_READ_REGISTERS        125
+#define MODBUS_MAX_WRITE_REGISTERS       123
+
+// Kuinka kauan väylän vapautumista odotetaan ennen kuin pyyntö hylätään
+#define MODBUS_BUS_LOCK_TIMEOUT_MS       1000
+
+// Slave ID (rekisterit: register_map.h)
 #define MODBUS_DEFAULT_SLAVE_ID          1
-#define MODBUS_RELAY1_REGISTER           18099
-// Releiden 2-8 rekisterit jatkuvat peräkkäin
-#define MODBUS_RELAY2_REGISTER           18100
-#define MODBUS_RELAY3_REGISTER           18101
-#define MODBUS_RELAY4_REGISTER           18102
-#define MODBUS_RELAY5_REGISTER           18103
-#define MODBUS_RELAY6_REGISTER           18104
-#define MODBUS_RELAY7_REGISTER           18105
-#define MODBUS_RELAY8_REGISTER           18106
 
 // Oma virhekoodi
 #define ESP_ERR_MODBUS_EXCEPTION         0x9001
 
+/**
+ * @brief Väylän liikennetilastot käynnistyksestä lähtien
+ */
+typedef struct {
+    uint32_t transactions;          // Lähetetyt pyynnöt
+    uint32_t timeouts;              // Pyynnöt ilman kelvollista vastausta
+    uint32_t exceptions;            // Poikkeusvastaukset
+    uint32_t errors;                // Lähetysvirheet
+    uint32_t discarded_frames;      // Ohitetut ylimääräiset tai virheelliset kehykset
+    uint32_t retries;               // Uusintayritykset (modbus_transaction_retry)
+    uint32_t rejected;              // Eristetylle laitteelle hylätyt pyynnöt
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+} modbus_stats_t;
+
+/**
+ * @brief Uusintayritysten sääntö
+ *
+ * Odotus ennen uutta yritystä kaksinkertaistuu backoff_ms:stä alkaen
+ * backoff_max_ms:ään asti. Odotuksesta puolet on satunnaista, jotta
+ * samaan aikaan epäonnistuneet pyynnöt eivät yritä uudelleen yhtä aikaa.
+ */
+typedef struct {
+    uint8_t attempts;               // Yritykset yhteensä (vähintään 1)
+    uint16_t backoff_ms;
+    uint16_t backoff_max_ms;
+    uint32_t deadline_ms;           // Koko pyynnön aikaraja yrityksineen, 0 = ei rajaa
+} modbus_retry_t;
+
+// Yksittäisten rekisterien luku ja kirjoitus
+#define MODBUS_RETRY_DEFAULT  { .attempts = 3, .backoff_ms = 20, .backoff_max_ms = 200, .deadline_ms = 1000 }
+
 uint16_t modbus_crc16(uint8_t *buffer, uint16_t length);
+
+/**
+ * @brief Kopioi väylän tilastot
+ */
+void modbus_get_stats(modbus_stats_t *stats);
+
+/**
+ * @brief Lähettää valmiin pyynnön (CRC mukana) ja vastaanottaa vastauskehyksen
+ *
+ * Varaa väylän koko pyyntö-vastaus-parin ajaksi, joten kutsuttavissa mistä
+ * tahansa taskista. Eristetylle laitteelle (modbus_slave.h) ei lähetetä.
+ *
+ * @param timeout Vastauksen odotusaika pyynnön lähetyksen päättymisestä
+ * @return int Vastauksen pituus, 0 jos vastausta ei tullut, -1 jos väylää ei saatu,
+ *             lähetys epäonnistui tai laite on eristetty
+ */
+int modbus_transaction(const uint8_t *request, size_t request_len, uint8_t *response, size_t response_max,
+                       TickType_t timeout);
+
+/**
+ * @brief Kuten modbus_transaction(), mutta yrittää uudelleen jos vastausta ei tule
+ *
+ * Poikkeusvastausta ei yritetä uudelleen. Yritykset loppuvat myös, kun
+ * laite eristetään tai aikaraja ei riitä seuraavaan yritykseen. Vain
+ * pyynnöille, joiden toistaminen ei muuta lopputulosta (luku, saman arvon
+ * kirjoitus).
+ */
+int modbus_transaction_retry(const uint8_t *request, size_t request_len, uint8_t *response, size_t response_max,
+                             TickType_t timeout, const modbus_retry_t *retry);
+
+/**
+ * @brief Tarkistaa vastaako osoitteessa laite annetulla nopeudella
+ *
+ * Nopeus koskee vain tätä pyyntöä, seuraava modbus_transaction() valitsee
+ * taas laitteen oman nopeuden.
+ *
+ * @param turnaround Laitteen käsittelyaika, vastausta odotetaan lähetyksen
+ *                   päättymisestä kehysvälin ja tämän ajan verran
+ * @return esp_err_t ESP_OK jos laite vastasi (myös poikkeuksella), ESP_ERR_NOT_FOUND jos ei
+ */
+esp_err_t modbus_probe(uint8_t slave_id, uint32_t baud_rate, TickType_t turnaround);
+
+// Yksittäiset rekisterit: uusintayritykset MODBUS_RETRY_DEFAULT mukaan. Voivat odottaa
+// väylää ja vastausta sekunteja, joten LVGL-taskista kirjoitetaan modbus_command.h:n kautta.
 esp_err_t modbus_write_single_register(uint8_t slave_id, uint16_t register_addr, uint16_t value);
 esp_err_t modbus_read_holding_register(uint8_t slave_id, uint16_t register_addr, uint16_t *value);
+
+/**
+ * @brief Kirjoittaa count peräkkäistä rekisteriä yhdellä pyynnöllä (FC 0x10)
+ *
+ * Laite ottaa kaikki arvot käyttöön kerralla tai ei mitään. Pyyntö
+ * toistetaan MODBUS_RETRY_DEFAULT mukaan, koska samojen arvojen
+ * kirjoitus on turvallista toistaa.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_TIMEOUT, ESP_ERR_INVALID_RESPONSE tai ESP_ERR_MODBUS_EXCEPTION
+ */
+esp_err_t modbus_write_multiple_registers(uint8_t slave_id, uint16_t register_addr, uint16_t count,
+                                          const uint16_t *values);
+
+/**
+ * @brief Lukee laitteen perustunnistetiedot (FC 0x2B / MEI 0x0E, read code 01)
+ *
+ * Puuttuvat objektit jäävät tyhjiksi merkkijonoiksi.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_TIMEOUT, ESP_ERR_INVALID_RESPONSE tai ESP_ERR_MODBUS_EXCEPTION
+ */
+esp_err_t modbus_read_device_id(uint8_t slave_id, modbus_device_id_t *id);
+
+/**
+ * @brief Tarkistaa tukeeko laite funktiokoodia
+ *
+ * Lähettää funktion nollalla rekisterimäärällä, jolloin tukeva laite
+ * vastaa poikkeuksella 03 eikä mitään kirjoiteta. Vain FC 0x03 ja 0x10.
+ * Tuetuksi tulkitaan normaali vastaus tai poikkeus 02, 03 tai 04.
+ *
+ * @return esp_err_t ESP_OK jos tuettu, ESP_ERR_NOT_SUPPORTED jos laite vastasi
+ *                   poikkeuksella 01, ESP_ERR_TIMEOUT jos vastausta ei tullut,
+ *                   ESP_ERR_INVALID_RESPONSE muulla vastauksella
+ */
+esp_err_t modbus_check_function(uint8_t slave_id, uint8_t function);
+
+/**
+ * @brief Lukee count peräkkäistä holding-rekisteriä
+ *
+ * Pyynnöt jaetaan laitteen suurimman luvun mukaan (modbus_slave_get_max_read,
+ * oletus MODBUS_MAX_READ_REGISTERS), joten count voi olla rajaa suurempi.
+ * Ei uusintayrityksiä: rajan sisällä yksi kutsu on yksi pyyntö väylällä
+ * (nopeuden varmistus ja jaetut luvut luottavat tähän).
+ *
+ * @param values Puskuri count arvolle
+ * @return esp_err_t ESP_OK, ESP_ERR_TIMEOUT, ESP_ERR_INVALID_CRC tai ESP_ERR_MODBUS_EXCEPTION
+ */
+esp_err_t modbus_read_holding_registers(uint8_t slave_id, uint16_t register_addr, uint16_t count, uint16_t *values);
+
+/**
+ * @brief Lukee count holding-rekisteriä yhdellä pyynnöllä jakamatta
+ *
+ * Laitteen rajojen selvitykseen: pyyntöä ei jaeta eikä toisteta.
+ *
+ * @param exception Poikkeusvastauksen koodi, kun paluuarvo on ESP_ERR_MODBUS_EXCEPTION
+ * @return esp_err_t Kuten modbus_read_holding_registers()
+ */
+esp_err_t modbus_read_holding_block(uint8_t slave_id, uint16_t register_addr, uint16_t count, uint16_t *values,
+                                    uint8_t *exception);
+
+/**
+ * @brief Lukee count kuvaimen mukaista arvoa skaalattuina
+ *
+ * 32-bittiset arvot puretaan slaven rekisterijärjestyksellä (modbus_slave.h).
+ * Pyynnöt jaetaan kuten modbus_read_holding_registers():ssa, arvoja ei katkaista.
+ */
+esp_err_t modbus_read_scaled(uint8_t slave_id, const register_desc_t *desc, float *values, size_t count);
+
+// Estävä kuten modbus_write_single_register(), käyttöliittymästä modbus_command_set_relay()
 esp_err_t modbus_toggle_relay(uint8_t relay_num, uint8_t state);
 
 #endif // MODBUS_HANDLER_H
\ No newline at end of file
@@ -0,0 +1,305 @@
+/**
+ * Modbus Scan Functions
+ *
+ * Jokainen kokeilu on lyhin mahdollinen pyyntö (8 tavua), ja vastausta
+ * odotetaan lähetyksen päättymisestä vain kehysvälin ja laitteen
+ * käsittelyajan verran. Väylä varataan kokeilu kerrallaan, joten muu
+ * liikenne ehtii väliin eikä käyttöliittymä jumitu haun ajaksi.
+ */
+
+#include "modbus_scan.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "modbus_handler.h"
+#include "modbus_slave.h"
+#include "register_map.h"
+#include "rs485_handler.h"
+#include "app_events.h"
+
+static const char *TAG = "MODBUS_SCAN";
+
+// Ehdokasnopeudet, yleisin ensin. Mukana kaikki neuvottelun nopeudet, jotta
+// neuvoteltu laite löytyy myös, jos sitä ei tavoiteta tallennetulla nopeudella
+static const uint32_t scan_baud_rates[] = { 19200, 9600, 38400, 57600, 115200, 230400 };
+
+// Neuvottelun ehdokkaat, suurin ensin
+static const uint32_t negotiate_baud_rates[] = { 230400, 115200, 57600, 38400 };
+
+// Uuden nopeuden varmistukseen käytettävien lukujen määrä
+#define MODBUS_NEGOTIATE_VERIFY_COUNT   (32)
+
+// Aika, jonka laite tarvitsee nopeuden vaihtoon vastauksensa jälkeen
+#define NEGOTIATE_SWITCH_DELAY_MS       (50)
+
+#define SCAN_BAUD_COUNT         (sizeof(scan_baud_rates) / sizeof(scan_baud_rates[0]))
+#define SCAN_ADDRESS_COUNT      (MODBUS_SLAVE_ID_MAX - MODBUS_SLAVE_ID_MIN + 1)
+
+static portMUX_TYPE status_lock = portMUX_INITIALIZER_UNLOCKED;
+static modbus_scan_status_t status;
+
+static void set_status(uint32_t baud_rate, uint8_t slave_id, uint32_t done, uint16_t found)
+{
+    taskENTER_CRITICAL(&status_lock);
+    status.baud_rate = baud_rate;
+    status.slave_id = slave_id;
+    status.progress = (uint8_t)(done * 100 / (SCAN_BAUD_COUNT * SCAN_ADDRESS_COUNT));
+    status.found = found;
+    status.generation++;
+    taskEXIT_CRITICAL(&status_lock);
+    app_events_post(APP_EVENT_SCAN_STATUS);
+}
+
+static void scan_task(void *arg)
+{
+    static uint32_t known_baud[MODBUS_SLAVE_ID_MAX + 1];
+    uint16_t found = 0;
+    uint32_t done = 0;
+
+    for (int id = MODBUS_SLAVE_ID_MIN; id <= MODBUS_SLAVE_ID_MAX; id++) {
+        known_baud[id] = modbus_slave_get_baud_rate(id);
+    }
+    modbus_slave_clear_found();
+
+    // Aiemmin löydetyt ensin tallennetulla nopeudella: neuvoteltu nopeus säilyy
+    for (int id = MODBUS_SLAVE_ID_MIN; id <= MODBUS_SLAVE_ID_MAX; id++) {
+        if (known_baud[id] != 0 &&
+                modbus_probe(id, known_baud[id], pdMS_TO_TICKS(CONFIG_MODBUS_SCAN_TURNAROUND_MS)) == ESP_OK) {
+            ESP_LOGI(TAG, "Laite %d vastasi tallennetulla nopeudella %lu", id, known_baud[id]);
+            modbus_slave_set_found(id, known_baud[id]);
+            found++;
+        }
+    }
+
+    for (size_t b = 0; b < SCAN_BAUD_COUNT; b++) {
+        uint32_t baud_rate = scan_baud_rates[b];
+
+        for (int id = MODBUS_SLAVE_ID_MIN; id <= MODBUS_SLAVE_ID_MAX; id++, done++) {
+            // Jo löydettyä laitetta ei kokeilla muilla nopeuksilla
+            if (modbus_slave_is_present(id)) {
+                continue;
+            }
+
+            if (modbus_probe(id, baud_rate, pdMS_TO_TICKS(CONFIG_MODBUS_SCAN_TURNAROUND_MS)) == ESP_OK) {
+                ESP_LOGI(TAG, "Laite %d vastasi nopeudella %lu", id, baud_rate);
+                modbus_slave_set_found(id, baud_rate);
+                found++;
+            }
+            set_status(baud_rate, id, done + 1, found);
+        }
+    }
+
+    // Löydettyjen laitteiden kyvyt, jotta luvut voidaan jakaa oikean kokoisiin pyyntöihin
+    for (int id = MODBUS_SLAVE_ID_MIN; id <= MODBUS_SLAVE_ID_MAX; id++) {
+        if (modbus_slave_is_present(id)) {
+            modbus_probe_capabilities(id);
+        }
+    }
+
+    modbus_slave_save();
+    ESP_LOGI(TAG, "Haku valmis, %u laitetta", found);
+
+    taskENTER_CRITICAL(&status_lock);
+    status.running = false;
+    status.progress = 100;
+    status.generation++;
+    taskEXIT_CRITICAL(&status_lock);
+    app_events_post(APP_EVENT_SCAN_STATUS);
+
+    vTaskDelete(NULL);
+}
+
+esp_err_t modbus_scan_start(void)
+{
+    taskENTER_CRITICAL(&status_lock);
+    if (status.running) {
+        taskEXIT_CRITICAL(&status_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    status.running = true;
+    status.progress = 0;
+    status.found = 0;
+    status.generation++;
+    taskEXIT_CRITICAL(&status_lock);
+    app_events_post(APP_EVENT_SCAN_STATUS);
+
+    // Sama prioriteetti kuin LVGL-taskilla, jotta kosketus ei hidastu
+    if (xTaskCreate(scan_task, "modbus_scan", 4096, NULL, 2, NULL) != pdPASS) {
+        taskENTER_CRITICAL(&status_lock);
+        status.running = false;
+        status.generation++;
+        taskEXIT_CRITICAL(&status_lock);
+        app_events_post(APP_EVENT_SCAN_STATUS);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void modbus_scan_get_status(modbus_scan_status_t *out)
+{
+    taskENTER_CRITICAL(&status_lock);
+    *out = status;
+    taskEXIT_CRITICAL(&status_lock);
+}
+
+// Luvun aloitusosoitteet, joiden tiedetään olevan laitteessa (register_map.h)
+static const uint16_t probe_addresses[] = { FORTEST_PROGRAM_SELECT_ADDR, OPTA_SERIAL_BAUD_ADDR };
+
+// Suurin rekisterimäärä, jonka laite palauttaa yhdellä luvulla, 0 = ei selvinnyt.
+// Määrää kasvatetaan kunnes luku epäonnistuu, sitten raja haetaan puolittamalla.
+static uint8_t probe_max_read(uint8_t slave_id)
+{
+    static uint16_t values[MODBUS_MAX_READ_REGISTERS];     // Vain hakutaskin käytössä
+    uint8_t exception = 0;
+    size_t a;
+
+    for (a = 0; a < sizeof(probe_addresses) / sizeof(probe_addresses[0]); a++) {
+        if (modbus_read_holding_block(slave_id, probe_addresses[a], 1, values, &exception) == ESP_OK) {
+            break;
+        }
+    }
+    if (a == sizeof(probe_addresses) / sizeof(probe_addresses[0])) {
+        return 0;
+    }
+
+    uint16_t good = 1;
+    uint16_t bad = MODBUS_MAX_READ_REGISTERS + 1;
+    uint16_t count = 2;
+
+    while (count > good && count < bad) {
+        esp_err_t ret = modbus_read_holding_block(slave_id, probe_addresses[a], count, values, &exception);
+        if (ret == ESP_OK) {
+            good = count;
+        } else if (modbus_slave_breaker_get_state(slave_id) == MODBUS_BREAKER_OPEN) {
+            // Laite ei vastaa lainkaan, tulos ei olisi luotettava
+            return 0;
+        } else if (ret == ESP_ERR_TIMEOUT ||
+                   (ret == ESP_ERR_MODBUS_EXCEPTION && exception == MODBUS_EXCEPTION_ILLEGAL_VALUE)) {
+            // Liian suuri määrä: laite hylkäsi sen tai ei saanut vastausta valmiiksi
+            bad = count;
+        } else {
+            // Esim. poikkeus 02: luku ylitti laitteen rekisterialueen, rajaa ei saatu selville
+            ESP_LOGI(TAG, "Laite %d: lukuraja ei selvinnyt (%s, poikkeus %u)", slave_id,
+                     esp_err_to_name(ret), exception);
+            return 0;
+        }
+        if (bad > MODBUS_MAX_READ_REGISTERS) {
+            count = (2 * good < MODBUS_MAX_READ_REGISTERS) ? 2 * good : MODBUS_MAX_READ_REGISTERS;
+        } else {
+            count = (good + bad) / 2;
+        }
+    }
+    return (uint8_t)good;
+}
+
+esp_err_t modbus_probe_capabilities(uint8_t slave_id)
+{
+    uint8_t caps = 0;
+    uint8_t max_read = 0;
+
+    // Vanha raja jakaisi kokeilupyynnöt osiin
+    modbus_slave_set_capabilities(slave_id, 0, 0);
+
+    if (modbus_check_function(slave_id, MODBUS_READ_HOLDING_REGISTERS) == ESP_OK) {
+        caps |= MODBUS_CAP_READ_HOLDING;
+        max_read = probe_max_read(slave_id);
+    }
+    if (modbus_check_function(slave_id, MODBUS_WRITE_MULTIPLE_REGISTERS) == ESP_OK) {
+        caps |= MODBUS_CAP_WRITE_MULTIPLE;
+    }
+
+    modbus_device_id_t id;
+    if (modbus_read_device_id(slave_id, &id) == ESP_OK) {
+        caps |= MODBUS_CAP_DEVICE_ID;
+        modbus_slave_save_device_id(slave_id, &id);
+        ESP_LOGI(TAG, "Laite %d: %s %s %s", slave_id, id.vendor, id.product, id.revision);
+    }
+
+    if (modbus_slave_breaker_get_state(slave_id) == MODBUS_BREAKER_OPEN) {
+        ESP_LOGW(TAG, "Laite %d lakkasi vastaamasta kykyjen selvityksen aikana", slave_id);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    modbus_slave_set_capabilities(slave_id, caps | MODBUS_CAP_PROBED, max_read);
+    ESP_LOGI(TAG, "Laite %d: kyvyt 0x%02X, enintään %u rekisteriä/luku", slave_id, caps, max_read);
+    return ESP_OK;
+}
+
+// Lukee nopeusrekisteriä toistuvasti, kaikkien pitää onnistua
+static bool verify_baud(uint8_t slave_id, uint16_t baud_register, uint32_t baud_rate)
+{
+    for (int i = 0; i < MODBUS_NEGOTIATE_VERIFY_COUNT; i++) {
+        uint16_t value;
+        if (modbus_read_holding_registers(slave_id, baud_register, 1, &value) != ESP_OK ||
+            value != baud_rate / 100) {
+            ESP_LOGW(TAG, "Laite %d: varmistus %lu bit/s epäonnistui luvulla %d", slave_id, baud_rate, i + 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Pyytää laitetta vaihtamaan nopeutta. Vastaus tulee vielä vanhalla nopeudella.
+static esp_err_t switch_baud(uint8_t slave_id, uint16_t baud_register, uint32_t baud_rate)
+{
+    esp_err_t ret = modbus_write_single_register(slave_id, baud_register, baud_rate / 100);
+    if (ret == ESP_OK) {
+        modbus_slave_set_found(slave_id, baud_rate);
+        vTaskDelay(pdMS_TO_TICKS(NEGOTIATE_SWITCH_DELAY_MS));
+    }
+    return ret;
+}
+
+esp_err_t modbus_negotiate_baud(uint8_t slave_id, uint16_t baud_register, uint32_t *baud_rate)
+{
+    rs485_config_t config;
+    rs485_get_config(&config);
+
+    uint32_t current = modbus_slave_get_baud_rate(slave_id);
+    if (current == 0) {
+        current = config.baud_rate;
+    }
+
+    // Laitteen pitää tuntea nopeusrekisteri ja nykyinen nopeus
+    if (!verify_baud(slave_id, baud_register, current)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    bool accepted = false;
+    for (size_t i = 0; i < sizeof(negotiate_baud_rates) / sizeof(negotiate_baud_rates[0]); i++) {
+        uint32_t candidate = negotiate_baud_rates[i];
+        if (candidate <= current) {
+            // Laite on jo vähintään tällä nopeudella
+            accepted = true;
+            break;
+        }
+
+        ESP_LOGI(TAG, "Laite %d: kokeillaan %lu bit/s", slave_id, candidate);
+        if (switch_baud(slave_id, baud_register, candidate) != ESP_OK) {
+            continue;
+        }
+        accepted = true;
+        if (verify_baud(slave_id, baud_register, candidate)) {
+            current = candidate;
+            break;
+        }
+
+        // Palautus edelliselle nopeudelle. Jos laite ei kuule käskyä uudella
+        // nopeudella, se palaa itse kun liikennettä ei kuulu.
+        switch_baud(slave_id, baud_register, current);
+        modbus_slave_set_found(slave_id, current);
+        if (!verify_baud(slave_id, baud_register, current)) {
+            ESP_LOGE(TAG, "Laite %d ei vastaa enää nopeudella %lu", slave_id, current);
+            modbus_slave_save();
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+
+    modbus_slave_set_found(slave_id, current);
+    modbus_slave_save();
+
+    ESP_LOGI(TAG, "Laite %d: %lu bit/s", slave_id, current);
+    *baud_rate = current;
+    return accepted ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+}
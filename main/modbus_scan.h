@@ -0,0 +1,67 @@
+/**
+ * Modbus Scan Header
+ *
+ * Väylän laitteiden haku: kaikki osoitteet 1-247 kokeillaan jokaisella
+ * ehdokasnopeudella. Haku ajetaan omassa taskissaan, ja löydetyt laitteet
+ * tallennetaan slave-taulukkoon (modbus_slave.h). Tukevat laitteet voi
+ * tämän jälkeen siirtää suuremmalle nopeudelle.
+ */
+
+#ifndef MODBUS_SCAN_H
+#define MODBUS_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct {
+    bool running;
+    uint32_t baud_rate;         // Nopeus, jolla haku on menossa
+    uint8_t slave_id;           // Viimeksi kokeiltu osoite
+    uint8_t progress;           // 0-100 %
+    uint16_t found;             // Löydettyjen laitteiden määrä
+    uint32_t generation;        // Kasvaa aina kun tila muuttuu
+} modbus_scan_status_t;
+
+/**
+ * @brief Käynnistää haun taustalla
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_STATE jos haku on jo käynnissä
+ */
+esp_err_t modbus_scan_start(void);
+
+/**
+ * @brief Palauttaa haun tilan
+ */
+void modbus_scan_get_status(modbus_scan_status_t *status);
+
+/**
+ * @brief Siirtää laitteen suurimmalle nopeudelle, jolla liikenne toimii virheettä
+ *
+ * Laitteelle kirjoitetaan uusi nopeus (nopeus / 100) sen nopeusrekisteriin,
+ * minkä jälkeen yhteys varmistetaan MODBUS_NEGOTIATE_VERIFY_COUNT luvulla.
+ * Jos yksikin epäonnistuu, laite palautetaan edelliselle nopeudelle ja
+ * kokeillaan seuraavaa pienempää. Tulos tallennetaan slave-taulukkoon.
+ * Kutsu taskista, joka saa blokata (kestää sekunteja).
+ *
+ * @param slave_id Laitteen osoite
+ * @param baud_register Laitteen nopeusrekisteri (esim. OPTA_SERIAL_BAUD_ADDR)
+ * @param baud_rate Laitteen nopeus neuvottelun jälkeen
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_SUPPORTED jos laite ei hyväksy nopeuden vaihtoa
+ */
+esp_err_t modbus_negotiate_baud(uint8_t slave_id, uint16_t baud_register, uint32_t *baud_rate);
+
+/**
+ * @brief Selvittää laitteen kyvyt ja tunnistetiedot
+ *
+ * Kokeilee FC 0x03- ja FC 0x10 -tuen, hakee suurimman yhdellä pyynnöllä
+ * luettavan rekisterimäärän (puolitushaku osoitteesta 0) ja lukee
+ * tunnistetiedot (FC 0x2B / 0x0E). Kyvyt tallennetaan slave-taulukkoon
+ * (tallennus NVS:ään modbus_slave_save():lla) ja tunnistetiedot suoraan
+ * NVS:ään. Haku kutsuu tätä jokaiselle löydetylle laitteelle.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_TIMEOUT jos laite lakkasi vastaamasta kesken
+ */
+esp_err_t modbus_probe_capabilities(uint8_t slave_id);
+
+#endif /* MODBUS_SCAN_H */
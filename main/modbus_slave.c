@@ -0,0 +1,273 @@
+/**
+ * Modbus Slave Functions
+ *
+ * Asetukset ovat taulukossa slave-osoitteen mukaan, joten haku on
+ * suora indeksointi. Yksittäiset kentät voi lukea ilman lukitusta.
+ */
+
+#include "modbus_slave.h"
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#define SLAVE_VALID(id)         ((id) >= MODBUS_SLAVE_ID_MIN && (id) <= MODBUS_SLAVE_ID_MAX)
+
+#define NVS_NAMESPACE           "modbus"
+#define NVS_KEY_SLAVES          "slaves"
+#define NVS_KEY_DEVICE_ID       "id%u"          // Tunnistetiedot laitetta kohden
+
+// Taulukon versio NVS:ssä, kasvatetaan kun slave_config_t muuttuu
+#define SLAVE_TABLE_VERSION     (1)
+
+static const char *TAG = "MODBUS_SLAVE";
+
+// Uudet kentät on otettu varatuista tavuista, joten vanhassa taulukossa ne ovat nollia
+typedef struct {
+    uint32_t baud_rate;         // Löydetty nopeus, 0 = ei löydetty
+    uint8_t word_order;         // word_order_t
+    uint8_t capabilities;       // MODBUS_CAP_*
+    uint8_t max_read;           // Rekisterejä pyyntöä kohden, 0 = ei tiedossa
+    uint8_t reserved[1];
+} slave_config_t;
+
+_Static_assert(sizeof(slave_config_t) == 8, "slave_config_t:n koko muuttui, kasvata SLAVE_TABLE_VERSION");
+
+typedef struct {
+    uint32_t version;
+    slave_config_t slaves[MODBUS_SLAVE_ID_MAX + 1];
+} slave_table_t;
+
+static slave_table_t table = { .version = SLAVE_TABLE_VERSION };
+
+// Eristysaika kaksinkertaistuu jokaisella epäonnistuneella kokeilulla tähän asti
+#define BREAKER_MAX_BACKOFF_SHIFT   (4)
+
+// Katkaisijan tila, vain ajonaikainen. Päivitetään väylän lukon alla.
+typedef struct {
+    uint8_t state;              // modbus_breaker_state_t
+    uint8_t failures;           // Peräkkäiset vastaamatta jääneet pyynnöt
+    uint8_t trips;              // Peräkkäiset eristykset ilman välissä onnistunutta pyyntöä
+    TickType_t opened;          // Eristyksen alku
+} slave_breaker_t;
+
+static slave_breaker_t breakers[MODBUS_SLAVE_ID_MAX + 1];
+
+esp_err_t modbus_slave_load(void)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    static slave_table_t loaded;
+    size_t size = sizeof(loaded);
+    ret = nvs_get_blob(handle, NVS_KEY_SLAVES, &loaded, &size);
+    nvs_close(handle);
+
+    if (ret == ESP_OK && (size != sizeof(loaded) || loaded.version != SLAVE_TABLE_VERSION)) {
+        ESP_LOGW(TAG, "Tallennettu slave-taulukko on eri versiota, ohitetaan");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (ret == ESP_OK) {
+        table = loaded;
+    }
+    return ret;
+}
+
+esp_err_t modbus_slave_save(void)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = nvs_set_blob(handle, NVS_KEY_SLAVES, &table, sizeof(table));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Slave-taulukon tallennus epäonnistui: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+void modbus_slave_clear_found(void)
+{
+    for (int id = MODBUS_SLAVE_ID_MIN; id <= MODBUS_SLAVE_ID_MAX; id++) {
+        table.slaves[id].baud_rate = 0;
+    }
+}
+
+esp_err_t modbus_slave_set_found(uint8_t slave_id, uint32_t baud_rate)
+{
+    if (!SLAVE_VALID(slave_id)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    table.slaves[slave_id].baud_rate = baud_rate;
+    return ESP_OK;
+}
+
+bool modbus_slave_is_present(uint8_t slave_id)
+{
+    return SLAVE_VALID(slave_id) && table.slaves[slave_id].baud_rate != 0;
+}
+
+uint32_t modbus_slave_get_baud_rate(uint8_t slave_id)
+{
+    return SLAVE_VALID(slave_id) ? table.slaves[slave_id].baud_rate : 0;
+}
+
+esp_err_t modbus_slave_set_word_order(uint8_t slave_id, word_order_t order)
+{
+    if (!SLAVE_VALID(slave_id)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    table.slaves[slave_id].word_order = (uint8_t)order;
+    return ESP_OK;
+}
+
+word_order_t modbus_slave_get_word_order(uint8_t slave_id)
+{
+    return SLAVE_VALID(slave_id) ? (word_order_t)table.slaves[slave_id].word_order : WORD_ORDER_HIGH_FIRST;
+}
+
+esp_err_t modbus_slave_set_capabilities(uint8_t slave_id, uint8_t capabilities, uint8_t max_read)
+{
+    if (!SLAVE_VALID(slave_id)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    table.slaves[slave_id].capabilities = capabilities;
+    table.slaves[slave_id].max_read = max_read;
+    return ESP_OK;
+}
+
+uint8_t modbus_slave_get_capabilities(uint8_t slave_id)
+{
+    return SLAVE_VALID(slave_id) ? table.slaves[slave_id].capabilities : 0;
+}
+
+uint8_t modbus_slave_get_max_read(uint8_t slave_id)
+{
+    return SLAVE_VALID(slave_id) ? table.slaves[slave_id].max_read : 0;
+}
+
+esp_err_t modbus_slave_save_device_id(uint8_t slave_id, const modbus_device_id_t *id)
+{
+    if (!SLAVE_VALID(slave_id)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char key[8];
+    snprintf(key, sizeof(key), NVS_KEY_DEVICE_ID, slave_id);
+    ret = nvs_set_blob(handle, key, id, sizeof(*id));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+esp_err_t modbus_slave_load_device_id(uint8_t slave_id, modbus_device_id_t *id)
+{
+    if (!SLAVE_VALID(slave_id)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char key[8];
+    snprintf(key, sizeof(key), NVS_KEY_DEVICE_ID, slave_id);
+    size_t size = sizeof(*id);
+    ret = nvs_get_blob(handle, key, id, &size);
+    nvs_close(handle);
+
+    if (ret == ESP_OK && size != sizeof(*id)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ret;
+}
+
+static TickType_t breaker_open_ticks(const slave_breaker_t *b)
+{
+    uint8_t shift = b->trips - 1;
+    if (shift > BREAKER_MAX_BACKOFF_SHIFT) {
+        shift = BREAKER_MAX_BACKOFF_SHIFT;
+    }
+    return pdMS_TO_TICKS(CONFIG_MODBUS_BREAKER_OPEN_MS) << shift;
+}
+
+bool modbus_slave_breaker_allow(uint8_t slave_id)
+{
+    if (!SLAVE_VALID(slave_id)) {
+        return true;
+    }
+
+    slave_breaker_t *b = &breakers[slave_id];
+    switch (b->state) {
+        case MODBUS_BREAKER_OPEN:
+            if (xTaskGetTickCount() - b->opened < breaker_open_ticks(b)) {
+                return false;
+            }
+            b->state = MODBUS_BREAKER_HALF_OPEN;
+            ESP_LOGI(TAG, "Laite %d: kokeillaan eristyksen jälkeen", slave_id);
+            return true;
+        case MODBUS_BREAKER_HALF_OPEN:
+            // Kokeilu on jo menossa
+            return false;
+        default:
+            return true;
+    }
+}
+
+void modbus_slave_breaker_record(uint8_t slave_id, bool responded)
+{
+    if (!SLAVE_VALID(slave_id)) {
+        return;
+    }
+
+    slave_breaker_t *b = &breakers[slave_id];
+    if (responded) {
+        if (b->state != MODBUS_BREAKER_CLOSED) {
+            ESP_LOGI(TAG, "Laite %d vastaa taas", slave_id);
+        }
+        b->state = MODBUS_BREAKER_CLOSED;
+        b->failures = 0;
+        b->trips = 0;
+        return;
+    }
+
+    if (b->failures < UINT8_MAX) {
+        b->failures++;
+    }
+    if (b->state == MODBUS_BREAKER_HALF_OPEN || b->failures >= CONFIG_MODBUS_BREAKER_THRESHOLD) {
+        if (b->trips < UINT8_MAX) {
+            b->trips++;
+        }
+        b->state = MODBUS_BREAKER_OPEN;
+        b->opened = xTaskGetTickCount();
+        ESP_LOGW(TAG, "Laite %d ei vastaa, eristetään %lu ms", slave_id,
+                 breaker_open_ticks(b) * portTICK_PERIOD_MS);
+    }
+}
+
+modbus_breaker_state_t modbus_slave_breaker_get_state(uint8_t slave_id)
+{
+    return SLAVE_VALID(slave_id) ? (modbus_breaker_state_t)breakers[slave_id].state : MODBUS_BREAKER_CLOSED;
+}
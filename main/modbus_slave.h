@@ -0,0 +1,143 @@
+/**
+ * Modbus Slave Header
+ *
+ * Väylän slave-laitteiden taulukko osoitteen mukaan: löydetyt laitteet,
+ * niiden nopeus ja rekisterijärjestys. Taulukko tallennetaan NVS:ään.
+ *
+ * Lisäksi jokaisella osoitteella on katkaisija (ei tallenneta): kun laite
+ * jättää CONFIG_MODBUS_BREAKER_THRESHOLD peräkkäistä pyyntöä vastaamatta,
+ * se eristetään eikä sille lähetetä mitään CONFIG_MODBUS_BREAKER_OPEN_MS
+ * aikaan. Sen jälkeen yksi pyyntö päästetään läpi kokeiluna: vastaus
+ * palauttaa laitteen käyttöön, vastaamatta jääminen eristää sen uudelleen
+ * kaksinkertaisella ajalla.
+ */
+
+#ifndef MODBUS_SLAVE_H
+#define MODBUS_SLAVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "register_decode.h"
+
+// Modbus RTU: osoitteet 1-247
+#define MODBUS_SLAVE_ID_MIN     (1)
+#define MODBUS_SLAVE_ID_MAX     (247)
+
+// Laitteen tuetut toiminnot, selvitetään haun yhteydessä (modbus_scan.h)
+#define MODBUS_CAP_PROBED           (1 << 0)    // Kyvyt on selvitetty
+#define MODBUS_CAP_READ_HOLDING     (1 << 1)    // FC 0x03
+#define MODBUS_CAP_WRITE_MULTIPLE   (1 << 2)    // FC 0x10
+#define MODBUS_CAP_DEVICE_ID        (1 << 3)    // FC 0x2B / MEI 0x0E
+
+/**
+ * @brief Laitteen perustunnistetiedot (Read Device Identification, basic)
+ */
+typedef struct {
+    char vendor[32];                // Objekti 0x00
+    char product[32];               // Objekti 0x01
+    char revision[16];              // Objekti 0x02
+} modbus_device_id_t;
+
+/**
+ * @brief Lataa slave-taulukon NVS:stä
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NVS_NOT_FOUND jos taulukkoa ei ole vielä tallennettu
+ */
+esp_err_t modbus_slave_load(void);
+
+/**
+ * @brief Tallentaa slave-taulukon NVS:ään
+ */
+esp_err_t modbus_slave_save(void);
+
+/**
+ * @brief Merkitsee kaikki laitteet puuttuviksi (asetukset säilyvät)
+ */
+void modbus_slave_clear_found(void);
+
+/**
+ * @brief Merkitsee laitteen löydetyksi annetulla nopeudella
+ */
+esp_err_t modbus_slave_set_found(uint8_t slave_id, uint32_t baud_rate);
+
+/**
+ * @brief Onko osoitteessa löydetty laite
+ */
+bool modbus_slave_is_present(uint8_t slave_id);
+
+/**
+ * @brief Nopeus, jolla laite löydettiin (0 jos ei löydetty)
+ */
+uint32_t modbus_slave_get_baud_rate(uint8_t slave_id);
+
+/**
+ * @brief Asettaa slaven 32-bittisten arvojen rekisterijärjestyksen
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG jos osoite on virheellinen
+ */
+esp_err_t modbus_slave_set_word_order(uint8_t slave_id, word_order_t order);
+
+/**
+ * @brief Palauttaa slaven rekisterijärjestyksen (oletus WORD_ORDER_HIGH_FIRST)
+ */
+word_order_t modbus_slave_get_word_order(uint8_t slave_id);
+
+/**
+ * @brief Tallentaa laitteen kyvyt
+ *
+ * @param capabilities MODBUS_CAP_*-bitit
+ * @param max_read Suurin yhdellä pyynnöllä luettava rekisterimäärä, 0 = ei tiedossa
+ */
+esp_err_t modbus_slave_set_capabilities(uint8_t slave_id, uint8_t capabilities, uint8_t max_read);
+
+/**
+ * @brief Laitteen MODBUS_CAP_*-bitit (0 jos kykyjä ei ole selvitetty)
+ */
+uint8_t modbus_slave_get_capabilities(uint8_t slave_id);
+
+/**
+ * @brief Suurin yhdellä pyynnöllä luettava rekisterimäärä (0 = ei tiedossa)
+ */
+uint8_t modbus_slave_get_max_read(uint8_t slave_id);
+
+/**
+ * @brief Tallentaa laitteen tunnistetiedot NVS:ään (oma avain laitetta kohden)
+ */
+esp_err_t modbus_slave_save_device_id(uint8_t slave_id, const modbus_device_id_t *id);
+
+/**
+ * @brief Lataa laitteen tunnistetiedot NVS:stä
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NVS_NOT_FOUND jos tietoja ei ole tallennettu
+ */
+esp_err_t modbus_slave_load_device_id(uint8_t slave_id, modbus_device_id_t *id);
+
+typedef enum {
+    MODBUS_BREAKER_CLOSED = 0,      // Normaali liikenne
+    MODBUS_BREAKER_OPEN,            // Eristetty, pyynnöt hylätään
+    MODBUS_BREAKER_HALF_OPEN,       // Kokeilupyyntö menossa
+} modbus_breaker_state_t;
+
+/**
+ * @brief Saako laitteelle lähettää pyynnön
+ *
+ * Kutsutaan väylän lukon alla juuri ennen lähetystä. Eristysajan jälkeen
+ * palauttaa true yhden kerran ja siirtää katkaisijan kokeilutilaan.
+ * Virheelliset osoitteet (esim. yleislähetys 0) päästetään aina läpi.
+ */
+bool modbus_slave_breaker_allow(uint8_t slave_id);
+
+/**
+ * @brief Kirjaa pyynnön tuloksen katkaisijalle
+ *
+ * @param responded true jos laite vastasi (myös poikkeuksella)
+ */
+void modbus_slave_breaker_record(uint8_t slave_id, bool responded);
+
+/**
+ * @brief Katkaisijan nykyinen tila
+ */
+modbus_breaker_state_t modbus_slave_breaker_get_state(uint8_t slave_id);
+
+#endif /* MODBUS_SLAVE_H */
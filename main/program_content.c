@@ -2,56 +2,74 @@
 #include "screen_manager.h"
 #include "esp_log.h"
 #include "modbus_handler.h"
+#include "modbus_cache.h"
+#include "modbus_slave.h"
 #include "rs485_handler.h"
+#include "app_events.h"
+#include "app_state.h"
+#include "freertos/task.h"
 #include <string.h>
 #include "fonts/my_custom_fonts.h"
 
 static const char *TAG = "program_content";
 
-// Nykyinen ohjelman valintatila
-typedef struct {
-    uint16_t program1;
-    uint16_t program2;
-    uint16_t program3;
-    bool program2_enabled;
-    bool program3_enabled;
-    char program1_name[32];
-    char program2_name[32];
-    char program3_name[32];
-} program_selection_t;
-
-static program_selection_t program_selection = {
-    .program1 = 1,
-    .program2 = 2,
-    .program3 = 3,
-    .program2_enabled = true,
-    .program3_enabled = true,
-    .program1_name = "Ohjelma 1",
-    .program2_name = "Ohjelma 2",
-    .program3_name = "Ohjelma 3"
-};
+// Näkymän kopiot app_state-kentistä ja piirrettyjen kopioiden versiot
+static app_programs_t programs_view;
+static app_program_names_t names_view;
+static uint32_t shown_programs_version;
+static uint32_t shown_names_version;
+
+// Nimihaun työkopio, julkaistaan jokaisen nimen jälkeen
+static app_program_names_t fetch_names;
 
 // LVGL-objekteja
-static lv_obj_t* program1_label = NULL;
-static lv_obj_t* program2_label = NULL;
-static lv_obj_t* program3_label = NULL;
-static lv_obj_t* program1_name_label = NULL;
-static lv_obj_t* program2_name_label = NULL;
-static lv_obj_t* program3_name_label = NULL;
-static lv_obj_t* program2_checkbox = NULL;
-static lv_obj_t* program3_checkbox = NULL;
+static lv_obj_t* program_labels[FORTEST_PROGRAM_SLOTS] = {NULL};
+static lv_obj_t* name_labels[FORTEST_PROGRAM_SLOTS] = {NULL};
+static lv_obj_t* checkboxes[FORTEST_PROGRAM_SLOTS] = {NULL};     // Ohjelma 1 on aina käytössä
 static lv_obj_t* status_label = NULL;
 static lv_obj_t* program_selection_list = NULL;
 static lv_obj_t* program_selection_popup = NULL;
 static lv_obj_t* update_spinner = NULL;
 
-// Ohjelmien nimet varastoidaan tähän
-static char program_names[30][32];
-static bool program_names_loaded = false;
-
 static uint8_t current_program_selection = 0; // 1, 2 tai 3 riippuen mikä ohjelma valitaan
 
-static bool is_screen_active = false;
+
+// Tallennus tehdään omassa taskissaan, tulos näytetään APP_EVENT_PROGRAM_SAVE-tapahtumasta
+typedef enum {
+    SAVE_IDLE = 0,
+    SAVE_RUNNING,
+    SAVE_OK,
+    SAVE_VERIFY_FAILED,             // Kirjoitus meni läpi, mutta takaisinluku ei täsmää
+    SAVE_FAILED,
+} save_state_t;
+
+typedef struct {
+    save_state_t state;
+    esp_err_t error;
+} save_status_t;
+
+static portMUX_TYPE save_lock = portMUX_INITIALIZER_UNLOCKED;
+static save_status_t save_status;
+
+// Ohjelmanimen luku: yritykset, ensimmäinen odotus ja jaetun tuloksen ikäraja
+#define NAME_READ_ATTEMPTS      3
+#define NAME_READ_BACKOFF_MS    50
+#define NAME_READ_MAX_AGE_MS    1000
+
+// Takaisinluvun yritykset ja odotus ennen uutta lukua: laite voi ottaa arvot
+// käyttöön vasta hetken kirjoituksen kuittauksen jälkeen
+#define SAVE_VERIFY_ATTEMPTS    3
+#define SAVE_VERIFY_DELAY_MS    100
+
+// Kirjoitettavat rekisterit 0x0060 alkaen: ohjelmat 1-3, ohjelmien 2-3 käyttöliput
+#ifdef CONFIG_FORTEST_MULTI_PROGRAM
+#define SAVE_WORDS              FORTEST_PROGRAM_BLOCK_WORDS
+#else
+#define SAVE_WORDS              1
+#endif
+
+// Kirjoitettavat arvot, ei muutu tallennuksen aikana
+static uint16_t save_values[FORTEST_PROGRAM_BLOCK_WORDS];
 
 /**
  * @brief Paranneltu funktio ohjelman nimen lukemiseen ForTest-laitteelta Modbus-RTU:lla
@@ -65,94 +83,36 @@ static bool read_program_name(uint8_t program_number, char* name_buffer, size_t
     // Alusta puskuri oletusarvolla
     snprintf(name_buffer, buffer_size, "Ohjelma %d", program_number + 1);
     
-    // ForTest manuaalista: Program name (0) alkaa osoitteesta 0xEA74
-    uint16_t base_address = 0xEA74;
-    uint16_t address = base_address + program_number;
+    // ForTest manuaalista: Program name (0) alkaa osoitteesta FORTEST_PROGRAM_NAME
+    uint16_t address = FORTEST_PROGRAM_NAME_ADDR + program_number;
     
     ESP_LOGI(TAG, "Luetaan ohjelmanimi %d osoitteesta 0x%04X", program_number + 1, address);
     
-    // Luo Modbus-komento ohjelman nimen lukemiseen (8 rekisteriä = 16 merkkiä)
-    // Read Holding Registers (0x03)
-    uint8_t tx_buffer[8];
-    tx_buffer[0] = MODBUS_DEFAULT_SLAVE_ID;  // Slave ID
-    tx_buffer[1] = 0x03;                     // Function code (Read Holding Registers)
-    tx_buffer[2] = (address >> 8) & 0xFF;    // Register address high byte
-    tx_buffer[3] = address & 0xFF;           // Register address low byte
-    tx_buffer[4] = 0x00;                     // Number of registers to read (high byte)
-    tx_buffer[5] = 0x08;                     // Number of registers to read (low byte) = 8 rekisteriä
-    
-    // Laske CRC
-    uint16_t crc = modbus_crc16(tx_buffer, 6);
-    tx_buffer[6] = crc & 0xFF;               // CRC low byte
-    tx_buffer[7] = (crc >> 8) & 0xFF;        // CRC high byte
-    
-    // Logita pyyntö debuggausta varten
-    ESP_LOGI(TAG, "TX: %02X %02X %02X %02X %02X %02X %02X %02X",
-        tx_buffer[0], tx_buffer[1], tx_buffer[2], tx_buffer[3],
-        tx_buffer[4], tx_buffer[5], tx_buffer[6], tx_buffer[7]);
-    
-    // Tyhjennä väylä varmuuden vuoksi
-    rs485_flush();
-    
-    // Lähetä pyyntö
-    esp_err_t ret = rs485_send_data(tx_buffer, 8);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Virhe lähetettäessä ohjelmanimen lukupyyntöä: %d", ret);
-        return false;
-    }
-    
-    // Vastauspuskuri (vastauksessa on control bytes + 16 bytes dataa + CRC)
-    uint8_t rx_buffer[32];
-    memset(rx_buffer, 0, sizeof(rx_buffer));
-    
-    // Odota vastausta hieman pidemmällä aikarajalla
-    int rx_length = rs485_receive_data(rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(500));
-    
-    // Logita vastaus debuggausta varten
-    if (rx_length > 0) {
-        ESP_LOGI(TAG, "RX (%d tavua):", rx_length);
-        for (int i = 0; i < rx_length && i < 30; i++) {
-            ESP_LOGI(TAG, "  tavu %d: 0x%02X (%c)", i, rx_buffer[i], 
-                    (rx_buffer[i] >= 32 && rx_buffer[i] <= 126) ? rx_buffer[i] : '.');
+    // Jaettu luku (modbus_cache.h): peräkkäiset päivitykset saavat juuri luetun nimen
+    // ilman uutta väyläpyyntöä. Nimen luku on turvallista toistaa, poikkeusvastausta ei.
+    uint16_t words[FORTEST_PROGRAM_NAME_WORDS];
+    esp_err_t ret = ESP_FAIL;
+    for (int attempt = 0; attempt < NAME_READ_ATTEMPTS; attempt++) {
+        if (attempt > 0) {
+            vTaskDelay(pdMS_TO_TICKS(NAME_READ_BACKOFF_MS << (attempt - 1)));
         }
-    }
-    
-    // Tarkista vastauksen pituus: 1 (slave) + 1 (fc) + 1 (byte count) + data + 2 (crc)
-    if (rx_length < 5) {
-        ESP_LOGE(TAG, "Vastaanotto epäonnistui tai väärä pituus: %d", rx_length);
-        return false;
-    }
-    
-    // Tarkista vastaus
-    if (rx_buffer[0] != MODBUS_DEFAULT_SLAVE_ID || rx_buffer[1] != 0x03) {
-        ESP_LOGE(TAG, "Virheellinen vastaus: slave=%02X, fc=%02X", rx_buffer[0], rx_buffer[1]);
-        return false;
-    }
-    
-    // Tarkista CRC
-    if (rx_length >= 2) {
-        uint16_t response_crc = rx_buffer[rx_length - 1] << 8 | rx_buffer[rx_length - 2];
-        uint16_t calc_crc = modbus_crc16(rx_buffer, rx_length - 2);
-        if (response_crc != calc_crc) {
-            ESP_LOGE(TAG, "CRC ei täsmää: odotettu 0x%04X, saatu 0x%04X", calc_crc, response_crc);
-            return false;
+        ret = modbus_read_shared(MODBUS_DEFAULT_SLAVE_ID, address, FORTEST_PROGRAM_NAME_WORDS, words,
+                                 NAME_READ_MAX_AGE_MS);
+        if (ret == ESP_OK || ret == ESP_ERR_MODBUS_EXCEPTION ||
+            modbus_slave_breaker_get_state(MODBUS_DEFAULT_SLAVE_ID) == MODBUS_BREAKER_OPEN) {
+            break;
         }
     }
-    
-    // Byte count kertoo kuinka monta tavua dataa tulee
-    uint8_t byte_count = rx_buffer[2];
-    if (byte_count < 1) {
-        ESP_LOGE(TAG, "Liian lyhyt data: %d tavua", byte_count);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Ohjelmanimen %d luku epäonnistui: %s", program_number + 1, esp_err_to_name(ret));
         return false;
     }
     
-    // Kopioi nimi puskuriin (alkaa 3. tavusta)
+    // ASCII koodattu merkki merkiltä, rekisterin ylempi tavu ensin
     memset(name_buffer, 0, buffer_size);
     int name_length = 0;
-    
-    // ASCII koodattu merkki merkiltä
-    for (int i = 0; i < byte_count && i < buffer_size - 1; i++) {
-        char ch = rx_buffer[3 + i];
+    for (int i = 0; i < FORTEST_PROGRAM_NAME_WORDS * 2 && i < buffer_size - 1; i++) {
+        char ch = (i & 1) ? (words[i / 2] & 0xFF) : (words[i / 2] >> 8);
         // Jos vastaan tulee nollamerkki tai muu ei-tulostettava merkki, lopetetaan
         if (ch == 0 || ch < 32) {
             break;
@@ -177,33 +137,19 @@ static bool read_program_name(uint8_t program_number, char* name_buffer, size_t
 }
 
 /**
- * @brief Päivitä kaikki ohjelmannimet laitteelta
+ * @brief Hakee kaikki ohjelmannimet laitteelta omassa taskissaan
+ *
+ * Nimet julkaistaan app_state:en jokaisen luvun jälkeen, joten näkymä
+ * näyttää edistymisen eikä LVGL-taski odota väylää.
  */
-static void update_program_names(void) {
-    // Näytä spinner-animaatio
-    if (update_spinner) {
-        lv_obj_clear_flag(update_spinner, LV_OBJ_FLAG_HIDDEN);
-    }
-    
-    lv_label_set_text(status_label, "Haetaan ohjelmatietoja...");
-    
+static void fetch_names_task(void *arg) {
     // Aseta kokonaisaikakatkaisun aika (10 sekuntia)
-    uint32_t start_time = xTaskGetTickCount();
-    uint32_t timeout_ticks = pdMS_TO_TICKS(10000); // 10 sekunnin aikakatkaisu
-    
-    // Peräkkäisten virheiden laskuri
-    int consecutive_failures = 0;
-    
-    // Alusta perusnimet (jos varsinainen lukeminen ei onnistu)
-    for (int i = 0; i < 30; i++) {
-        snprintf(program_names[i], sizeof(program_names[i]), "Ohjelma %d", i+1);
-    }
-    
-    // Haetaan ohjelmanimet yksi kerrallaan
-    int successful_reads = 0;
+    TickType_t start_time = xTaskGetTickCount();
+    TickType_t timeout_ticks = pdMS_TO_TICKS(10000); // 10 sekunnin aikakatkaisu
     bool timeout_occurred = false;
     
-    for (int i = 0; i < 30 && !timeout_occurred; i++) {
+    // Haetaan ohjelmanimet yksi kerrallaan
+    for (int i = 0; i < FORTEST_PROGRAM_COUNT; i++) {
         // Tarkista kokonaisaikakatkaisu
         if ((xTaskGetTickCount() - start_time) > timeout_ticks) {
             ESP_LOGW(TAG, "Kokonaisaikakatkaisu, lopetetaan haku");
@@ -211,50 +157,26 @@ static void update_program_names(void) {
             break;
         }
         
-        // Päivitä tilarivi joka 5 ohjelman jälkeen
-        if (i % 5 == 0) {
-            char status_text[40];
-            snprintf(status_text, sizeof(status_text), "Haetaan ohjelmia... %d%%", (i * 100) / 30);
-            lv_label_set_text(status_label, status_text);
-        }
-        
-        // Lopeta, jos 5 peräkkäistä epäonnistumista
-        if (consecutive_failures >= 5) {
-            ESP_LOGW(TAG, "Liian monta peräkkäistä epäonnistumista, lopetetaan");
+        // Lopeta, jos laite on eristetty vastaamattomana (modbus_slave.h)
+        if (modbus_slave_breaker_get_state(MODBUS_DEFAULT_SLAVE_ID) == MODBUS_BREAKER_OPEN) {
+            ESP_LOGW(TAG, "Laite ei vastaa, lopetetaan");
             break;
         }
         
-        // Yritä lukea ohjelmanimi
-        if (read_program_name(i, program_names[i], sizeof(program_names[i]))) {
-            successful_reads++;
-            consecutive_failures = 0; // Nollaa laskuri onnistumisen jälkeen
-        } else {
-            consecutive_failures++;
-            // Jos yksittäisen lukeminen epäonnistuu, käytä oletusta (jo alustettu)
+        // Yritä lukea ohjelmanimi. Jos lukeminen epäonnistuu, nimeksi jää oletus
+        if (read_program_name(i, fetch_names.name[i], sizeof(fetch_names.name[i]))) {
+            fetch_names.loaded++;
         }
+        fetch_names.fetched = i + 1;
+        app_state_set_program_names(&fetch_names);
         
         // Pieni viive jokaisen lukemisen välillä
         vTaskDelay(pdMS_TO_TICKS(20));
     }
     
-    // Merkitse onnistuneeksi, jos edes yksi luku onnistui
-    program_names_loaded = (successful_reads > 0);
-    
-    // Piilota spinner
-    if (update_spinner) {
-        lv_obj_add_flag(update_spinner, LV_OBJ_FLAG_HIDDEN);
-    }
-    
-    // Näytä tulos
-    char status_text[40];
-    if (timeout_occurred) {
-        lv_label_set_text(status_label, "Aikakatkaisu ohjelmien haussa");
-    } else if (successful_reads > 0) {
-        snprintf(status_text, sizeof(status_text), "Päivitetty %d/%d ohjelmaa", successful_reads, 30);
-        lv_label_set_text(status_label, status_text);
-    } else {
-        lv_label_set_text(status_label, "Ei ohjelmanimiä saatavilla");
-    }
+    fetch_names.state = timeout_occurred ? APP_NAMES_TIMEOUT : APP_NAMES_DONE;
+    app_state_set_program_names(&fetch_names);
+    vTaskDelete(NULL);
 }
 
 /**
@@ -263,49 +185,53 @@ static void update_program_names(void) {
 static void update_button_event_cb(lv_event_t* e) {
     if (lv_event_get_code(e) != LV_EVENT_CLICKED) return;
     
-    update_program_names();
+    // fetch_names on taskin käytössä, kunnes tila on julkaistu valmiiksi.
+    // Varaus tehdään tilavarastossa, ei näkymän kopiosta, joka voi olla vanha.
+    if (!app_state_begin_names_fetch()) {
+        return;
+    }
+    
+    // Alusta perusnimet (jos varsinainen lukeminen ei onnistu)
+    for (int i = 0; i < FORTEST_PROGRAM_COUNT; i++) {
+        snprintf(fetch_names.name[i], sizeof(fetch_names.name[i]), "Ohjelma %d", i + 1);
+    }
+    fetch_names.state = APP_NAMES_FETCHING;
+    fetch_names.fetched = 0;
+    fetch_names.loaded = 0;
+    app_state_set_program_names(&fetch_names);
+    
+    if (xTaskCreate(fetch_names_task, "program_names", 3072, NULL, 2, NULL) != pdPASS) {
+        fetch_names.state = APP_NAMES_DONE;
+        app_state_set_program_names(&fetch_names);
+    }
+}
+
+// Listassa ja valintapaneeleissa näytettävä nimi
+static void format_program_name(char* buf, size_t size, uint16_t program) {
+    if (names_view.loaded > 0 && program >= 1 && program <= FORTEST_PROGRAM_COUNT) {
+        // Rajoita ohjelmanimen pituutta, jotta numero mahtuu
+        snprintf(buf, size, "%.23s (%d)", names_view.name[program - 1], program);
+    } else {
+        snprintf(buf, size, "Ohjelma %d", program);
+    }
 }
 
 /**
  * @brief Ohjelmavalintalistan napautustapahtuma
  */
 static void program_list_event_handler(lv_event_t* e) {
-    lv_obj_t* btn = lv_event_get_target(e);
     if (lv_event_get_code(e) == LV_EVENT_CLICKED) {
         // Hae ohjelmanumero käyttäjädatasta
         uint16_t selected_program = (uint16_t)(uintptr_t)lv_event_get_user_data(e);
         
-        // Hae napin teksti
-        const char* selected_name = lv_list_get_btn_text(program_selection_list, btn);
-        
-        ESP_LOGI(TAG, "Valittu ohjelma: %d, nimi: %s", selected_program, selected_name);
+        ESP_LOGI(TAG, "Valittu ohjelma %d paikalle %d", selected_program, current_program_selection);
         
-        // Päivitä valittu ohjelma
-        switch (current_program_selection) {
-            case 1:
-                program_selection.program1 = selected_program;
-                strncpy(program_selection.program1_name, selected_name, sizeof(program_selection.program1_name)-1);
-                program_selection.program1_name[sizeof(program_selection.program1_name)-1] = '\0';
-                
-                // Päivitä vain name label
-                lv_label_set_text(program1_name_label, selected_name);
-                break;
-            case 2:
-                program_selection.program2 = selected_program;
-                strncpy(program_selection.program2_name, selected_name, sizeof(program_selection.program2_name)-1);
-                program_selection.program2_name[sizeof(program_selection.program2_name)-1] = '\0';
-                
-                // Päivitä vain name label
-                lv_label_set_text(program2_name_label, selected_name);
-                break;
-            case 3:
-                program_selection.program3 = selected_program;
-                strncpy(program_selection.program3_name, selected_name, sizeof(program_selection.program3_name)-1);
-                program_selection.program3_name[sizeof(program_selection.program3_name)-1] = '\0';
-                
-                // Päivitä vain name label
-                lv_label_set_text(program3_name_label, selected_name);
-                break;
+        // Päivitä valittu ohjelma, paneeli piirretään tilan muutoksesta
+        if (current_program_selection >= 1 && current_program_selection <= FORTEST_PROGRAM_SLOTS) {
+            app_programs_t programs;
+            app_state_get_programs(&programs);
+            programs.program[current_program_selection - 1] = selected_program;
+            app_state_set_programs(&programs);
         }
         
         // Sulje lista
@@ -368,21 +294,9 @@ static void select_program_event_cb(lv_event_t* e) {
     lv_obj_clear_flag(program_selection_list, LV_OBJ_FLAG_SCROLL_CHAIN);
     
     // Lisää ohjelmat listaan (1-30)
-    for (int i = 0; i < 30; i++) {
-        char buf[32];
-        
-        // Jos ohjelmannimet on ladattu, käytä niitä
-        if (program_names_loaded) {
-            // Rajoita ohjelmanimen pituutta, jotta numero mahtuu
-            char name_buf[24];  // varataan tilaa lyhennetylle nimelle
-            strncpy(name_buf, program_names[i], sizeof(name_buf) - 1);
-            name_buf[sizeof(name_buf) - 1] = '\0';
-            
-            snprintf(buf, sizeof(buf), "%s (%d)", name_buf, i+1);
-        } else {
-            // Muuten generoi oletusnimet
-            snprintf(buf, sizeof(buf), "Ohjelma %d", i+1);
-        }
+    for (int i = 0; i < FORTEST_PROGRAM_COUNT; i++) {
+        char buf[APP_PROGRAM_NAME_LEN];
+        format_program_name(buf, sizeof(buf), i + 1);
         
         lv_obj_t* btn = lv_list_add_btn(program_selection_list, NULL, buf);
         lv_obj_add_event_cb(btn, program_list_event_handler, LV_EVENT_CLICKED, (void*)(intptr_t)(i+1));
@@ -399,25 +313,166 @@ static void program_checkbox_event_cb(lv_event_t* e) {
     lv_obj_t* checkbox = lv_event_get_target(e);
     uint8_t program_num = (uint8_t)(uintptr_t)lv_event_get_user_data(e);
     
-    if (program_num == 2) {
-        program_selection.program2_enabled = lv_obj_has_state(checkbox, LV_STATE_CHECKED);
-        if (program_selection.program2_enabled) {
-            lv_obj_clear_state(program2_label, LV_STATE_DISABLED);
-            lv_obj_clear_state(program2_name_label, LV_STATE_DISABLED);
-        } else {
-            lv_obj_add_state(program2_label, LV_STATE_DISABLED);
-            lv_obj_add_state(program2_name_label, LV_STATE_DISABLED);
+    if (program_num >= 2 && program_num <= FORTEST_PROGRAM_SLOTS) {
+        app_programs_t programs;
+        app_state_get_programs(&programs);
+        programs.enabled[program_num - 1] = lv_obj_has_state(checkbox, LV_STATE_CHECKED);
+        app_state_set_programs(&programs);
+    }
+}
+
+static void set_obj_state(lv_obj_t* obj, lv_state_t state, bool on) {
+    if (on) {
+        lv_obj_add_state(obj, state);
+    } else {
+        lv_obj_clear_state(obj, state);
+    }
+}
+
+static void render_programs(void) {
+    char buf[APP_PROGRAM_NAME_LEN];
+    for (int i = 0; i < FORTEST_PROGRAM_SLOTS; i++) {
+        format_program_name(buf, sizeof(buf), programs_view.program[i]);
+        lv_label_set_text(name_labels[i], buf);
+        if (checkboxes[i]) {
+            bool enabled = programs_view.enabled[i];
+            set_obj_state(checkboxes[i], LV_STATE_CHECKED, enabled);
+            set_obj_state(program_labels[i], LV_STATE_DISABLED, !enabled);
+            set_obj_state(name_labels[i], LV_STATE_DISABLED, !enabled);
         }
-    } else if (program_num == 3) {
-        program_selection.program3_enabled = lv_obj_has_state(checkbox, LV_STATE_CHECKED);
-        if (program_selection.program3_enabled) {
-            lv_obj_clear_state(program3_label, LV_STATE_DISABLED);
-            lv_obj_clear_state(program3_name_label, LV_STATE_DISABLED);
-        } else {
-            lv_obj_add_state(program3_label, LV_STATE_DISABLED);
-            lv_obj_add_state(program3_name_label, LV_STATE_DISABLED);
+    }
+}
+
+static void render_fetch_status(bool show_result) {
+    if (names_view.state == APP_NAMES_FETCHING) {
+        lv_obj_clear_flag(update_spinner, LV_OBJ_FLAG_HIDDEN);
+        lv_label_set_text_fmt(status_label, "Haetaan ohjelmia... %d%%",
+                              names_view.fetched * 100 / FORTEST_PROGRAM_COUNT);
+        return;
+    }
+    
+    lv_obj_add_flag(update_spinner, LV_OBJ_FLAG_HIDDEN);
+    if (!show_result) {
+        return;
+    }
+    if (names_view.state == APP_NAMES_TIMEOUT) {
+        lv_label_set_text(status_label, "Aikakatkaisu ohjelmien haussa");
+    } else if (names_view.loaded > 0) {
+        lv_label_set_text_fmt(status_label, "Päivitetty %d/%d ohjelmaa", names_view.loaded, FORTEST_PROGRAM_COUNT);
+    } else if (names_view.state == APP_NAMES_DONE) {
+        lv_label_set_text(status_label, "Ei ohjelmanimiä saatavilla");
+    }
+}
+
+/**
+ * @brief Piirtää app_state-kentät, joiden versio on muuttunut
+ *
+ * Nimet vaikuttavat myös valintapaneeleihin, joten ne piirretään
+ * uudelleen kummankin kentän muuttuessa.
+ */
+static void render_state(bool force) {
+    bool names_changed = force || app_state_version(APP_STATE_PROGRAM_NAMES) != shown_names_version;
+    bool programs_changed = force || app_state_version(APP_STATE_PROGRAMS) != shown_programs_version;
+    
+    if (names_changed) {
+        shown_names_version = app_state_get_program_names(&names_view);
+        render_fetch_status(!force);
+    }
+    if (names_changed || programs_changed) {
+        shown_programs_version = app_state_get_programs(&programs_view);
+        render_programs();
+    }
+}
+
+static void state_changed_msg_cb(lv_event_t* e) {
+    render_state(false);
+}
+
+static void set_save_status(save_state_t state, esp_err_t error) {
+    taskENTER_CRITICAL(&save_lock);
+    save_status.state = state;
+    save_status.error = error;
+    taskEXIT_CRITICAL(&save_lock);
+    app_events_post(APP_EVENT_PROGRAM_SAVE);
+}
+
+/**
+ * @brief Kirjoittaa ohjelmavalinnat yhdellä pyynnöllä ja lukee ne takaisin
+ */
+static void save_task(void *arg) {
+    uint16_t readback[SAVE_WORDS];
+    esp_err_t ret;
+
+#ifdef CONFIG_FORTEST_MULTI_PROGRAM
+    // FC 0x10: laite ottaa kaikki valinnat ja käyttöliput käyttöön kerralla tai ei mitään
+    ret = modbus_write_multiple_registers(MODBUS_DEFAULT_SLAVE_ID, FORTEST_PROGRAM_SELECT_ADDR,
+                                          SAVE_WORDS, save_values);
+#else
+    ret = modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, FORTEST_PROGRAM_SELECT_ADDR, save_values[0]);
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Virhe ohjelmien tallennuksessa: %s", esp_err_to_name(ret));
+        set_save_status(SAVE_FAILED, ret);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    // Varmistus yhdellä luvulla koko alueesta, luku- tai vertailuvirheellä uudelleen
+    for (int attempt = 0; attempt < SAVE_VERIFY_ATTEMPTS; attempt++) {
+        vTaskDelay(pdMS_TO_TICKS(SAVE_VERIFY_DELAY_MS));
+        ret = modbus_read_holding_registers(MODBUS_DEFAULT_SLAVE_ID, FORTEST_PROGRAM_SELECT_ADDR,
+                                            SAVE_WORDS, readback);
+        if (ret == ESP_OK && memcmp(readback, save_values, sizeof(readback)) != 0) {
+            ESP_LOGW(TAG, "Takaisinluku %d/%d ei täsmää: ohjelma 1 = %u, odotettu %u",
+                     attempt + 1, SAVE_VERIFY_ATTEMPTS, readback[0], save_values[0]);
+            ret = ESP_ERR_INVALID_RESPONSE;
+        }
+        if (ret == ESP_OK || modbus_slave_breaker_get_state(MODBUS_DEFAULT_SLAVE_ID) == MODBUS_BREAKER_OPEN) {
+            break;
         }
     }
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Ohjelmat %u/%u/%u tallennettu (%d rekisteriä)",
+                 save_values[0], save_values[1], save_values[2], SAVE_WORDS);
+        set_save_status(SAVE_OK, ESP_OK);
+    } else {
+        set_save_status(SAVE_VERIFY_FAILED, ret);
+    }
+    vTaskDelete(NULL);
+}
+
+static void show_save_status(void) {
+    save_status_t status;
+    taskENTER_CRITICAL(&save_lock);
+    status = save_status;
+    taskEXIT_CRITICAL(&save_lock);
+
+    switch (status.state) {
+        case SAVE_RUNNING:
+            lv_label_set_text(status_label, "Tallennetaan...");
+            break;
+        case SAVE_OK:
+#ifdef CONFIG_FORTEST_MULTI_PROGRAM
+            lv_label_set_text(status_label, "Ohjelmat tallennettu ja varmistettu");
+#else
+            lv_label_set_text(status_label, "Ohjelma 1 tallennettu ja varmistettu");
+#endif
+            break;
+        case SAVE_VERIFY_FAILED:
+            lv_label_set_text_fmt(status_label, "Tallennusta ei voitu varmistaa (%s), tallenna uudelleen!",
+                                  esp_err_to_name(status.error));
+            break;
+        case SAVE_FAILED:
+            lv_label_set_text_fmt(status_label, "Virhe ohjelmien tallennuksessa: %s", esp_err_to_name(status.error));
+            break;
+        default:
+            break;
+    }
+}
+
+static void save_status_msg_cb(lv_event_t* e) {
+    show_save_status();
 }
 
 /**
@@ -427,23 +482,40 @@ static void save_button_event_cb(lv_event_t* e) {
     uint32_t code = lv_event_get_code(e);
     if (code != LV_EVENT_CLICKED) return;
     
+    app_programs_t programs;
+    app_state_get_programs(&programs);
     ESP_LOGI(TAG, "Tallennetaan ohjelmavalinnat: P1=%d, P2=%d, P3=%d, P2_käytössä=%d, P3_käytössä=%d", 
-        program_selection.program1, 
-        program_selection.program2, 
-        program_selection.program3,
-        program_selection.program2_enabled,
-        program_selection.program3_enabled);
-    
-    // Lähetetään Modbus-komento ohjelman 1 valitsemiseksi (osoite 0x0060 dokumentaatiosta)
-    // TÄRKEÄÄ: ÄLÄ vähennä 1 ohjelmanumerosta - ForTest odottaa todellista ohjelmanumeroa
-    esp_err_t ret = modbus_write_single_register(MODBUS_DEFAULT_SLAVE_ID, 0x0060, program_selection.program1);
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "Ohjelma %d valittu onnistuneesti", program_selection.program1);
-        lv_label_set_text(status_label, "Ohjelma valittu onnistuneesti");
-    } else {
-        ESP_LOGE(TAG, "Virhe ohjelman valinnassa: %d", ret);
-        lv_label_set_text(status_label, "Virhe ohjelman valinnassa!");
+        programs.program[0], 
+        programs.program[1], 
+        programs.program[2],
+        programs.enabled[1],
+        programs.enabled[2]);
+    
+    taskENTER_CRITICAL(&save_lock);
+    bool running = (save_status.state == SAVE_RUNNING);
+    taskEXIT_CRITICAL(&save_lock);
+    if (running) {
+        return;
     }
+
+    // TÄRKEÄÄ: ÄLÄ vähennä 1 ohjelmanumerosta - ForTest odottaa todellista ohjelmanumeroa.
+    // Käyttöliput kirjoitetaan omiin rekistereihinsä, ohjelma 1 on aina käytössä.
+    for (int i = 0; i < FORTEST_PROGRAM_SLOTS; i++) {
+        save_values[i] = programs.program[i];
+    }
+    save_values[FORTEST_PROGRAM_ENABLE2_ADDR - FORTEST_PROGRAM_SELECT_ADDR] = programs.enabled[1];
+    save_values[FORTEST_PROGRAM_ENABLE3_ADDR - FORTEST_PROGRAM_SELECT_ADDR] = programs.enabled[2];
+#ifndef CONFIG_FORTEST_MULTI_PROGRAM
+    if (programs.enabled[1] || programs.enabled[2]) {
+        ESP_LOGW(TAG, "Ohjelmia 2-3 ei kirjoiteta, CONFIG_FORTEST_MULTI_PROGRAM ei ole päällä");
+    }
+#endif
+
+    set_save_status(SAVE_RUNNING, ESP_OK);
+    if (xTaskCreate(save_task, "program_save", 3072, NULL, 2, NULL) != pdPASS) {
+        set_save_status(SAVE_FAILED, ESP_ERR_NO_MEM);
+    }
+    show_save_status();
 }
 
 /**
@@ -455,6 +527,8 @@ void program_content_create(lv_obj_t *parent) {
     lv_label_set_text(header, "TESTAUSOHJELMAT");
     lv_obj_align(header, LV_ALIGN_TOP_MID, 0, 20);
     lv_obj_set_style_text_font(header, &lv_font_montserrat_20, 0);
+    lv_msg_subscribe_obj(APP_EVENT_STATE_CHANGED, header, NULL);
+    lv_obj_add_event_cb(header, state_changed_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
     
     // Päivitysnappi vasempaan yläkulmaan
     lv_obj_t* update_btn = lv_btn_create(parent);
@@ -487,15 +561,14 @@ void program_content_create(lv_obj_t *parent) {
     lv_obj_set_pos(panel1, start_x, start_y);
     lv_obj_set_style_bg_color(panel1, lv_color_hex(0xf0f0f0), 0);
     
-    program1_name_label = lv_label_create(panel1);
-    lv_label_set_text(program1_name_label, program_selection.program1_name);
-    lv_obj_align(program1_name_label, LV_ALIGN_TOP_MID, 0, 50);
-    lv_obj_set_style_text_font(program1_name_label, &lv_font_montserrat_16, 0);
+    name_labels[0] = lv_label_create(panel1);
+    lv_obj_align(name_labels[0], LV_ALIGN_TOP_MID, 0, 50);
+    lv_obj_set_style_text_font(name_labels[0], &lv_font_montserrat_16, 0);
     
-    program1_label = lv_label_create(panel1);
-    lv_label_set_text(program1_label, "Ohjelma 1");
-    lv_obj_set_style_text_font(program1_label, &lv_font_montserrat_20, 0);
-    lv_obj_align(program1_label, LV_ALIGN_TOP_MID, 0, 0);
+    program_labels[0] = lv_label_create(panel1);
+    lv_label_set_text(program_labels[0], "Ohjelma 1");
+    lv_obj_set_style_text_font(program_labels[0], &lv_font_montserrat_20, 0);
+    lv_obj_align(program_labels[0], LV_ALIGN_TOP_MID, 0, 0);
     
     lv_obj_t* select_btn1 = lv_btn_create(panel1);
     lv_obj_set_size(select_btn1, 150, 40);
@@ -513,27 +586,20 @@ void program_content_create(lv_obj_t *parent) {
     lv_obj_set_pos(panel2, start_x + panel_width + panel_spacing, start_y);
     lv_obj_set_style_bg_color(panel2, lv_color_hex(0xf0f0f0), 0);
     
-    program2_name_label = lv_label_create(panel2);
-    lv_label_set_text(program2_name_label, program_selection.program2_name);
-    lv_obj_align(program2_name_label, LV_ALIGN_TOP_MID, 0, 50);
-    lv_obj_set_style_text_font(program2_name_label, &lv_font_montserrat_16, 0);
-    
-    program2_label = lv_label_create(panel2);
-    lv_label_set_text(program2_label, "Ohjelma 2");
-    lv_obj_set_style_text_font(program2_label, &lv_font_montserrat_20, 0);
-    lv_obj_align(program2_label, LV_ALIGN_TOP_MID, 0, 0);
-    
-    program2_checkbox = lv_checkbox_create(panel2);
-    lv_checkbox_set_text(program2_checkbox, "Käytössä");
-    lv_obj_set_style_text_font(program2_checkbox, &roboto_14, 0);
-    lv_obj_align(program2_checkbox, LV_ALIGN_TOP_MID, 0, 80);
-    if (program_selection.program2_enabled) {
-        lv_obj_add_state(program2_checkbox, LV_STATE_CHECKED);
-    } else {
-        lv_obj_add_state(program2_label, LV_STATE_DISABLED);
-        lv_obj_add_state(program2_name_label, LV_STATE_DISABLED);
-    }
-    lv_obj_add_event_cb(program2_checkbox, program_checkbox_event_cb, LV_EVENT_VALUE_CHANGED, (void*)2);
+    name_labels[1] = lv_label_create(panel2);
+    lv_obj_align(name_labels[1], LV_ALIGN_TOP_MID, 0, 50);
+    lv_obj_set_style_text_font(name_labels[1], &lv_font_montserrat_16, 0);
+    
+    program_labels[1] = lv_label_create(panel2);
+    lv_label_set_text(program_labels[1], "Ohjelma 2");
+    lv_obj_set_style_text_font(program_labels[1], &lv_font_montserrat_20, 0);
+    lv_obj_align(program_labels[1], LV_ALIGN_TOP_MID, 0, 0);
+    
+    checkboxes[1] = lv_checkbox_create(panel2);
+    lv_checkbox_set_text(checkboxes[1], "Käytössä");
+    lv_obj_set_style_text_font(checkboxes[1], &roboto_14, 0);
+    lv_obj_align(checkboxes[1], LV_ALIGN_TOP_MID, 0, 80);
+    lv_obj_add_event_cb(checkboxes[1], program_checkbox_event_cb, LV_EVENT_VALUE_CHANGED, (void*)2);
     
     lv_obj_t* select_btn2 = lv_btn_create(panel2);
     lv_obj_set_size(select_btn2, 150, 40);
@@ -551,27 +617,20 @@ void program_content_create(lv_obj_t *parent) {
     lv_obj_set_pos(panel3, start_x + 2 * (panel_width + panel_spacing), start_y);
     lv_obj_set_style_bg_color(panel3, lv_color_hex(0xf0f0f0), 0);
     
-    program3_name_label = lv_label_create(panel3);
-    lv_label_set_text(program3_name_label, program_selection.program3_name);
-    lv_obj_align(program3_name_label, LV_ALIGN_TOP_MID, 0, 50);
-    lv_obj_set_style_text_font(program3_name_label, &lv_font_montserrat_16, 0);
-    
-    program3_label = lv_label_create(panel3);
-    lv_label_set_text(program3_label, "Ohjelma 3");
-    lv_obj_set_style_text_font(program3_label, &lv_font_montserrat_20, 0);
-    lv_obj_align(program3_label, LV_ALIGN_TOP_MID, 0, 0);
-    
-    program3_checkbox = lv_checkbox_create(panel3);
-    lv_checkbox_set_text(program3_checkbox, "Käytössä");
-    lv_obj_set_style_text_font(program3_checkbox, &roboto_14, 0);
-    lv_obj_align(program3_checkbox, LV_ALIGN_TOP_MID, 0, 80);
-    if (program_selection.program3_enabled) {
-        lv_obj_add_state(program3_checkbox, LV_STATE_CHECKED);
-    } else {
-        lv_obj_add_state(program3_label, LV_STATE_DISABLED);
-        lv_obj_add_state(program3_name_label, LV_STATE_DISABLED);
-    }
-    lv_obj_add_event_cb(program3_checkbox, program_checkbox_event_cb, LV_EVENT_VALUE_CHANGED, (void*)3);
+    name_labels[2] = lv_label_create(panel3);
+    lv_obj_align(name_labels[2], LV_ALIGN_TOP_MID, 0, 50);
+    lv_obj_set_style_text_font(name_labels[2], &lv_font_montserrat_16, 0);
+    
+    program_labels[2] = lv_label_create(panel3);
+    lv_label_set_text(program_labels[2], "Ohjelma 3");
+    lv_obj_set_style_text_font(program_labels[2], &lv_font_montserrat_20, 0);
+    lv_obj_align(program_labels[2], LV_ALIGN_TOP_MID, 0, 0);
+    
+    checkboxes[2] = lv_checkbox_create(panel3);
+    lv_checkbox_set_text(checkboxes[2], "Käytössä");
+    lv_obj_set_style_text_font(checkboxes[2], &roboto_14, 0);
+    lv_obj_align(checkboxes[2], LV_ALIGN_TOP_MID, 0, 80);
+    lv_obj_add_event_cb(checkboxes[2], program_checkbox_event_cb, LV_EVENT_VALUE_CHANGED, (void*)3);
     
     lv_obj_t* select_btn3 = lv_btn_create(panel3);
     lv_obj_set_size(select_btn3, 150, 40);
@@ -598,23 +657,19 @@ void program_content_create(lv_obj_t *parent) {
     // Tilatieto
     status_label = lv_label_create(parent);
     lv_label_set_text(status_label, "");
+    lv_msg_subscribe_obj(APP_EVENT_PROGRAM_SAVE, status_label, NULL);
+    lv_obj_add_event_cb(status_label, save_status_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
     lv_obj_align(status_label, LV_ALIGN_BOTTOM_MID, 0, -40);
-}
-
-bool program_content_update(void) {
-    is_screen_active = screen_manager_is_screen_active(SCREEN_PROGRAM);
-    return is_screen_active;
+    
+    render_state(true);
 }
 
 void program_content_deinit(void) {
-    program1_label = NULL;
-    program2_label = NULL;
-    program3_label = NULL;
-    program1_name_label = NULL;
-    program2_name_label = NULL;
-    program3_name_label = NULL;
-    program2_checkbox = NULL;
-    program3_checkbox = NULL;
+    for (int i = 0; i < FORTEST_PROGRAM_SLOTS; i++) {
+        program_labels[i] = NULL;
+        name_labels[i] = NULL;
+        checkboxes[i] = NULL;
+    }
     status_label = NULL;
     update_spinner = NULL;
     
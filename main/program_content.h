@@ -10,14 +10,6 @@
  */
 void program_content_create(lv_obj_t *parent);
 
-/**
- * @brief Update program selection screen content (called from screen_manager)
- * 
- * @return true if screen is active
- * @return false if screen is not active
- */
-bool program_content_update(void);
-
 /**
  * @brief Clean up program selection screen resources
  */
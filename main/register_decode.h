@@ -0,0 +1,51 @@
+/**
+ * Register Decode Header
+ *
+ * Modbus-vastausten rekisterilohkojen muunnos tyypitetyiksi taulukoiksi.
+ * Lohko on vastauksen data-osa sellaisenaan (big-endian rekisterit, ei
+ * tasausvaatimusta), joten sen voi antaa suoraan vastauspuskurista.
+ */
+
+#ifndef REGISTER_DECODE_H
+#define REGISTER_DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "register_map.h"
+
+/**
+ * @brief 32-bittisten arvojen rekisterijärjestys
+ */
+typedef enum {
+    WORD_ORDER_HIGH_FIRST = 0,      // ABCD: ylempi rekisteri ensin (Modbus-oletus)
+    WORD_ORDER_LOW_FIRST,           // CDAB: alempi rekisteri ensin (mm. monet PLC:t)
+} word_order_t;
+
+/**
+ * @brief Muuntaa count rekisteriä 16-bittisiksi arvoiksi
+ */
+void register_decode_u16(const uint8_t *src, uint16_t *dst, size_t count);
+void register_decode_i16(const uint8_t *src, int16_t *dst, size_t count);
+
+/**
+ * @brief Muuntaa count kahden rekisterin arvoa 32-bittisiksi
+ *
+ * @param src Rekisterilohko (2 * count rekisteriä)
+ * @param order Laitteen rekisterijärjestys
+ */
+void register_decode_u32(const uint8_t *src, uint32_t *dst, size_t count, word_order_t order);
+void register_decode_i32(const uint8_t *src, int32_t *dst, size_t count, word_order_t order);
+void register_decode_f32(const uint8_t *src, float *dst, size_t count, word_order_t order);
+
+/**
+ * @brief Muuntaa count arvoa kuvaimen tyypin ja skaalauksen mukaan
+ *
+ * Arvot ovat peräkkäin desc->words rekisterin välein. Merkkijonoja ja
+ * keloja ei muunneta.
+ *
+ * @return size_t Muunnettujen arvojen määrä
+ */
+size_t register_decode_scaled(const uint8_t *src, const register_desc_t *desc, word_order_t order,
+                              float *dst, size_t count);
+
+#endif /* REGISTER_DECODE_H */
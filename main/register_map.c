@@ -0,0 +1,15 @@
+/**
+ * Register Map
+ *
+ * Kuvaintaulukot generoidaan register_map.h:n X-makrolistoista.
+ */
+
+#include "register_map.h"
+
+const register_desc_t fortest_register_map[FORTEST_REGISTER_COUNT] = {
+    FORTEST_REGISTER_MAP(REG_X_DESC)
+};
+
+const register_desc_t opta_register_map[OPTA_REGISTER_COUNT] = {
+    OPTA_REGISTER_MAP(REG_X_DESC)
+};
@@ -0,0 +1,154 @@
+/**
+ * Register Map Header
+ *
+ * Laitekohtaiset Modbus-rekisterikartat. Jokainen rekisteri määritellään
+ * vain kerran X-makrolistassa, josta generoidaan käännösaikana:
+ *
+ *   <NIMI>_ADDR   rekisterin osoite
+ *   <NIMI>_WORDS  arvon pituus rekistereinä
+ *   <NIMI>_IDX    indeksi laitteen kuvaintaulukkoon (esim. fortest_register_map[])
+ *
+ * Käyttö: modbus_write_single_register(slave, FORTEST_PROGRAM_SELECT_ADDR, value)
+ * tai REG_DESC(fortest, FORTEST_PROGRAM_SELECT)->scale. Kaikki arvot ovat
+ * vakioita, joten ajonaikaista hakua ei tarvita.
+ */
+
+#ifndef REGISTER_MAP_H
+#define REGISTER_MAP_H
+
+#include <stdint.h>
+
+typedef enum {
+    REG_TYPE_COIL = 0,              // Kela (FC 0x01 / 0x05)
+    REG_TYPE_U16,
+    REG_TYPE_I16,
+    REG_TYPE_U32,                   // Kaksi rekisteriä
+    REG_TYPE_I32,
+    REG_TYPE_F32,
+    REG_TYPE_STRING,                // ASCII, kaksi merkkiä rekisterissä
+} register_type_t;
+
+typedef enum {
+    REG_ACCESS_RO = 0x01,
+    REG_ACCESS_WO = 0x02,
+    REG_ACCESS_RW = REG_ACCESS_RO | REG_ACCESS_WO,
+} register_access_t;
+
+// Kuinka usein rekisteri luetaan laitteelta
+typedef enum {
+    REG_POLL_NONE = 0,              // Vain kirjoitus tai luku pyydettäessä
+    REG_POLL_ONCE,                  // Kerran yhteyden muodostuessa
+    REG_POLL_SLOW,                  // Hidas kierto (asetukset, tilat)
+    REG_POLL_FAST,                  // Nopea kierto (mittaukset testin aikana)
+} register_poll_t;
+
+/**
+ * @brief Yhden rekisterin kuvain
+ *
+ * Skaalattu arvo = raaka-arvo / scale.
+ */
+typedef struct {
+    const char *name;
+    uint16_t address;
+    uint16_t words;
+    uint16_t scale;
+    uint8_t  type;                  // register_type_t
+    uint8_t  access;                // register_access_t
+    uint8_t  poll;                  // register_poll_t
+} register_desc_t;
+
+/*
+ * X(nimi, osoite, rekisterit, tyyppi, skaala, pääsy, pollausluokka)
+ *
+ * Rivit osoitejärjestyksessä, jolloin peräkkäiset luettavat rekisterit
+ * voidaan yhdistää yhdeksi pyynnöksi taulukkoa läpikäymällä.
+ */
+
+// ForTest T8090 (manuaalin osoitteet)
+#define FORTEST_REGISTER_MAP(X) \
+    X(FORTEST_START_TEST,       0x000A, 1, COIL,   1, WO, NONE)   /* 0xFF00 käynnistää testin */ \
+    X(FORTEST_PROGRAM_SELECT,   0x0060, 1, U16,    1, RW, NONE)   /* Valittu ohjelma (1-30) */ \
+    X(FORTEST_PROGRAM_SELECT2,  0x0061, 1, U16,    1, RW, NONE)   /* Ei varmistettu: toinen ohjelma */ \
+    X(FORTEST_PROGRAM_SELECT3,  0x0062, 1, U16,    1, RW, NONE)   /* Ei varmistettu: kolmas ohjelma */ \
+    X(FORTEST_PROGRAM_ENABLE2,  0x0063, 1, U16,    1, RW, NONE)   /* Ei varmistettu: 1 = toinen ohjelma käytössä */ \
+    X(FORTEST_PROGRAM_ENABLE3,  0x0064, 1, U16,    1, RW, NONE)   /* Ei varmistettu: 1 = kolmas ohjelma käytössä */ \
+    X(FORTEST_TEST_STATE,       0x0100, 1, U16,    1, RO, FAST)   /* Ei varmistettu: 0 = valmis, 1 = testi käynnissä */ \
+    X(FORTEST_TEST_RESULT,      0x0101, 1, U16,    1, RO, FAST)   /* Ei varmistettu: 1 = hyväksytty, 2 = hylätty */ \
+    X(FORTEST_TEST_PRESSURE,    0x0102, 2, I32,    1, RO, FAST)   /* Ei varmistettu: paine, Pa */ \
+    X(FORTEST_LEAK_VALUE,       0x0104, 2, I32,    1, RO, FAST)   /* Ei varmistettu: vuotoarvo */ \
+    X(FORTEST_PROGRAM_NAME,     0xEA74, 8, STRING, 1, RO, ONCE)   /* Ohjelman n nimi: osoite + n */
+
+// Arduino Opta (PLC-ohjelman osoitteet)
+#define OPTA_REGISTER_MAP(X) \
+    X(OPTA_SERIAL_BAUD,         18000, 1, U16,    1, RW, NONE)   /* Nopeus / 100, vaihtuu vastauksen jälkeen */ \
+    X(OPTA_RELAY1,              18099, 1, U16,    1, RW, NONE) \
+    X(OPTA_RELAY2,              18100, 1, U16,    1, RW, NONE) \
+    X(OPTA_RELAY3,              18101, 1, U16,    1, RW, NONE) \
+    X(OPTA_RELAY4,              18102, 1, U16,    1, RW, NONE) \
+    X(OPTA_RELAY5,              18103, 1, U16,    1, RW, NONE) \
+    X(OPTA_RELAY6,              18104, 1, U16,    1, RW, NONE) \
+    X(OPTA_RELAY7,              18105, 1, U16,    1, RW, NONE) \
+    X(OPTA_RELAY8,              18106, 1, U16,    1, RW, NONE) \
+    X(OPTA_TEST_BUTTON,         19000, 1, U16,    1, WO, NONE)   /* 1 = painettu, 0 = vapautettu */ \
+    X(OPTA_RUN_BUTTON,          19099, 1, U16,    1, WO, NONE) \
+    X(OPTA_STOP_BUTTON,         19101, 1, U16,    1, WO, NONE)
+
+/* ---------------------------------------------------------------------------
+ * Generoidut vakiot
+ * ------------------------------------------------------------------------- */
+
+#define REG_X_CONST(id, addr, nwords, rtype, rscale, raccess, rpoll) \
+    id##_ADDR = (addr), \
+    id##_WORDS = (nwords),
+
+#define REG_X_INDEX(id, addr, nwords, rtype, rscale, raccess, rpoll) \
+    id##_IDX,
+
+#define REG_X_DESC(id, addr, nwords, rtype, rscale, raccess, rpoll) \
+    [id##_IDX] = { \
+        .name = #id, \
+        .address = (addr), \
+        .words = (nwords), \
+        .scale = (rscale), \
+        .type = REG_TYPE_##rtype, \
+        .access = REG_ACCESS_##raccess, \
+        .poll = REG_POLL_##rpoll, \
+    },
+
+enum { FORTEST_REGISTER_MAP(REG_X_CONST) };
+enum { OPTA_REGISTER_MAP(REG_X_CONST) };
+
+typedef enum { FORTEST_REGISTER_MAP(REG_X_INDEX) FORTEST_REGISTER_COUNT } fortest_register_t;
+typedef enum { OPTA_REGISTER_MAP(REG_X_INDEX) OPTA_REGISTER_COUNT } opta_register_t;
+
+extern const register_desc_t fortest_register_map[FORTEST_REGISTER_COUNT];
+extern const register_desc_t opta_register_map[OPTA_REGISTER_COUNT];
+
+// Rekisterin kuvain laitteen taulukosta, esim. REG_DESC(opta, OPTA_RELAY1)
+#define REG_DESC(device, name)      (&device##_register_map[name##_IDX])
+
+// Ohjelmavalinnat ja ohjelmien 2-3 käyttöliput kirjoitetaan yhdellä FC 0x10 -pyynnöllä.
+// Vain FORTEST_PROGRAM_SELECT on manuaalista, muut kirjoitetaan vasta kun
+// CONFIG_FORTEST_MULTI_PROGRAM on päällä (osoitteet tarkistettu laitteelta).
+#define FORTEST_PROGRAM_SLOTS       (3)
+#define FORTEST_PROGRAM_COUNT       (30)    // Ohjelmat 1-30
+#define FORTEST_PROGRAM_BLOCK_WORDS (FORTEST_PROGRAM_ENABLE3_ADDR + 1 - FORTEST_PROGRAM_SELECT_ADDR)
+_Static_assert(FORTEST_PROGRAM_SELECT3_ADDR == FORTEST_PROGRAM_SELECT_ADDR + FORTEST_PROGRAM_SLOTS - 1 &&
+               FORTEST_PROGRAM_ENABLE2_ADDR == FORTEST_PROGRAM_SELECT3_ADDR + 1 &&
+               FORTEST_PROGRAM_BLOCK_WORDS == 2 * FORTEST_PROGRAM_SLOTS - 1,
+               "ForTest-ohjelmavalintojen rekisterien pitää olla peräkkäin");
+
+// Testin tila luetaan yhdellä pyynnöllä. Tilarekisterien osoitteet ja arvot
+// eivät ole ForTest-manuaalista, ne on tarkistettava laitteelta ennen käyttöä.
+#define FORTEST_TEST_BLOCK_WORDS    (FORTEST_LEAK_VALUE_ADDR + FORTEST_LEAK_VALUE_WORDS - FORTEST_TEST_STATE_ADDR)
+#define FORTEST_TEST_STATE_RUNNING  (1)
+#define FORTEST_TEST_RESULT_PASS    (1)
+#define FORTEST_TEST_RESULT_FAIL    (2)
+_Static_assert(FORTEST_TEST_BLOCK_WORDS == 6, "ForTest-testin tilarekisterien pitää olla peräkkäin");
+
+// Releet ovat peräkkäisissä rekistereissä
+#define OPTA_RELAY_COUNT            (8)
+_Static_assert(OPTA_RELAY8_ADDR == OPTA_RELAY1_ADDR + OPTA_RELAY_COUNT - 1,
+               "Opta-releiden rekisterien pitää olla peräkkäin");
+
+#endif /* REGISTER_MAP_H */
@@ -0,0 +1,640 @@
+/**
+ * Result Log Functions
+ *
+ * Testitulokset tallennetaan omaan flash-osioonsa rengaslokiksi. Osio on
+ * jaettu 4 kt sektoreihin, joita kirjoitetaan järjestyksessä ja pyyhitään
+ * vasta kun kirjoitus kiertää takaisin niihin, joten kaikki sektorit
+ * kuluvat tasaisesti.
+ *
+ * Sektorin rakenne:
+ *   [sektoriotsake 16 B][tietue][tietue]...[0xFF...]
+ *
+ * Tietueen rakenne (4 tavun rajalle pyöristettynä):
+ *   [magic 2 B][pituus 2 B][seq 4 B][data pituus B][CRC32 4 B]
+ *
+ * Data on koodattu varint-muodossa ja painekäyrä tallennetaan
+ * ensimmäisenä näytteenä ja sen jälkeen eroina edellisestä näytteestä
+ * (delta + zigzag + varint),
+ * jolloin tasainen käyrä vie noin tavun näytettä kohden.
+ */
+
+#include "result_log.h"
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+#include "app_events.h"
+
+static const char *TAG = "RESULT_LOG";
+
+#define SECTOR_SIZE             (4096)
+#define SECTOR_MAGIC            (0x31474C52)    // "RLG1"
+#define RECORD_MAGIC            (0x5AA5)
+#define RECORD_ERASED           (0xFFFF)
+#define ALIGN4(x)               (((x) + 3) & ~3)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t seq;                               // Sektorin järjestysnumero
+    uint32_t crc;                               // CRC32 kentistä magic ja seq
+    uint32_t reserved;
+} sector_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint16_t len;                               // Datan pituus ilman otsaketta ja CRC:tä
+    uint32_t seq;                               // Tietueen järjestysnumero
+} record_hdr_t;
+
+#define SECTOR_HDR_SIZE         (sizeof(sector_hdr_t))
+#define RECORD_OVERHEAD         (sizeof(record_hdr_t) + sizeof(uint32_t))
+
+_Static_assert(ALIGN4(RESULT_LOG_RECORD_MAX) <= SECTOR_SIZE - SECTOR_HDR_SIZE,
+               "RESULT_LOG_CURVE_MAX liian suuri yhteen sektoriin");
+
+typedef struct {
+    uint32_t addr;                              // Tietueen osoite osion alusta
+    uint32_t seq;
+} index_entry_t;
+
+static const esp_partition_t *log_partition = NULL;
+static SemaphoreHandle_t log_mux = NULL;
+static QueueHandle_t log_queue = NULL;
+
+static uint32_t sector_count = 0;
+static uint32_t head_sector = 0;                // Sektori, johon kirjoitetaan
+static uint32_t head_offset = 0;                // Seuraavan tietueen offset sektorissa
+static uint32_t head_sector_seq = 0;
+static uint32_t next_seq = 1;
+
+// Viimeisimpien tietueiden osoitteet rengaspuskurissa
+static index_entry_t index_ring[RESULT_LOG_INDEX_SIZE];
+static size_t index_head = 0;                   // Seuraava kirjoituspaikka
+static size_t index_count = 0;
+
+// Lukupuskuri, suojattu log_mux:lla
+static uint8_t read_buf[ALIGN4(RESULT_LOG_RECORD_MAX)];
+
+/* ---------------------------------------------------------------------------
+ * Koodaus
+ * ------------------------------------------------------------------------- */
+
+static inline uint32_t zigzag_encode(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t zigzag_decode(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *out = v;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static size_t encode_entry(const result_log_entry_t *e, uint8_t *out)
+{
+    uint8_t *p = out;
+    p = put_varint(p, e->timestamp);
+    p = put_varint(p, e->program);
+    *p++ = e->outcome;
+    p = put_varint(p, zigzag_encode(e->test_pressure));
+    p = put_varint(p, zigzag_encode(e->leak_value));
+    p = put_varint(p, e->curve_interval_ms);
+
+    uint16_t len = e->curve_len > RESULT_LOG_CURVE_MAX ? RESULT_LOG_CURVE_MAX : e->curve_len;
+    p = put_varint(p, len);
+
+    // Käyrä erotuksina edellisestä näytteestä
+    uint32_t prev = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        uint32_t cur = (uint32_t)e->curve[i];
+        p = put_varint(p, zigzag_encode((int32_t)(cur - prev)));
+        prev = cur;
+    }
+    return p - out;
+}
+
+static bool decode_entry(const uint8_t *data, size_t size, result_log_entry_t *e)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = data + size;
+    uint32_t v;
+
+    if (!(p = get_varint(p, end, &v))) return false;
+    e->timestamp = v;
+    if (!(p = get_varint(p, end, &v))) return false;
+    e->program = (uint16_t)v;
+    if (p >= end) return false;
+    e->outcome = *p++;
+    if (!(p = get_varint(p, end, &v))) return false;
+    e->test_pressure = zigzag_decode(v);
+    if (!(p = get_varint(p, end, &v))) return false;
+    e->leak_value = zigzag_decode(v);
+    if (!(p = get_varint(p, end, &v))) return false;
+    e->curve_interval_ms = (uint16_t)v;
+    if (!(p = get_varint(p, end, &v)) || v > RESULT_LOG_CURVE_MAX) return false;
+    e->curve_len = (uint16_t)v;
+
+    uint32_t prev = 0;
+    for (uint16_t i = 0; i < e->curve_len; i++) {
+        if (!(p = get_varint(p, end, &v))) return false;
+        prev += (uint32_t)zigzag_decode(v);
+        e->curve[i] = (int32_t)prev;
+    }
+    return p == end;
+}
+
+/* ---------------------------------------------------------------------------
+ * Flash-käsittely
+ * ------------------------------------------------------------------------- */
+
+static inline uint32_t sector_addr(uint32_t sector)
+{
+    return sector * SECTOR_SIZE;
+}
+
+static bool read_sector_hdr(uint32_t sector, sector_hdr_t *hdr)
+{
+    if (esp_partition_read(log_partition, sector_addr(sector), hdr, sizeof(*hdr)) != ESP_OK) {
+        return false;
+    }
+    if (hdr->magic != SECTOR_MAGIC) {
+        return false;
+    }
+    return hdr->crc == esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(sector_hdr_t, crc));
+}
+
+/**
+ * @brief Lukee ja tarkistaa tietueen osoitteesta addr read_buf-puskuriin
+ *
+ * @return Tietueen koko flashissa, 0 jos sektorin loppu (pyyhitty alue),
+ *         -1 jos tietue on rikki
+ */
+static int read_record(uint32_t addr, uint32_t sector_end, record_hdr_t *hdr)
+{
+    if (addr + sizeof(record_hdr_t) > sector_end) {
+        return 0;
+    }
+    if (esp_partition_read(log_partition, addr, hdr, sizeof(*hdr)) != ESP_OK) {
+        return -1;
+    }
+    if (hdr->magic == RECORD_ERASED) {
+        return 0;
+    }
+    uint32_t total = ALIGN4(RECORD_OVERHEAD + hdr->len);
+    if (hdr->magic != RECORD_MAGIC || RECORD_OVERHEAD + hdr->len > sizeof(read_buf) || addr + total > sector_end) {
+        return -1;
+    }
+
+    uint8_t *buf = read_buf;
+    if (esp_partition_read(log_partition, addr, buf, RECORD_OVERHEAD + hdr->len) != ESP_OK) {
+        return -1;
+    }
+    uint32_t stored_crc;
+    memcpy(&stored_crc, buf + sizeof(record_hdr_t) + hdr->len, sizeof(stored_crc));
+    if (stored_crc != esp_rom_crc32_le(0, buf, sizeof(record_hdr_t) + hdr->len)) {
+        return -1;
+    }
+    return (int)total;
+}
+
+static void index_push(uint32_t addr, uint32_t seq)
+{
+    index_ring[index_head].addr = addr;
+    index_ring[index_head].seq = seq;
+    index_head = (index_head + 1) % RESULT_LOG_INDEX_SIZE;
+    if (index_count < RESULT_LOG_INDEX_SIZE) {
+        index_count++;
+    }
+}
+
+// Poistaa indeksistä pyyhittävään sektoriin osoittavat (vanhimmat) tietueet
+static void index_drop_sector(uint32_t sector)
+{
+    while (index_count > 0) {
+        size_t oldest = (index_head + RESULT_LOG_INDEX_SIZE - index_count) % RESULT_LOG_INDEX_SIZE;
+        if (index_ring[oldest].addr / SECTOR_SIZE != sector) {
+            break;
+        }
+        index_count--;
+    }
+}
+
+static esp_err_t start_sector(uint32_t sector, uint32_t seq)
+{
+    esp_err_t ret = esp_partition_erase_range(log_partition, sector_addr(sector), SECTOR_SIZE);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    sector_hdr_t hdr = {
+        .magic = SECTOR_MAGIC,
+        .seq = seq,
+        .reserved = 0xFFFFFFFF,
+    };
+    hdr.crc = esp_rom_crc32_le(0, (const uint8_t *)&hdr, offsetof(sector_hdr_t, crc));
+    ret = esp_partition_write(log_partition, sector_addr(sector), &hdr, sizeof(hdr));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    head_sector = sector;
+    head_sector_seq = seq;
+    head_offset = SECTOR_HDR_SIZE;
+    return ESP_OK;
+}
+
+/**
+ * @brief Käy sektorin tietueet läpi ja lisää ne indeksiin
+ *
+ * @return Ensimmäisen vapaan tavun offset sektorissa, tai SECTOR_SIZE jos
+ *         sektorissa on rikkinäinen tietue (ei jatketa kirjoittamista siihen)
+ */
+static uint32_t scan_sector(uint32_t sector, bool add_to_index, size_t *records)
+{
+    uint32_t base = sector_addr(sector);
+    uint32_t offset = SECTOR_HDR_SIZE;
+    record_hdr_t hdr;
+
+    while (true) {
+        int size = read_record(base + offset, base + SECTOR_SIZE, &hdr);
+        if (size == 0) {
+            return offset;
+        }
+        if (size < 0) {
+            ESP_LOGW(TAG, "Rikkinäinen tietue sektorissa %lu offset %lu", sector, offset);
+            return SECTOR_SIZE;
+        }
+        if (add_to_index) {
+            index_push(base + offset, hdr.seq);
+        }
+        if (records) {
+            (*records)++;
+        }
+        if (hdr.seq >= next_seq) {
+            next_seq = hdr.seq + 1;
+        }
+        offset += size;
+    }
+}
+
+static esp_err_t mount(void)
+{
+    sector_hdr_t hdr;
+    bool found = false;
+
+    // Uusin sektori on se, jolla on suurin järjestysnumero
+    for (uint32_t s = 0; s < sector_count; s++) {
+        if (read_sector_hdr(s, &hdr) && (!found || hdr.seq > head_sector_seq)) {
+            head_sector = s;
+            head_sector_seq = hdr.seq;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(TAG, "Tyhjä loki, alustetaan");
+        return start_sector(0, 1);
+    }
+
+    // Kerää taaksepäin niin monta peräkkäistä sektoria, että indeksi täyttyy
+    uint32_t first = head_sector;
+    size_t records = 0;
+    for (uint32_t n = 1; n < sector_count; n++) {
+        uint32_t prev = (first + sector_count - 1) % sector_count;
+        if (!read_sector_hdr(prev, &hdr) || hdr.seq != head_sector_seq - n) {
+            break;
+        }
+        scan_sector(prev, false, &records);
+        first = prev;
+        if (records >= RESULT_LOG_INDEX_SIZE) {
+            break;
+        }
+    }
+
+    // Rakenna indeksi vanhimmasta uusimpaan
+    for (uint32_t s = first; s != head_sector; s = (s + 1) % sector_count) {
+        scan_sector(s, true, NULL);
+    }
+    head_offset = scan_sector(head_sector, true, NULL);
+
+    ESP_LOGI(TAG, "Loki avattu: sektori %lu/%lu, offset %lu, seuraava seq %lu",
+             head_sector, sector_count, head_offset, next_seq);
+    return ESP_OK;
+}
+
+static esp_err_t write_record(const result_log_entry_t *entry, uint8_t *buf)
+{
+    record_hdr_t hdr = {
+        .magic = RECORD_MAGIC,
+    };
+    size_t len = encode_entry(entry, buf + sizeof(record_hdr_t));
+    uint32_t total = ALIGN4(RECORD_OVERHEAD + len);
+
+    xSemaphoreTake(log_mux, portMAX_DELAY);
+
+    // Siirry seuraavaan sektoriin, jos tietue ei mahdu
+    esp_err_t ret = ESP_OK;
+    if (head_offset + total > SECTOR_SIZE) {
+        uint32_t sector = (head_sector + 1) % sector_count;
+        index_drop_sector(sector);
+        ret = start_sector(sector, head_sector_seq + 1);
+    }
+
+    if (ret == ESP_OK) {
+        hdr.len = (uint16_t)len;
+        hdr.seq = next_seq;
+        memcpy(buf, &hdr, sizeof(hdr));
+        uint32_t crc = esp_rom_crc32_le(0, buf, sizeof(hdr) + len);
+        memcpy(buf + sizeof(hdr) + len, &crc, sizeof(crc));
+        memset(buf + RECORD_OVERHEAD + len, 0xFF, total - RECORD_OVERHEAD - len);
+
+        uint32_t addr = sector_addr(head_sector) + head_offset;
+        ret = esp_partition_write(log_partition, addr, buf, total);
+        if (ret == ESP_OK) {
+            index_push(addr, next_seq);
+            next_seq++;
+            head_offset += total;
+        } else {
+            // Osittain kirjoitettua sektoria ei jatketa
+            head_offset = SECTOR_SIZE;
+        }
+    }
+
+    xSemaphoreGive(log_mux);
+    return ret;
+}
+
+static void result_log_task(void *arg)
+{
+    static result_log_entry_t entry;
+    static uint8_t record_buf[ALIGN4(RESULT_LOG_RECORD_MAX)];
+
+    while (1) {
+        if (xQueueReceive(log_queue, &entry, portMAX_DELAY) == pdTRUE) {
+            esp_err_t ret = write_record(&entry, record_buf);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Tuloksen tallennus epäonnistui: %s", esp_err_to_name(ret));
+            } else {
+                app_events_post(APP_EVENT_RESULT_LOGGED);
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Julkiset funktiot
+ * ------------------------------------------------------------------------- */
+
+esp_err_t result_log_init(void)
+{
+    log_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                             RESULT_LOG_PARTITION_LABEL);
+    if (log_partition == NULL) {
+        ESP_LOGE(TAG, "Osiota '%s' ei löydy", RESULT_LOG_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+    sector_count = log_partition->size / SECTOR_SIZE;
+    if (sector_count < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    log_mux = xSemaphoreCreateMutex();
+    if (log_mux == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = mount();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Jonon alkiot ovat isoja (käyrä mukana), joten ne pidetään PSRAMissa
+    log_queue = xQueueCreateWithCaps(CONFIG_RESULT_LOG_QUEUE_LEN, sizeof(result_log_entry_t), MALLOC_CAP_SPIRAM);
+    if (log_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreatePinnedToCore(result_log_task, "result_log", 3072, NULL, 1, NULL, 0) != pdPASS) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t result_log_append(const result_log_entry_t *entry)
+{
+    if (entry == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (log_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xQueueSend(log_queue, entry, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Kirjoitusjono täynnä, tulos hylätty");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void result_log_set_curve(result_log_entry_t *entry, const int32_t *samples, size_t count, uint16_t interval_ms)
+{
+    if (count <= RESULT_LOG_CURVE_MAX) {
+        memcpy(entry->curve, samples, count * sizeof(int32_t));
+        entry->curve_len = (uint16_t)count;
+        entry->curve_interval_ms = interval_ms;
+        return;
+    }
+
+    // Keskiarvoistetaan kokonaislukukertoimella, jotta näyteväli pysyy tasaisena
+    size_t factor = (count + RESULT_LOG_CURVE_MAX - 1) / RESULT_LOG_CURVE_MAX;
+    size_t out = 0;
+    for (size_t i = 0; i < count; i += factor) {
+        size_t n = (count - i < factor) ? count - i : factor;
+        int64_t sum = 0;
+        for (size_t j = 0; j < n; j++) {
+            sum += samples[i + j];
+        }
+        entry->curve[out++] = (int32_t)(sum / (int64_t)n);
+    }
+    entry->curve_len = (uint16_t)out;
+    entry->curve_interval_ms = (uint16_t)(interval_ms * factor);
+}
+
+size_t result_log_count(void)
+{
+    return index_count;
+}
+
+uint32_t result_log_last_seq(void)
+{
+    return next_seq - 1;
+}
+
+esp_err_t result_log_get_recent(size_t n_back, result_log_entry_t *entry)
+{
+    if (log_mux == NULL || entry == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(log_mux, portMAX_DELAY);
+    if (n_back < index_count) {
+        size_t i = (index_head + RESULT_LOG_INDEX_SIZE - 1 - n_back) % RESULT_LOG_INDEX_SIZE;
+        uint32_t addr = index_ring[i].addr;
+        uint32_t sector_end = (addr / SECTOR_SIZE + 1) * SECTOR_SIZE;
+        record_hdr_t hdr;
+        if (read_record(addr, sector_end, &hdr) > 0 &&
+            decode_entry(read_buf + sizeof(record_hdr_t), hdr.len, entry)) {
+            entry->seq = hdr.seq;
+            ret = ESP_OK;
+        } else {
+            ret = ESP_ERR_INVALID_CRC;
+        }
+    }
+    xSemaphoreGive(log_mux);
+    return ret;
+}
+
+void result_log_iter_begin(result_log_iter_t *it)
+{
+    if (log_mux == NULL) {
+        it->sectors_left = 0;
+        return;
+    }
+    xSemaphoreTake(log_mux, portMAX_DELAY);
+    it->sector = (head_sector + 1) % sector_count;
+    it->offset = SECTOR_HDR_SIZE;
+    it->sectors_left = sector_count;
+    xSemaphoreGive(log_mux);
+}
+
+/**
+ * @brief Etsii iteraattorin kohdalta seuraavan ehjän tietueen read_buf-puskuriin
+ *
+ * Iteraattoria ei siirretä tietueen ohi, vaan kutsuja lisää palautetun
+ * koon offsetiin. Kutsuttava log_mux varattuna.
+ *
+ * @return Tietueen koko flashissa, 0 kun loki on käyty läpi
+ */
+static int iter_peek(result_log_iter_t *it, record_hdr_t *hdr)
+{
+    sector_hdr_t shdr;
+
+    while (it->sectors_left > 0) {
+        int size = 0;
+        if (it->offset != SECTOR_HDR_SIZE || read_sector_hdr(it->sector, &shdr)) {
+            uint32_t base = sector_addr(it->sector);
+            size = read_record(base + it->offset, base + SECTOR_SIZE, hdr);
+        }
+        if (size > 0) {
+            return size;
+        }
+        // Sektori käyty läpi (tai tyhjä/rikki), siirry seuraavaan
+        it->sector = (it->sector + 1) % sector_count;
+        it->offset = SECTOR_HDR_SIZE;
+        it->sectors_left--;
+    }
+    return 0;
+}
+
+esp_err_t result_log_iter_next(result_log_iter_t *it, result_log_entry_t *entry)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    record_hdr_t hdr;
+    int size;
+
+    xSemaphoreTake(log_mux, portMAX_DELAY);
+    while ((size = iter_peek(it, &hdr)) > 0) {
+        it->offset += size;
+        if (decode_entry(read_buf + sizeof(record_hdr_t), hdr.len, entry)) {
+            entry->seq = hdr.seq;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    xSemaphoreGive(log_mux);
+    return ret;
+}
+
+void result_log_iter_seek(result_log_iter_t *it, uint32_t seq)
+{
+    record_hdr_t hdr;
+    int size;
+
+    result_log_iter_begin(it);
+    if (it->sectors_left == 0) {
+        return;
+    }
+
+    xSemaphoreTake(log_mux, portMAX_DELAY);
+    while ((size = iter_peek(it, &hdr)) > 0 && hdr.seq < seq) {
+        it->offset += size;
+    }
+    xSemaphoreGive(log_mux);
+}
+
+int result_log_iter_next_raw(result_log_iter_t *it, uint8_t *buf, size_t size, uint32_t *seq)
+{
+    record_hdr_t hdr;
+    int ret = 0;
+
+    xSemaphoreTake(log_mux, portMAX_DELAY);
+    int rec_size = iter_peek(it, &hdr);
+    if (rec_size > 0) {
+        size_t len = RECORD_OVERHEAD + hdr.len;
+        if (len <= size) {
+            memcpy(buf, read_buf, len);
+            it->offset += rec_size;
+            *seq = hdr.seq;
+            ret = (int)len;
+        } else {
+            ret = -1;
+        }
+    }
+    xSemaphoreGive(log_mux);
+    return ret;
+}
+
+int result_log_format_csv(const result_log_entry_t *entry, char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "%lu,%lu,%u,%u,%ld,%ld,%u,",
+                       entry->seq, entry->timestamp, entry->program, entry->outcome,
+                       entry->test_pressure, entry->leak_value, entry->curve_interval_ms);
+    for (uint16_t i = 0; i < entry->curve_len && len > 0 && (size_t)len < size; i++) {
+        len += snprintf(buf + len, size - len, i ? ";%ld" : "%ld", entry->curve[i]);
+    }
+    if (len > 0 && (size_t)len < size - 1) {
+        buf[len++] = '\n';
+        buf[len] = '\0';
+    }
+    return len;
+}
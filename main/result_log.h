@@ -0,0 +1,140 @@
+/**
+ * Result Log Header
+ *
+ * Testitulosten ja harvennettujen painekäyrien tallennus omaan
+ * flash-osioonsa (append-only rengasloki).
+ */
+
+#ifndef RESULT_LOG_H
+#define RESULT_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+// Osion nimi partitions.csv:ssä
+#define RESULT_LOG_PARTITION_LABEL   "resultlog"
+
+// Viimeisimpien tulosten RAM-indeksin koko
+#define RESULT_LOG_INDEX_SIZE        (CONFIG_RESULT_LOG_INDEX_SIZE)
+
+// Painekäyrän maksimipituus harvennuksen jälkeen
+#define RESULT_LOG_CURVE_MAX         (CONFIG_RESULT_LOG_CURVE_MAX)
+
+// Yhden koodatun tietueen maksimikoko (otsake + data + CRC)
+#define RESULT_LOG_RECORD_MAX        (48 + RESULT_LOG_CURVE_MAX * 5)
+
+typedef enum {
+    RESULT_LOG_OUTCOME_PASS = 0,
+    RESULT_LOG_OUTCOME_FAIL,
+    RESULT_LOG_OUTCOME_ABORTED,
+    RESULT_LOG_OUTCOME_ERROR,
+} result_log_outcome_t;
+
+/**
+ * @brief Yksi testitulos
+ *
+ * Painearvot ovat testerin raakayksiköissä (ForTest: Pa).
+ */
+typedef struct {
+    uint32_t seq;                   // Juokseva numero, lokin asettama
+    uint32_t timestamp;             // Sekunteja (time(NULL) tai käynnistyksestä)
+    uint16_t program;               // Testiohjelman numero
+    uint8_t  outcome;               // result_log_outcome_t
+    int32_t  test_pressure;         // Testipaine
+    int32_t  leak_value;            // Vuotoarvo
+    uint16_t curve_interval_ms;     // Käyrän näytteiden väli harvennuksen jälkeen
+    uint16_t curve_len;             // Käyrän näytteiden määrä
+    int32_t  curve[RESULT_LOG_CURVE_MAX];
+} result_log_entry_t;
+
+/**
+ * @brief Lokin läpikäynti vanhimmasta uusimpaan
+ */
+typedef struct {
+    uint32_t sector;                // Nykyinen sektori osion sisällä
+    uint32_t offset;                // Seuraavan tietueen offset sektorin sisällä
+    uint32_t sectors_left;          // Läpikäymättä olevat sektorit
+} result_log_iter_t;
+
+/**
+ * @brief Alustaa lokin: etsii osion, rakentaa indeksin ja käynnistää kirjoitustaskin
+ *
+ * @return esp_err_t ESP_OK jos alustus onnistui, ESP_ERR_NOT_FOUND jos osio puuttuu
+ */
+esp_err_t result_log_init(void);
+
+/**
+ * @brief Lisää tuloksen kirjoitusjonoon
+ *
+ * Ei odota flash-kirjoitusta, joten kutsuttavissa myös LVGL-tapahtumista.
+ *
+ * @param entry Tallennettava tulos (kopioidaan)
+ * @return esp_err_t ESP_OK, tai ESP_ERR_NO_MEM jos jono on täynnä
+ */
+esp_err_t result_log_append(const result_log_entry_t *entry);
+
+/**
+ * @brief Harventaa painekäyrän keskiarvoistamalla mahtumaan RESULT_LOG_CURVE_MAX näytteeseen
+ *
+ * @param entry Tulos, johon harvennettu käyrä kirjoitetaan
+ * @param samples Alkuperäiset näytteet
+ * @param count Näytteiden määrä
+ * @param interval_ms Alkuperäinen näyteväli
+ */
+void result_log_set_curve(result_log_entry_t *entry, const int32_t *samples, size_t count, uint16_t interval_ms);
+
+/**
+ * @brief Indeksissä olevien (viimeisimpien) tulosten määrä
+ */
+size_t result_log_count(void);
+
+/**
+ * @brief Viimeisimmän tallennetun tuloksen järjestysnumero (0 jos loki on tyhjä)
+ */
+uint32_t result_log_last_seq(void);
+
+/**
+ * @brief Lukee viimeisimmistä tuloksista yhden
+ *
+ * @param n_back 0 = uusin, 1 = toiseksi uusin, ...
+ * @param entry Puskuri tulokselle
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND jos indeksissä ei ole niin montaa tulosta
+ */
+esp_err_t result_log_get_recent(size_t n_back, result_log_entry_t *entry);
+
+/**
+ * @brief Aloittaa lokin läpikäynnin vanhimmasta tietueesta
+ */
+void result_log_iter_begin(result_log_iter_t *it);
+
+/**
+ * @brief Lukee seuraavan tietueen
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND kun loki on käyty läpi
+ */
+esp_err_t result_log_iter_next(result_log_iter_t *it, result_log_entry_t *entry);
+
+/**
+ * @brief Siirtää iteraattorin ensimmäiseen tietueeseen, jonka järjestysnumero on vähintään seq
+ */
+void result_log_iter_seek(result_log_iter_t *it, uint32_t seq);
+
+/**
+ * @brief Kopioi seuraavan tietueen sellaisenaan (otsake + data + CRC32, ilman täytettä)
+ *
+ * @param buf Puskuri tietueelle
+ * @param size Puskurin koko
+ * @param seq Tietueen järjestysnumero
+ * @return int Tietueen pituus, 0 kun loki on käyty läpi, -1 jos tietue ei mahdu puskuriin
+ */
+int result_log_iter_next_raw(result_log_iter_t *it, uint8_t *buf, size_t size, uint32_t *seq);
+
+/**
+ * @brief Tulostaa tuloksen yhtenä CSV-rivinä
+ */
+int result_log_format_csv(const result_log_entry_t *entry, char *buf, size_t size);
+
+#endif /* RESULT_LOG_H */
@@ -7,19 +7,57 @@
  */
 
  #include "rs485_handler.h"
+ #include <string.h>
+ #include "esp_log.h"
+ #include "nvs.h"
+ #include "app_events.h"
  
- static const char *TAG = "RS485_HANDLER";  // Jos tarvitaan, muuten voi poistaa
+ static const char *TAG = "RS485_HANDLER";
  
  uart_port_t rs485_uart_num = UART_NUM_1;
  static QueueHandle_t rs485_queue = NULL;
+ static SemaphoreHandle_t bus_mutex = NULL;
+ static uint32_t current_baud_rate = RS485_BAUD_RATE;
  
- esp_err_t rs485_init(void)
+ // Oletusasetukset, käytetään kunnes NVS:ään on tallennettu muut
+ static const rs485_config_t default_config = {
+     .baud_rate = RS485_BAUD_RATE,
+     .parity = UART_PARITY_DISABLE,
+     .stop_bits = UART_STOP_BITS_1,
+     .rx_buffer_size = RS485_BUF_SIZE * 2,
+     .tx_buffer_size = RS485_BUF_SIZE * 2,
+ };
+ 
+ static rs485_config_t active_config;
+ static uint32_t bits_per_char = 10;
+ 
+ static esp_err_t validate_config(const rs485_config_t *config)
+ {
+     // Ajurin RX-puskurin pitää olla FIFOa suurempi, TX-puskuri voi olla 0 (suora kirjoitus)
+     if (config->baud_rate < 1200 || config->baud_rate > 1000000 ||
+         config->rx_buffer_size <= UART_HW_FIFO_LEN(rs485_uart_num) ||
+         (config->tx_buffer_size != 0 && config->tx_buffer_size <= UART_HW_FIFO_LEN(rs485_uart_num)) ||
+         (config->parity != UART_PARITY_DISABLE && config->parity != UART_PARITY_EVEN && config->parity != UART_PARITY_ODD) ||
+         (config->stop_bits != UART_STOP_BITS_1 && config->stop_bits != UART_STOP_BITS_2)) {
+         return ESP_ERR_INVALID_ARG;
+     }
+     return ESP_OK;
+ }
+ 
+ // Bittejä merkissä: start + 8 databittiä + pariteetti + stop
+ static uint32_t char_bits(const rs485_config_t *config)
+ {
+     return 1 + 8 + (config->parity != UART_PARITY_DISABLE ? 1 : 0) + (config->stop_bits == UART_STOP_BITS_2 ? 2 : 1);
+ }
+ 
+ // Asentaa ajurin annetuilla asetuksilla. Kutsujalla on väylä varattuna.
+ static esp_err_t install_driver(const rs485_config_t *config)
  {
      uart_config_t uart_config = {
-         .baud_rate = RS485_BAUD_RATE,
+         .baud_rate = config->baud_rate,
          .data_bits = UART_DATA_8_BITS,
-         .parity = UART_PARITY_DISABLE,
-         .stop_bits = UART_STOP_BITS_1,
+         .parity = config->parity,
+         .stop_bits = config->stop_bits,
          .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
          .rx_flow_ctrl_thresh = 122,
          .source_clk = UART_SCLK_DEFAULT,
@@ -29,7 +67,7 @@
      uart_driver_delete(rs485_uart_num);
  
      // Asenna UART-ajuri ja määritä tapahtumien käsittely
-     esp_err_t ret = uart_driver_install(rs485_uart_num, RS485_BUF_SIZE * 2, RS485_BUF_SIZE * 2, 20, &rs485_queue, 0);
+     esp_err_t ret = uart_driver_install(rs485_uart_num, config->rx_buffer_size, config->tx_buffer_size, 20, &rs485_queue, 0);
      if (ret != ESP_OK) {
          return ret;
      }
@@ -49,21 +87,174 @@
          return ret;
      }
  
-     ESP_ERROR_CHECK(uart_set_mode(rs485_uart_num, UART_MODE_RS485_HALF_DUPLEX));
+     // Kehyksen loppu tunnistetaan linjan hiljaisuudesta
+     ret = uart_set_rx_timeout(rs485_uart_num, RS485_FRAME_GAP);
+     if (ret != ESP_OK) {
+         return ret;
+     }
+     uart_set_always_rx_timeout(rs485_uart_num, true);
+ 
+     active_config = *config;
+     current_baud_rate = config->baud_rate;
+     bits_per_char = char_bits(config);
  
      return ESP_OK;
  }
  
- int rs485_receive_data(uint8_t* buffer, size_t max_length, TickType_t timeout)
+ esp_err_t rs485_init(void)
+ {
+     if (bus_mutex == NULL) {
+         bus_mutex = xSemaphoreCreateMutex();
+         if (bus_mutex == NULL) {
+             return ESP_ERR_NO_MEM;
+         }
+     }
+ 
+     rs485_config_t config;
+     if (rs485_config_load(&config) != ESP_OK) {
+         config = default_config;
+     }
+ 
+     esp_err_t ret = install_driver(&config);
+     if (ret != ESP_OK && memcmp(&config, &default_config, sizeof(config)) != 0) {
+         // Tallennetut asetukset eivät kelpaa ajurille, palataan oletuksiin
+         ESP_LOGW(TAG, "Tallennetut asetukset hylättiin (%s), käytetään oletuksia", esp_err_to_name(ret));
+         ret = install_driver(&default_config);
+     }
+     return ret;
+ }
+ 
+ esp_err_t rs485_apply_config(const rs485_config_t *config)
+ {
+     esp_err_t ret = validate_config(config);
+     if (ret != ESP_OK) {
+         return ret;
+     }
+ 
+     if (!rs485_bus_lock(pdMS_TO_TICKS(1000))) {
+         return ESP_ERR_TIMEOUT;
+     }
+ 
+     uart_wait_tx_done(rs485_uart_num, pdMS_TO_TICKS(100));
+ 
+     // Pelkkä kehysmuodon muutos ei vaadi ajurin uudelleenasennusta
+     if (config->rx_buffer_size == active_config.rx_buffer_size &&
+         config->tx_buffer_size == active_config.tx_buffer_size) {
+         ret = uart_set_baudrate(rs485_uart_num, config->baud_rate);
+         if (ret == ESP_OK) {
+             ret = uart_set_parity(rs485_uart_num, config->parity);
+         }
+         if (ret == ESP_OK) {
+             ret = uart_set_stop_bits(rs485_uart_num, config->stop_bits);
+         }
+         if (ret == ESP_OK) {
+             active_config = *config;
+             current_baud_rate = config->baud_rate;
+             bits_per_char = char_bits(config);
+             rs485_flush();
+         }
+     } else {
+         ret = install_driver(config);
+     }
+ 
+     rs485_bus_unlock();
+     if (ret == ESP_OK) {
+         ESP_LOGI(TAG, "Väylä: %lu bit/s, pariteetti %d, stop %d, puskurit %u/%u",
+                  config->baud_rate, config->parity, config->stop_bits, config->rx_buffer_size, config->tx_buffer_size);
+     } else {
+         ESP_LOGE(TAG, "Väylän asetusten käyttöönotto epäonnistui: %s", esp_err_to_name(ret));
+     }
+     return ret;
+ }
+ 
+ void rs485_get_config(rs485_config_t *config)
+ {
+     *config = active_config;
+ }
+ 
+ esp_err_t rs485_config_load(rs485_config_t *config)
+ {
+     nvs_handle_t handle;
+     esp_err_t ret = nvs_open(RS485_NVS_NAMESPACE, NVS_READONLY, &handle);
+     if (ret != ESP_OK) {
+         return ret;
+     }
+ 
+     size_t size = sizeof(*config);
+     ret = nvs_get_blob(handle, "config", config, &size);
+     nvs_close(handle);
+ 
+     if (ret == ESP_OK && (size != sizeof(*config) || validate_config(config) != ESP_OK)) {
+         return ESP_ERR_INVALID_STATE;
+     }
+     return ret;
+ }
+ 
+ esp_err_t rs485_config_save(const rs485_config_t *config)
+ {
+     nvs_handle_t handle;
+     esp_err_t ret = nvs_open(RS485_NVS_NAMESPACE, NVS_READWRITE, &handle);
+     if (ret != ESP_OK) {
+         return ret;
+     }
+ 
+     ret = nvs_set_blob(handle, "config", config, sizeof(*config));
+     if (ret == ESP_OK) {
+         ret = nvs_commit(handle);
+     }
+     nvs_close(handle);
+     return ret;
+ }
+ 
+ TickType_t rs485_chars_to_ticks(size_t chars)
+ {
+     uint32_t us = (uint32_t)((chars * bits_per_char * 1000000ULL + current_baud_rate - 1) / current_baud_rate);
+     return pdMS_TO_TICKS((us + 999) / 1000) + 1;
+ }
+ 
+ int rs485_receive_frame(uint8_t* buffer, size_t max_length, TickType_t timeout)
  {
      if (buffer == NULL || max_length == 0) {
          return -1;
      }
  
-     int length = uart_read_bytes(rs485_uart_num, buffer, max_length, timeout);
+     size_t length = 0;
+     uart_event_t event;
+ 
+     while (length < max_length) {
+         if (xQueueReceive(rs485_queue, &event, timeout) != pdTRUE) {
+             break;
+         }
+ 
+         switch (event.type) {
+             case UART_DATA: {
+                 size_t want = event.size < max_length - length ? event.size : max_length - length;
+                 int n = uart_read_bytes(rs485_uart_num, buffer + length, want, 0);
+                 if (n > 0) {
+                     length += n;
+                 }
+                 if (event.timeout_flag && length > 0) {
+                     // Linja hiljeni: kehys on valmis
+                     app_events_post(APP_EVENT_BUS_RX);
+                     return length;
+                 }
+                 // Kehys jatkuu, loppu tulee viimeistään jäljellä olevan pituuden ajassa
+                 timeout = rs485_chars_to_ticks(max_length - length + RS485_FRAME_GAP);
+                 break;
+             }
+             case UART_FIFO_OVF:
+             case UART_BUFFER_FULL:
+                 ESP_LOGW(TAG, "RX-puskuri täynnä, kehys hylätään");
+                 rs485_flush();
+                 return -1;
+             default:
+                 break;
+         }
+     }
+ 
      if (length > 0) {
+         app_events_post(APP_EVENT_BUS_RX);
      }
-     
      return length;
  }
  
@@ -77,12 +268,48 @@
      if (sent < 0) {
          return ESP_FAIL;
      }
+     app_events_post(APP_EVENT_BUS_TX);
      
-     return ESP_OK;
+     // uart_write_bytes vain jonottaa tavut: odota että viimeinenkin bitti on
+     // lähtenyt, jotta vastauksen aikaraja alkaa lähetyksen päättymisestä
+     return uart_wait_tx_done(rs485_uart_num, rs485_chars_to_ticks(length) + pdMS_TO_TICKS(10));
  }
  
  void rs485_flush(void)
  {
      uart_flush(rs485_uart_num);
+     // Myös jo tyhjennetyn datan tapahtumat pois
+     xQueueReset(rs485_queue);
+ }
+ 
+ esp_err_t rs485_set_baud_rate(uint32_t baud_rate)
+ {
+     if (baud_rate == current_baud_rate) {
+         return ESP_OK;
+     }
+ 
+     // Odota edellisen kehyksen lähtö ennen nopeuden vaihtoa
+     uart_wait_tx_done(rs485_uart_num, pdMS_TO_TICKS(100));
+     esp_err_t ret = uart_set_baudrate(rs485_uart_num, baud_rate);
+     if (ret == ESP_OK) {
+         current_baud_rate = baud_rate;
+         rs485_flush();
+     }
+     return ret;
+ }
+ 
+ uint32_t rs485_get_baud_rate(void)
+ {
+     return current_baud_rate;
+ }
+ 
+ bool rs485_bus_lock(TickType_t timeout)
+ {
+     return bus_mutex != NULL && xSemaphoreTake(bus_mutex, timeout) == pdTRUE;
+ }
+ 
+ void rs485_bus_unlock(void)
+ {
+     xSemaphoreGive(bus_mutex);
  }
  
\ No newline at end of file
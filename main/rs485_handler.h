@@ -12,6 +12,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "esp_err.h"
@@ -21,19 +22,61 @@ extern uart_port_t rs485_uart_num;
 // RS485 määritykset (ESP32-S3-Touch-LCD-7 laitteelle)
 #define RS485_TXD           (16)                // UART TX pin (GPIO15)
 #define RS485_RXD           (15)                // UART RX pin (GPIO16)
-#define RS485_BAUD_RATE     (19200)            // UART baud rate
-#define RS485_BUF_SIZE      (127)               // UART buffer size
+#define RS485_BAUD_RATE     (19200)             // Oletusnopeus (asetukset NVS:ssä)
+#define RS485_BUF_SIZE      (127)               // Oletuspuskurin koko (ajurille 2x)
 #define RS485_UART_NUM      UART_NUM_1  // Käytä UART2 (voi olla myös UART_NUM_1 riippuen kytkennästä)
+#define RS485_FRAME_GAP     (4)                 // Kehysten väli merkkiaikoina (Modbus RTU: 3.5)
+#define RS485_NVS_NAMESPACE "rs485"
+
+/**
+ * @brief Väylän asetukset, tallennetaan NVS:ään
+ */
+typedef struct {
+    uint32_t baud_rate;
+    uart_parity_t parity;               // UART_PARITY_DISABLE / EVEN / ODD
+    uart_stop_bits_t stop_bits;         // UART_STOP_BITS_1 / UART_STOP_BITS_2
+    uint16_t rx_buffer_size;            // Ajurin puskurit tavuina
+    uint16_t tx_buffer_size;
+} rs485_config_t;
+
 /**
  * @brief Alustaa RS485-kommunikoinnin
  * 
+ * Asetukset luetaan NVS:stä, joten nvs_flash_init() pitää kutsua ensin.
+ * 
  * @return esp_err_t ESP_OK jos alustus onnistui, muutoin virhekoodi
  */
 esp_err_t rs485_init(void);
 
+/**
+ * @brief Ottaa uudet väylän asetukset käyttöön (ei tallenna)
+ *
+ * Ajuri asennetaan uudelleen vain jos puskurikoot muuttuvat.
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG jos asetukset eivät kelpaa
+ */
+esp_err_t rs485_apply_config(const rs485_config_t *config);
+
+/**
+ * @brief Palauttaa käytössä olevat asetukset
+ */
+void rs485_get_config(rs485_config_t *config);
+
+/**
+ * @brief Lukee tallennetut asetukset NVS:stä
+ */
+esp_err_t rs485_config_load(rs485_config_t *config);
+
+/**
+ * @brief Tallentaa asetukset NVS:ään
+ */
+esp_err_t rs485_config_save(const rs485_config_t *config);
+
 /**
  * @brief Lähettää dataa RS485-väylän kautta
  * 
+ * Palaa vasta kun data on kokonaan lähtenyt linjalle (TX done).
+ * 
  * @param data Lähetettävän datan osoite
  * @param length Lähetettävän datan pituus tavuissa
  * @return esp_err_t ESP_OK jos lähetys onnistui, muutoin virhekoodi
@@ -41,18 +84,51 @@ esp_err_t rs485_init(void);
 esp_err_t rs485_send_data(const uint8_t* data, size_t length);
 
 /**
- * @brief Vastaanottaa dataa RS485-väylän kautta
- * 
- * @param buffer Puskuri, johon vastaanotettu data tallennetaan
- * @param max_length Puskurin maksimipituus tavuissa
- * @param timeout Odotusaika millisekunteina
- * @return int Vastaanotettujen tavujen määrä tai -1 virhetilanteessa
+ * @brief Vastaanottaa yhden kehyksen
+ *
+ * Kehys päättyy, kun linja on ollut hiljaa RS485_FRAME_GAP merkkiajan
+ * verran (UART:n RX-aikakatkaisu), joten vastaus palautuu heti eikä
+ * puskurin täyttymistä tai aikarajaa tarvitse odottaa.
+ *
+ * @param buffer Puskuri kehykselle
+ * @param max_length Puskurin koko
+ * @param timeout Ensimmäisen tavun odotusaika
+ * @return int Kehyksen pituus, 0 jos mitään ei tullut, -1 virhetilanteessa
+ */
+int rs485_receive_frame(uint8_t* buffer, size_t max_length, TickType_t timeout);
+
+/**
+ * @brief Muuntaa merkkimäärän siirtoajan tickeiksi nykyisellä nopeudella (pyöristys ylöspäin)
  */
-int rs485_receive_data(uint8_t* buffer, size_t max_length, TickType_t timeout);
+TickType_t rs485_chars_to_ticks(size_t chars);
 
 /**
  * @brief Tyhjentää UART-puskurin
  */
 void rs485_flush(void);
 
+/**
+ * @brief Vaihtaa väylän nopeuden väliaikaisesti (esim. yhden laitteen pyynnön ajaksi)
+ *
+ * Ei muuta asetuksia, rs485_get_config() palauttaa edelleen väylän oletusnopeuden.
+ */
+esp_err_t rs485_set_baud_rate(uint32_t baud_rate);
+
+/**
+ * @brief Palauttaa väylän nykyisen nopeuden
+ */
+uint32_t rs485_get_baud_rate(void);
+
+/**
+ * @brief Varaa väylän yhtä pyyntö-vastaus-paria varten
+ *
+ * @return true jos väylä saatiin varattua ajassa
+ */
+bool rs485_bus_lock(TickType_t timeout);
+
+/**
+ * @brief Vapauttaa väylän
+ */
+void rs485_bus_unlock(void);
+
 #endif /* RS485_HANDLER_H */
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "testing_content.h"
 #include "program_content.h"
 #include "fonts/my_custom_fonts.h"
+#include "app_events.h"
 
 static const char *TAG = "screen_manager";
 
@@ -109,6 +110,7 @@ void screen_manager_load_screen(screen_type_t screen_type)
     if (screen_type >= 0 && screen_type < SCREEN_COUNT && screens[screen_type]) {
         current_screen = screen_type;
         lv_scr_load(screens[screen_type]);
+        app_events_post(APP_EVENT_SCREEN_CHANGED);
         
         if (navbars[screen_type]) {
             activate_nav_button(navbars[screen_type], screen_type);
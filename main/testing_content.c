@@ -2,19 +2,137 @@
 #include "screen_manager.h"
 #include "rs485_handler.h"
 #include "modbus_handler.h"
+#include "modbus_cache.h"
 #include "esp_log.h"
+#include <string.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "result_log.h"
+#include "app_events.h"
+#include "app_state.h"
+#include "modbus_slave.h"
+#include "lvgl_port.h"
 
 static const char *TAG = "testing_content";
 
+// Näytettävien viimeisimpien tulosten määrä
+#define RECENT_RESULTS_SHOWN    5
+
+// Testin seuranta: näyteväli, käyrän puskuri ja aikakatkaisut
+#define MONITOR_SAMPLE_MS       100
+#define MONITOR_MAX_SAMPLES     2048    // Täyttyessä harvennetaan puoleen, koko testi mahtuu aina
+#define MONITOR_START_MS        3000    // Testin on käynnistyttävä tässä ajassa
+#define MONITOR_MAX_ERRORS      10      // Peräkkäiset lukuvirheet ennen keskeytystä
+
 // Test status indicators
 static lv_obj_t* status_label = NULL;
 static lv_obj_t* status_led = NULL;
-static bool is_screen_active = false;
+static lv_obj_t* results_label = NULL;
+
+// Paine ja vuoto näytteistä: seurantataski päivittää tekstin LVGL:n komentojonon kautta
+static volatile lvgl_port_ui_obj_t pressure_handle = 0;
+static result_log_entry_t recent_entry;
+
+/**
+ * @brief Päivitä viimeisimpien tulosten lista lokin indeksistä
+ */
+static void refresh_recent_results(void)
+{
+    char text[RECENT_RESULTS_SHOWN * 48] = "";
+    size_t len = 0;
+
+    for (int i = 0; i < RECENT_RESULTS_SHOWN && len < sizeof(text); i++) {
+        if (result_log_get_recent(i, &recent_entry) != ESP_OK) {
+            break;
+        }
+        const char *outcome = recent_entry.outcome == RESULT_LOG_OUTCOME_PASS ? "OK" :
+                              recent_entry.outcome == RESULT_LOG_OUTCOME_FAIL ? "HYLÄTTY" : "VIRHE";
+        len += snprintf(text + len, sizeof(text) - len, "#%lu  Ohjelma %u  %s  vuoto %ld\n",
+                        recent_entry.seq, recent_entry.program, outcome, recent_entry.leak_value);
+    }
+
+    lv_label_set_text(results_label, len ? text : "Ei tallennettuja tuloksia");
+}
+
+// Tuloslista päivittyy vain kun lokiin on tallennettu uusi tulos
+static void result_logged_msg_cb(lv_event_t* e)
+{
+    refresh_recent_results();
+}
+
+/*
+ * Aloitus ja seuranta tehdään test_monitor_task-taskissa, joten START-napin
+ * käsittelijä ei odota väylää. Käsittelijä vain pyytää aloitusta, ja taski
+ * kertoo aloituskomennon tuloksen APP_EVENT_TEST_START-tapahtumalla.
+ */
+typedef enum {
+    START_IDLE,
+    START_SENDING,
+    START_OK,
+    START_FAILED,
+} start_state_t;
+
+static portMUX_TYPE monitor_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool monitor_running = false;
+static bool start_requested = false;
+static start_state_t start_state = START_IDLE;
+static esp_err_t start_error = ESP_OK;
+
+static void set_start_status(start_state_t state, esp_err_t error)
+{
+    taskENTER_CRITICAL(&monitor_lock);
+    start_state = state;
+    start_error = error;
+    taskEXIT_CRITICAL(&monitor_lock);
+    app_events_post(APP_EVENT_TEST_START);
+}
+
+static bool take_start_request(void)
+{
+    taskENTER_CRITICAL(&monitor_lock);
+    bool requested = start_requested;
+    start_requested = false;
+    taskEXIT_CRITICAL(&monitor_lock);
+    return requested;
+}
+
+// Seuranta loppuu, ellei uutta aloitusta pyydetty juuri sen päättyessä
+static bool monitor_finish(void)
+{
+    taskENTER_CRITICAL(&monitor_lock);
+    bool again = start_requested;
+    if (!again) {
+        monitor_running = false;
+    }
+    taskEXIT_CRITICAL(&monitor_lock);
+    return again;
+}
+
+// 32-bittinen arvo kahdesta rekisteristä laitteen rekisterijärjestyksessä
+static int32_t words_to_i32(const uint16_t *words, word_order_t order)
+{
+    if (order == WORD_ORDER_LOW_FIRST) {
+        return (int32_t)(((uint32_t)words[1] << 16) | words[0]);
+    }
+    return (int32_t)(((uint32_t)words[0] << 16) | words[1]);
+}
+
+// Testin tila, tulos, paine ja vuoto yhdellä luvulla. Jaettu luku: muut
+// saman lohkon lukijat saavat tämän näytteen tuloksen ilman omaa pyyntöä
+static esp_err_t read_test_block(uint16_t *block)
+{
+    return modbus_read_shared(MODBUS_DEFAULT_SLAVE_ID, FORTEST_TEST_STATE_ADDR,
+                              FORTEST_TEST_BLOCK_WORDS, block, MONITOR_SAMPLE_MS / 2);
+}
+
+#define BLOCK_WORD(name)        ((name##_ADDR) - FORTEST_TEST_STATE_ADDR)
 
 /**
  * @brief Lähetä Modbus-komento testin aloittamiseksi
  * 
- * Funktio lähettää Write Single Coil -komennon osoitteeseen 0x0A arvolla 0xFF00
+ * Funktio lähettää Write Single Coil -komennon kelaan FORTEST_START_TEST arvolla 0xFF00
  * ForTest-manuaalin määritysten mukaisesti.
  */
 static esp_err_t rs485_send_modbus_command(uint8_t slave_id, uint8_t function_code, uint16_t address, uint16_t value)
@@ -39,16 +157,11 @@ static esp_err_t rs485_send_modbus_command(uint8_t slave_id, uint8_t function_co
         tx_buffer[0], tx_buffer[1], tx_buffer[2], tx_buffer[3],
         tx_buffer[4], tx_buffer[5], tx_buffer[6], tx_buffer[7]);
     
-    // Tyhjennä mahdolliset puskuroidut tiedot
-    rs485_flush();
+    // Lähetä viesti ja odota vastausta
+    int rx_length = modbus_transaction(tx_buffer, 8, rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(500));
+    esp_err_t result = (rx_length < 0) ? ESP_FAIL : ESP_OK;
     
-    // Lähetä viesti RS485:n kautta
-    esp_err_t result = rs485_send_data(tx_buffer, 8);
-    
-    // Odota vastausta
     if (result == ESP_OK) {
-        int rx_length = rs485_receive_data(rx_buffer, sizeof(rx_buffer), pdMS_TO_TICKS(500));
-        
         if (rx_length > 0) {
             ESP_LOGI(TAG, "Vastaus vastaanotettu (%d tavua):", rx_length);
             for (int i = 0; i < rx_length; i++) {
@@ -82,24 +195,173 @@ static esp_err_t rs485_send_modbus_command(uint8_t slave_id, uint8_t function_co
         }
     }
     
-    // Päivitä käyttöliittymä tuloksen perusteella
-    if (result == ESP_OK) {
-        if (status_label) {
-            lv_label_set_text(status_label, "Testi aloitettu");
+    return result;
+}
+
+// Kirjaa epäonnistunut aloitus tuloslokiin
+static void log_start_failure(void)
+{
+    static result_log_entry_t entry;
+    app_programs_t programs;
+    app_state_get_programs(&programs);
+    memset(&entry, 0, sizeof(entry));
+    entry.timestamp = (uint32_t)time(NULL);
+    entry.program = programs.program[0];
+    entry.outcome = RESULT_LOG_OUTCOME_ERROR;
+    result_log_append(&entry);
+}
+
+/**
+ * @brief Lähettää aloituskomennon ja julkaisee tuloksen
+ *
+ * T8090-manuaalin mukaan testi aloitetaan Write Single Coil (0x05)
+ * -komennolla kelaan FORTEST_START_TEST arvolla 0xFF00.
+ */
+static esp_err_t send_start(void)
+{
+    esp_err_t ret = rs485_send_modbus_command(MODBUS_DEFAULT_SLAVE_ID, 0x05, FORTEST_START_TEST_ADDR, 0xFF00);
+    set_start_status(ret == ESP_OK ? START_OK : START_FAILED, ret);
+    if (ret != ESP_OK) {
+        log_start_failure();
+    }
+    return ret;
+}
+
+/**
+ * @brief Seuraa käynnistettyä testiä ja kirjaa tuloksen lokiin
+ *
+ * Painetta näytteistetään MONITOR_SAMPLE_MS välein niin kauan kuin testi
+ * on käynnissä. Kun tila palaa valmiiksi, luetaan tulos ja mitatut arvot
+ * ja koko käyrä tallennetaan harvennettuna. Kesken testin pyydetty uusi
+ * aloitus lähetetään seuraavan näytteen yhteydessä, ja seuranta jatkuu.
+ */
+static void monitor_test(void)
+{
+    static result_log_entry_t entry;
+    const word_order_t order = modbus_slave_get_word_order(MODBUS_DEFAULT_SLAVE_ID);
+    uint16_t block[FORTEST_TEST_BLOCK_WORDS];
+    char text[LVGL_PORT_UI_TEXT_MAX];
+    uint16_t interval_ms = MONITOR_SAMPLE_MS;
+    size_t count = 0;
+    int errors = 0;
+    bool started = false;
+    bool finished = false;
+
+    app_programs_t programs;
+    app_state_get_programs(&programs);
+    memset(&entry, 0, sizeof(entry));
+    entry.timestamp = (uint32_t)time(NULL);
+    entry.program = programs.program[0];
+
+    // Käyrä voi olla pitkä, joten se pidetään PSRAMissa vain testin ajan
+    int32_t *samples = heap_caps_malloc(MONITOR_MAX_SAMPLES * sizeof(int32_t), MALLOC_CAP_SPIRAM);
+    if (samples == NULL) {
+        ESP_LOGE(TAG, "Ei muistia painekäyrälle");
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    TickType_t wake = start;
+    while (!finished) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(interval_ms));
+
+        if (take_start_request()) {
+            send_start();
         }
-        if (status_led) {
-            lv_obj_set_style_bg_color(status_led, lv_color_hex(0x00FF00), 0); // Vihreä
+
+        if (read_test_block(block) != ESP_OK) {
+            if (++errors >= MONITOR_MAX_ERRORS) {
+                ESP_LOGE(TAG, "Testin tilaa ei saatu luettua, seuranta keskeytetty");
+                break;
+            }
+            continue;
+        }
+        errors = 0;
+
+        if (block[BLOCK_WORD(FORTEST_TEST_STATE)] == FORTEST_TEST_STATE_RUNNING) {
+            started = true;
+        } else if (started) {
+            finished = true;
+        } else if (xTaskGetTickCount() - start > pdMS_TO_TICKS(MONITOR_START_MS)) {
+            ESP_LOGW(TAG, "Testi ei käynnistynyt");
+            break;
+        } else {
+            continue;
+        }
+
+        entry.test_pressure = words_to_i32(&block[BLOCK_WORD(FORTEST_TEST_PRESSURE)], order);
+        entry.leak_value = words_to_i32(&block[BLOCK_WORD(FORTEST_LEAK_VALUE)], order);
+        snprintf(text, sizeof(text), "%s: paine %ld, vuoto %ld", finished ? "Valmis" : "Käynnissä",
+                 entry.test_pressure, entry.leak_value);
+        lvgl_port_ui_set_text(pressure_handle, text);
+        if (samples == NULL || finished) {
+            continue;
+        }
+
+        if (count == MONITOR_MAX_SAMPLES) {
+            // Parittainen keskiarvo, näyteväli kaksinkertaistuu
+            for (size_t i = 0; i < count / 2; i++) {
+                samples[i] = (int32_t)(((int64_t)samples[2 * i] + samples[2 * i + 1]) / 2);
+            }
+            count /= 2;
+            interval_ms *= 2;
         }
+        samples[count++] = entry.test_pressure;
+    }
+
+    if (finished) {
+        uint16_t result = block[BLOCK_WORD(FORTEST_TEST_RESULT)];
+        entry.outcome = (result == FORTEST_TEST_RESULT_PASS) ? RESULT_LOG_OUTCOME_PASS :
+                        (result == FORTEST_TEST_RESULT_FAIL) ? RESULT_LOG_OUTCOME_FAIL : RESULT_LOG_OUTCOME_ABORTED;
     } else {
-        if (status_label) {
-            lv_label_set_text(status_label, "Testin aloitus epäonnistui");
+        entry.outcome = started ? RESULT_LOG_OUTCOME_ABORTED : RESULT_LOG_OUTCOME_ERROR;
+    }
+    if (samples) {
+        result_log_set_curve(&entry, samples, count, interval_ms);
+        heap_caps_free(samples);
+    }
+    ESP_LOGI(TAG, "Testi päättyi: ohjelma %u, tulos %u, paine %ld, vuoto %ld, %u näytettä",
+             entry.program, entry.outcome, entry.test_pressure, entry.leak_value, entry.curve_len);
+    result_log_append(&entry);
+}
+
+static void test_monitor_task(void *arg)
+{
+    do {
+        take_start_request();
+        if (send_start() == ESP_OK) {
+            monitor_test();
         }
-        if (status_led) {
+    } while (monitor_finish());
+    vTaskDelete(NULL);
+}
+
+static void show_start_status(void)
+{
+    taskENTER_CRITICAL(&monitor_lock);
+    start_state_t state = start_state;
+    esp_err_t error = start_error;
+    taskEXIT_CRITICAL(&monitor_lock);
+
+    switch (state) {
+        case START_SENDING:
+            lv_label_set_text(status_label, "Aloitetaan testiä...");
+            break;
+        case START_OK:
+            lv_label_set_text(status_label, "Testi aloitettu");
+            lv_obj_set_style_bg_color(status_led, lv_color_hex(0x00FF00), 0); // Vihreä
+            break;
+        case START_FAILED:
+            lv_label_set_text_fmt(status_label, "Testin aloitus epäonnistui: %s", esp_err_to_name(error));
             lv_obj_set_style_bg_color(status_led, lv_color_hex(0xFF0000), 0); // Punainen
-        }
+            break;
+        default:
+            break;
     }
-    
-    return result;
+}
+
+static void start_status_msg_cb(lv_event_t* e)
+{
+    show_start_status();
 }
 
 /**
@@ -110,10 +372,24 @@ static void start_button_event_cb(lv_event_t* e)
     uint32_t code = lv_event_get_code(e);
     if (code == LV_EVENT_CLICKED) {
         ESP_LOGI(TAG, "START button clicked, sending Modbus command");
-        
-        // According to T8090 manual, test is started with Write Single Coil (0x05)
-        // to address 0x0A with value 0xFF00
-        rs485_send_modbus_command(1, 0x05, 0x0A, 0xFF00);
+
+        // Käynnissä oleva seuranta lähettää aloituksen itse, muuten käynnistetään uusi
+        taskENTER_CRITICAL(&monitor_lock);
+        start_requested = true;
+        bool spawn = !monitor_running;
+        monitor_running = true;
+        taskEXIT_CRITICAL(&monitor_lock);
+
+        set_start_status(START_SENDING, ESP_OK);
+        if (spawn && xTaskCreate(test_monitor_task, "test_monitor", 3072, NULL, 2, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Testin seurantaa ei voitu käynnistää");
+            taskENTER_CRITICAL(&monitor_lock);
+            start_requested = false;
+            monitor_running = false;
+            taskEXIT_CRITICAL(&monitor_lock);
+            set_start_status(START_FAILED, ESP_ERR_NO_MEM);
+        }
+        show_start_status();
     }
 }
 
@@ -147,7 +423,15 @@ void testing_content_create(lv_obj_t *parent)
     status_label = lv_label_create(status_panel);
     lv_label_set_text(status_label, "Ready");
     lv_obj_align_to(status_label, status_led, LV_ALIGN_OUT_RIGHT_MID, 20, 0);
+    lv_msg_subscribe_obj(APP_EVENT_TEST_START, status_label, NULL);
+    lv_obj_add_event_cb(status_label, start_status_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
     
+    // Paine ja vuoto testin aikana
+    lv_obj_t* pressure_label = lv_label_create(parent);
+    lv_label_set_text(pressure_label, "");
+    lv_obj_align_to(pressure_label, status_panel, LV_ALIGN_OUT_BOTTOM_MID, 0, 10);
+    pressure_handle = lvgl_port_ui_bind(pressure_label);
+
     // START button
     lv_obj_t* start_btn = lv_btn_create(parent);
     lv_obj_set_size(start_btn, 200, 80);
@@ -161,16 +445,19 @@ void testing_content_create(lv_obj_t *parent)
     
     // Add event handler for button
     lv_obj_add_event_cb(start_btn, start_button_event_cb, LV_EVENT_CLICKED, NULL);
-}
 
-bool testing_content_update(void)
-{
-    is_screen_active = screen_manager_is_screen_active(SCREEN_TESTING);
-    return is_screen_active;
+    // Viimeisimmät tulokset
+    results_label = lv_label_create(parent);
+    lv_obj_align(results_label, LV_ALIGN_BOTTOM_LEFT, 20, -20);
+    lv_msg_subscribe_obj(APP_EVENT_RESULT_LOGGED, results_label, NULL);
+    lv_obj_add_event_cb(results_label, result_logged_msg_cb, LV_EVENT_MSG_RECEIVED, NULL);
+    refresh_recent_results();
 }
 
 void testing_content_deinit(void)
 {
     status_label = NULL;
     status_led = NULL;
+    results_label = NULL;
+    pressure_handle = 0;
 }
\ No newline at end of file
@@ -10,14 +10,6 @@
  */
 void testing_content_create(lv_obj_t *parent);
 
-/**
- * @brief Update testing screen content (called from screen_manager)
- * 
- * @return true if screen is active
- * @return false if screen is not active
- */
-bool testing_content_update(void);
-
 /**
  * @brief Clean up testing screen resources
  */
@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""
+Pull exported data off the panel over the serial console.
+
+The firmware prints each chunk as one line:
+
+    #C <source> <pos> <next> <len> <crc32> <base64>
+
+and ends the transfer with "#E <source> <next>". Lines that do not start
+with '#' (log output, the prompt) are ignored. A chunk with a bad CRC or
+a stalled transfer is re-requested from the last good position, so the
+export can run while the panel keeps testing. Chunks that the console was
+still sending from before a re-request are dropped without counting as
+failures.
+
+Examples:
+    tools/export_logs.py -p /dev/ttyUSB0 results -o results.csv
+    tools/export_logs.py -p /dev/ttyUSB0 results --raw -o results.bin
+    tools/export_logs.py -p /dev/ttyUSB0 results_csv --start 120
+"""
+
+import argparse
+import base64
+import struct
+import sys
+import time
+import zlib
+
+import serial
+
+RECORD_MAGIC = 0x5AA5
+RECORD_HDR = struct.Struct("<HHI")      # magic, len, seq
+CSV_HEADER = "seq,timestamp,program,outcome,test_pressure,leak_value,curve_interval_ms,curve\n"
+
+
+def get_varint(data, pos):
+    value = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+
+
+def zigzag_decode(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def to_int32(v):
+    v &= 0xFFFFFFFF
+    return v - 0x100000000 if v & 0x80000000 else v
+
+
+def decode_record(seq, payload):
+    """Same field order as encode_entry() in main/result_log.c."""
+    timestamp, p = get_varint(payload, 0)
+    program, p = get_varint(payload, p)
+    outcome = payload[p]
+    p += 1
+    v, p = get_varint(payload, p)
+    test_pressure = zigzag_decode(v)
+    v, p = get_varint(payload, p)
+    leak_value = zigzag_decode(v)
+    interval, p = get_varint(payload, p)
+    count, p = get_varint(payload, p)
+    curve = []
+    prev = 0
+    for _ in range(count):
+        v, p = get_varint(payload, p)
+        prev = to_int32(prev + zigzag_decode(v))
+        curve.append(prev)
+    return "%d,%d,%d,%d,%d,%d,%d,%s\n" % (seq, timestamp, program, outcome, test_pressure,
+                                          leak_value, interval, ";".join(str(c) for c in curve))
+
+
+def split_records(chunk):
+    """Yields (seq, payload) for each raw record in a 'results' chunk."""
+    pos = 0
+    while pos < len(chunk):
+        magic, length, seq = RECORD_HDR.unpack_from(chunk, pos)
+        end = pos + RECORD_HDR.size + length
+        if magic != RECORD_MAGIC or end + 4 > len(chunk):
+            raise ValueError("corrupt record at offset %d" % pos)
+        (crc,) = struct.unpack_from("<I", chunk, end)
+        if zlib.crc32(chunk[pos:end]) != crc:
+            raise ValueError("record %d CRC mismatch" % seq)
+        yield seq, chunk[pos + RECORD_HDR.size:end]
+        pos = end + 4
+
+
+class Exporter:
+    def __init__(self, port, baud, timeout):
+        self.ser = serial.Serial(port, baud, timeout=timeout)
+        self.timeout = timeout
+
+    def request(self, source, position):
+        self.ser.reset_input_buffer()
+        self.ser.write(("export %s %d\n" % (source, position)).encode())
+
+    def run(self, source, position, on_chunk, retries):
+        failures = 0
+        self.request(source, position)
+        # Until the new stream reaches position, lines may still belong to the stream the
+        # console was sending when we re-requested; those are dropped, not counted as failures
+        syncing = True
+        last_data = time.monotonic()
+        while True:
+            line = self.ser.readline()
+            if not line:
+                if time.monotonic() - last_data < self.timeout:
+                    continue
+                reason = "timeout"
+            else:
+                fields = line.decode(errors="replace").strip().split(" ")
+                if len(fields) < 3 or fields[1] != source:
+                    continue
+                last_data = time.monotonic()
+                if fields[0] == "#X":
+                    raise RuntimeError("device error: %s" % " ".join(fields[2:]))
+                if fields[0] not in ("#C", "#E") or (fields[0] == "#C" and len(fields) != 7):
+                    continue
+                try:
+                    pos = int(fields[2])
+                except ValueError:
+                    continue
+                if pos < position or (syncing and pos != position):
+                    continue
+                syncing = False
+                if fields[0] == "#E":
+                    if pos == position:
+                        return pos
+                    reason = "stream ended at %d, expected %d" % (pos, position)
+                else:
+                    reason = self.accept(fields, position, on_chunk)
+                    if reason is None:
+                        position = int(fields[3])
+                        failures = 0
+                        continue
+
+            failures += 1
+            if failures > retries:
+                raise RuntimeError("giving up at position %d (%s)" % (position, reason))
+            print("retry from %d: %s" % (position, reason), file=sys.stderr)
+            time.sleep(0.2)
+            self.request(source, position)
+            syncing = True
+            last_data = time.monotonic()
+
+    @staticmethod
+    def accept(fields, position, on_chunk):
+        pos, length, crc = int(fields[2]), int(fields[4]), int(fields[5], 16)
+        if pos != position:
+            return "expected position %d, got %d" % (position, pos)
+        try:
+            data = base64.b64decode(fields[6], validate=True)
+        except ValueError:
+            return "bad base64"
+        if len(data) != length or zlib.crc32(data) != crc:
+            return "chunk CRC mismatch"
+        try:
+            on_chunk(data)
+        except ValueError as err:
+            return str(err)
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="export source (see 'export list' on the console)")
+    parser.add_argument("-p", "--port", required=True)
+    parser.add_argument("-b", "--baud", type=int, default=115200)
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    parser.add_argument("--start", type=int, default=0, help="resume from this position")
+    parser.add_argument("--raw", action="store_true", help="write chunks as received, do not decode records")
+    parser.add_argument("--timeout", type=float, default=3.0)
+    parser.add_argument("--retries", type=int, default=10)
+    args = parser.parse_args()
+
+    decode = args.source == "results" and not args.raw
+    out = open(args.output, "wb") if args.output else sys.stdout.buffer
+    if decode and args.start == 0:
+        out.write(CSV_HEADER.encode())
+
+    def on_chunk(data):
+        if decode:
+            # Validate the whole chunk before writing so a retry never duplicates rows
+            rows = [decode_record(seq, payload) for seq, payload in split_records(data)]
+            out.write("".join(rows).encode())
+        else:
+            out.write(data)
+
+    exporter = Exporter(args.port, args.baud, args.timeout)
+    started = time.monotonic()
+    before = out.tell() if args.output else 0
+    end = exporter.run(args.source, args.start, on_chunk, args.retries)
+    out.flush()
+
+    if args.output:
+        elapsed = time.monotonic() - started
+        size = out.tell() - before
+        print("%s: %d bytes, next position %d, %.1f kB/s" % (args.source, size, end, size / 1024 / elapsed),
+              file=sys.stderr)
+        out.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+Run the lvgl_bench console command on the panel and print the results as
+a Markdown table row.
+
+The firmware must be built with CONFIG_EXAMPLE_LVGL_PORT_BENCH. The avoid
+tearing mode, rotation and blend options are build settings, so flash one
+build per configuration and run this once for each. Each row is the median
+of --runs runs by frame rate. With -o the row is appended to a Markdown
+file, and the table header is written first if the file is new.
+
+Examples:
+    tools/lvgl_bench.py -p /dev/ttyUSB0
+    tools/lvgl_bench.py -p /dev/ttyUSB0 --runs 5 --label "mode 5, tile 20" -o bench.md
+"""
+
+import argparse
+import os
+import re
+import sys
+import time
+
+import serial
+
+HEADER = ("| Build | Mode | Rotation | Fast blend | Band blend | fps | render avg/max us "
+          "| copy avg/max us | vsync avg/max us |\n"
+          "| --- | --- | --- | --- | --- | --- | --- | --- | --- |\n")
+
+# Same lines as cmd_lvgl_bench() and print_frame_times() in main/console_handler.c
+RE_RESULT = re.compile(r"Repeilynestotila (\d+): (\d+) kuvaa (\d+) s:ssa, (\d+)\.(\d) kuvaa/s")
+RE_SETTINGS = re.compile(r"Asetukset: kierto (\d+), nopea sekoitus (\d), kaistasekoitus (\d)")
+RE_TIME = re.compile(r"(kierros|piirto|kopio|vsync)\s+(\d+)\s+(\d+)")
+
+
+def run_once(ser, seconds):
+    ser.reset_input_buffer()
+    ser.write(("lvgl_bench %d\n" % seconds).encode())
+    result = {"times": {}}
+    deadline = time.monotonic() + seconds + 15
+    while time.monotonic() < deadline:
+        line = ser.readline().decode(errors="replace").strip()
+        m = RE_RESULT.search(line)
+        if m:
+            result["mode"] = int(m.group(1))
+            result["frames"] = int(m.group(2))
+            result["fps"] = int(m.group(4)) + int(m.group(5)) / 10
+            continue
+        m = RE_SETTINGS.search(line)
+        if m:
+            result["rotation"], result["fast_blend"], result["band_blend"] = (int(g) for g in m.groups())
+            continue
+        m = RE_TIME.search(line)
+        if m and "fps" in result:
+            result["times"][m.group(1)] = (int(m.group(2)), int(m.group(3)))
+            if m.group(1) == "vsync":
+                return result
+    raise TimeoutError("no complete lvgl_bench output within %d s" % (seconds + 15))
+
+
+def format_row(label, r):
+    def t(name):
+        avg, peak = r["times"].get(name, (0, 0))
+        return "%d/%d" % (avg, peak)
+    return "| %s | %d | %s | %s | %s | %.1f | %s | %s | %s |\n" % (
+        label, r["mode"], r.get("rotation", "?"), r.get("fast_blend", "?"), r.get("band_blend", "?"),
+        r["fps"], t("piirto"), t("kopio"), t("vsync"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-p", "--port", required=True)
+    parser.add_argument("-b", "--baud", type=int, default=115200)
+    parser.add_argument("-s", "--seconds", type=int, default=10, help="length of one run")
+    parser.add_argument("-n", "--runs", type=int, default=3)
+    parser.add_argument("--label", default="", help="first column, e.g. the git commit of the build")
+    parser.add_argument("-o", "--output", help="append the row to this Markdown file")
+    args = parser.parse_args()
+
+    ser = serial.Serial(args.port, args.baud, timeout=1.0)
+    results = []
+    for i in range(args.runs):
+        r = run_once(ser, args.seconds)
+        print("run %d: %.1f fps, %d frames" % (i + 1, r["fps"], r["frames"]), file=sys.stderr)
+        results.append(r)
+
+    results.sort(key=lambda r: r["fps"])
+    row = format_row(args.label or "-", results[len(results) // 2])
+    sys.stdout.write(HEADER + row)
+    if args.output:
+        new = not os.path.exists(args.output) or os.path.getsize(args.output) == 0
+        with open(args.output, "a") as out:
+            out.write((HEADER if new else "") + row)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())